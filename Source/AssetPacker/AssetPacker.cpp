@@ -0,0 +1,103 @@
+// Packs an asset directory into an engine native asset pack, see ResourceCache/PackFile.h
+//
+//   AssetPacker <asset directory> <output.pak> [-store] [-blocksize <KB>]
+//
+// Names in the pack are relative to the asset directory. Formats that are compressed
+// already are stored, everything else is deflated when that makes it smaller.
+// -store keeps every entry stored, handy when profiling raw read speed.
+// -blocksize sets the size of the blocks large entries are deflated in, 0 deflates them whole.
+
+#include "../TinyEngine/TinyEngineBase.h"
+#include "../TinyEngine/ResourceCache/PackFile.h"
+#include <iostream>
+
+static bool IsCompressedFormat(const std::wstring& fileName)
+{
+	static const wchar_t* s_Extensions[] = { L".jpg", L".jpeg", L".png", L".zip", L".pak" };
+
+	std::wstring lower = fileName;
+	std::transform(lower.begin(), lower.end(), lower.begin(), (int(*)(int)) std::tolower);
+	for (const wchar_t* extension : s_Extensions)
+	{
+		size_t length = wcslen(extension);
+		if (lower.length() >= length && lower.compare(lower.length() - length, length, extension) == 0)
+			return true;
+	}
+	return false;
+}
+
+static int AddDirectory(PackFileWriter& writer, const std::wstring& rootDir, const std::wstring& subDir, bool storeAll)
+{
+	int fileCount = 0;
+	WIN32_FIND_DATA findData;
+	HANDLE fileHandle = FindFirstFile((rootDir + subDir + L"*").c_str(), &findData);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return 0;
+
+	do
+	{
+		std::wstring fileName = findData.cFileName;
+		if ((findData.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) || fileName == L"." || fileName == L"..")
+			continue;
+
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			fileCount += AddDirectory(writer, rootDir, subDir + fileName + L"\\", storeAll);
+		}
+		else
+		{
+			PackCodec codec = (storeAll || IsCompressedFormat(fileName)) ? PackCodec_Stored : PackCodec_Deflate;
+			writer.AddFile(Utility::WS2S(subDir + fileName), rootDir + subDir + fileName, codec);
+			++fileCount;
+		}
+	} while (FindNextFile(fileHandle, &findData));
+
+	FindClose(fileHandle);
+	return fileCount;
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	if (argc < 3)
+	{
+		std::wcout << L"Usage: AssetPacker <asset directory> <output.pak> [-store] [-blocksize <KB>]" << std::endl;
+		return 1;
+	}
+
+	std::wstring assetDir = argv[1];
+	if (assetDir.back() != L'\\' && assetDir.back() != L'/')
+	{
+		assetDir += L"\\";
+	}
+	bool storeAll = false;
+	uint32_t blockSize = PackHeader::DEFAULT_BLOCK_SIZE;
+	for (int i = 3; i < argc; ++i)
+	{
+		std::wstring option = argv[i];
+		if (option == L"-store")
+		{
+			storeAll = true;
+		}
+		else if (option == L"-blocksize" && i + 1 < argc)
+		{
+			blockSize = (uint32_t)std::wcstoul(argv[++i], nullptr, 10) * 1024;
+		}
+	}
+
+	PackFileWriter writer(PackHeader::DEFAULT_PAGE_SIZE, blockSize);
+	int fileCount = AddDirectory(writer, assetDir, L"", storeAll);
+	if (fileCount == 0)
+	{
+		std::wcout << L"No assets found in " << assetDir << std::endl;
+		return 1;
+	}
+
+	if (!writer.Write(argv[2]))
+	{
+		std::cout << "Failed: " << writer.GetLastError() << std::endl;
+		return 1;
+	}
+
+	std::wcout << L"Packed " << fileCount << L" files into " << argv[2] << std::endl;
+	return 0;
+}
@@ -90,5 +90,11 @@ namespace FXStudio
         [DllImport(editorDllName, CallingConvention = CallingConvention.StdCall)]
         public unsafe static extern void SetMoveDelegate(
             [MarshalAs(UnmanagedType.FunctionPtr)] DllMoveDelegate moveDelegate);
+
+        [DllImport(editorDllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern void SetResourceCacheBudget(uint sizeInMb);
+
+        [DllImport(editorDllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern uint TrimResourceCache(float targetFraction);
     }
 }
@@ -306,3 +306,21 @@ FXSTUDIOCORE_API void FX_APIENTRY SetMoveDelegate(MoveDelegate delegate)
 	}
 }
 
+FXSTUDIOCORE_API void FX_APIENTRY SetResourceCacheBudget(unsigned int sizeInMb)
+{
+	if (g_pApp->GetResCache() != nullptr)
+	{
+		g_pApp->GetResCache()->SetBudget((uint64_t)sizeInMb * 1024 * 1024);
+	}
+}
+
+// Returns the megabytes given back
+FXSTUDIOCORE_API unsigned int FX_APIENTRY TrimResourceCache(float targetFraction)
+{
+	if (g_pApp->GetResCache() == nullptr)
+	{
+		return 0;
+	}
+
+	return (unsigned int)(g_pApp->GetResCache()->Trim(targetFraction) / (1024 * 1024));
+}
@@ -55,6 +55,9 @@ extern "C" {
 
 	FXSTUDIOCORE_API void FX_APIENTRY SetMoveDelegate(MoveDelegate delegate);
 
+	FXSTUDIOCORE_API void FX_APIENTRY SetResourceCacheBudget(unsigned int sizeInMb);
+	FXSTUDIOCORE_API unsigned int FX_APIENTRY TrimResourceCache(float targetFraction);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
\ No newline at end of file
@@ -8,7 +8,7 @@ MaterialNode::MaterialNode(const std::string& materialName)
 	m_pVertexBuffer(nullptr),
 	m_pIndexBuffer(nullptr),
 	m_Mesh(nullptr),
-	m_MaterialName(materialName)
+	m_MaterialId(materialName)
 {		
 	std::vector<VertexPositionNormalTexture> vertices;
 	std::vector<uint16_t> indices;
@@ -32,8 +32,7 @@ HRESULT MaterialNode::OnInitSceneNode()
 
 	const tinyxml2::XMLElement* rootNode = nullptr;
 
-	Resource materialRes(m_MaterialName);
-	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
+	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(m_MaterialId);
 	if (pMaterialResHandle != nullptr)
 	{
 		shared_ptr<XmlResourceExtraData> extra = static_pointer_cast<XmlResourceExtraData>(pMaterialResHandle->GetExtraData());
@@ -45,7 +44,7 @@ HRESULT MaterialNode::OnInitSceneNode()
 
 	if (nullptr == rootNode)
 	{
-		DEBUG_ERROR("Material is not exist or valid: " + m_MaterialName);
+		DEBUG_ERROR("Material is not exist or valid: " + m_MaterialId.GetName());
 		return S_FALSE;
 	}
 
@@ -116,8 +115,7 @@ HRESULT MaterialNode::Render(const GameTime& gameTime)
 {
 	const tinyxml2::XMLElement* rootNode = nullptr;
 
-	Resource materialRes(m_MaterialName);
-	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
+	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(m_MaterialId);
 	if (pMaterialResHandle != nullptr)
 	{
 		shared_ptr<XmlResourceExtraData> extra = static_pointer_cast<XmlResourceExtraData>(pMaterialResHandle->GetExtraData());
@@ -242,9 +240,8 @@ HRESULT MaterialNode::Render(const GameTime& gameTime)
 			const char* resourName = pNode->Attribute("resourcename");
 			if (resourName != nullptr)
 			{
-				std::string textureName = std::string("Textures\\") + resourName;
-				Resource resource(textureName);
-				shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(&resource);
+				ResourceId textureId("Textures\\", resourName);
+				shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(textureId);
 				if (pTextureRes != nullptr)
 				{
 					shared_ptr<D3D11TextureResourceExtraData> extra =
@@ -23,6 +23,6 @@ private:
 	Matrix m_World;
 	Matrix m_View;
 	Matrix m_Project;
-	std::string m_MaterialName;
+	ResourceId m_MaterialId;
 };
 
@@ -0,0 +1,162 @@
+#include "Bench.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "boost/thread/mutex.hpp"
+#include <iostream>
+#include <iomanip>
+
+// Replays the eviction trace through the cache once per allocator, then replays the
+// allocations and frees the cache made straight against each allocator to time them alone.
+// The heap allocator's reserved bytes are what it asked new for, the C runtime's own
+// overhead and fragmentation don't show up in them.
+//
+//   ResCacheBench allocators [-assets <count>] [-requests <count>] [-budget <percent of the assets>]
+
+namespace
+{
+	struct AllocatorEvent
+	{
+		uint32_t m_Allocation;
+		uint32_t m_Size;		// 0 for a free
+	};
+
+	// Hands out heap buffers and writes down what was asked of it
+	class RecordingAllocator : public HeapResourceAllocator
+	{
+	public:
+		RecordingAllocator() : m_AllocationCount(0) {}
+
+		virtual char* VAllocate(size_t size) override
+		{
+			char* pBuffer = HeapResourceAllocator::VAllocate(size);
+			boost::mutex::scoped_lock lock(m_EventsMutex);
+			uint32_t allocation = m_AllocationCount++;
+			m_Live[pBuffer] = allocation;
+			m_Events.push_back(AllocatorEvent{ allocation, (uint32_t)size });
+			return pBuffer;
+		}
+
+		virtual void VFree(char* pBuffer) override
+		{
+			if (pBuffer != nullptr)
+			{
+				boost::mutex::scoped_lock lock(m_EventsMutex);
+				std::unordered_map<char*, uint32_t>::iterator live = m_Live.find(pBuffer);
+				m_Events.push_back(AllocatorEvent{ live->second, 0 });
+				m_Live.erase(live);
+			}
+			HeapResourceAllocator::VFree(pBuffer);
+		}
+
+		std::vector<AllocatorEvent> m_Events;
+		uint32_t m_AllocationCount;
+
+	private:
+		boost::mutex m_EventsMutex;
+		std::unordered_map<char*, uint32_t> m_Live;
+	};
+
+	struct Allocator
+	{
+		const char* m_Name;
+		shared_ptr<IResourceAllocator>(*m_pCreate)();
+	};
+
+	const Allocator ALLOCATORS[] =
+	{
+		{ "new/delete", []() { return shared_ptr<IResourceAllocator>(DEBUG_NEW HeapResourceAllocator()); } },
+		{ "slab", []() { return shared_ptr<IResourceAllocator>(DEBUG_NEW SlabResourceAllocator()); } },
+	};
+
+	bool ReplayTrace(const boost::filesystem::path& packFile, uint64_t budget, const std::vector<ResourceId>& ids,
+		const std::vector<uint32_t>& trace, shared_ptr<IResourceAllocator> pAllocator, double& seconds)
+	{
+		ResCache cache(1, "", true, Utility::WS2S(packFile.wstring()));
+		cache.SetAllocator(pAllocator);
+		if (!cache.Init())
+		{
+			std::cout << "Can't open " << packFile.string() << std::endl;
+			return false;
+		}
+		cache.SetBudget(budget);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint32_t index : trace)
+		{
+			if (!cache.GetHandle(ids[index]))
+			{
+				std::cout << "Can't load " << ids[index].GetName() << std::endl;
+				return false;
+			}
+		}
+		seconds = SecondsSince(start);
+		return true;
+	}
+}
+
+int RunAllocatorBench(const BenchArgs& args)
+{
+	uint32_t assetCount = GetBenchOption(args, L"-assets", 2000);
+	uint32_t requestCount = GetBenchOption(args, L"-requests", 200000);
+	uint32_t budgetPercent = GetBenchOption(args, L"-budget", 25);
+
+	boost::filesystem::path packFile = GetBenchDirectory("allocators") / "allocators.pak";
+	std::cout << "Packing " << assetCount << " assets..." << std::endl;
+	if (!MakeBenchPack(packFile, assetCount, GetTraceAssetSize, PackCodec_Deflate))
+		return 1;
+
+	uint64_t totalBytes = 0;
+	std::vector<ResourceId> ids;
+	for (uint32_t i = 0; i < assetCount; ++i)
+	{
+		totalBytes += GetTraceAssetSize(i);
+		ids.push_back(ResourceId(GetBenchAssetName(i)));
+	}
+	std::vector<uint32_t> trace = MakeBenchTrace(assetCount, requestCount);
+	uint64_t budget = totalBytes * budgetPercent / 100;
+
+	shared_ptr<RecordingAllocator> pRecorder(DEBUG_NEW RecordingAllocator());
+	double seconds = 0.0;
+	if (!ReplayTrace(packFile, budget, ids, trace, pRecorder, seconds))
+		return 1;
+	const std::vector<AllocatorEvent>& events = pRecorder->m_Events;
+	std::cout << trace.size() << " requests made " << events.size() << " allocations and frees" << std::endl;
+
+	std::cout << std::setw(12) << "allocator" << std::setw(12) << "trace s" << std::setw(12) << "ns per op"
+		<< std::setw(14) << "peak used KB" << std::setw(18) << "peak reserved KB" << std::endl;
+	for (const Allocator& allocator : ALLOCATORS)
+	{
+		if (!ReplayTrace(packFile, budget, ids, trace, allocator.m_pCreate(), seconds))
+			return 1;
+
+		// Buffers the cache still held at the end are freed after the clock stops
+		shared_ptr<IResourceAllocator> pAllocator = allocator.m_pCreate();
+		std::vector<char*> buffers(pRecorder->m_AllocationCount, nullptr);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (const AllocatorEvent& event : events)
+		{
+			if (event.m_Size != 0)
+			{
+				buffers[event.m_Allocation] = pAllocator->VAllocate(event.m_Size);
+			}
+			else
+			{
+				pAllocator->VFree(buffers[event.m_Allocation]);
+				buffers[event.m_Allocation] = nullptr;
+			}
+		}
+		double replaySeconds = SecondsSince(start);
+
+		ResourceAllocatorStats stats = pAllocator->VGetStats();
+		for (char* pBuffer : buffers)
+		{
+			pAllocator->VFree(pBuffer);
+		}
+
+		std::cout << std::fixed << std::setw(12) << allocator.m_Name
+			<< std::setw(12) << std::setprecision(2) << seconds
+			<< std::setw(12) << std::setprecision(1) << replaySeconds * 1e9 / std::max<size_t>(events.size(), 1)
+			<< std::setw(14) << stats.m_PeakBytesInUse / 1024
+			<< std::setw(18) << stats.m_PeakBytesReserved / 1024 << std::endl;
+	}
+	return 0;
+}
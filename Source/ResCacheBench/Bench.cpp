@@ -0,0 +1,164 @@
+#include "Bench.h"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/fstream.hpp"
+#include <random>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+volatile uint64_t g_BenchSink = 0;
+
+namespace
+{
+	const uint32_t TRACE_SCAN_INTERVAL = 5000;
+	const uint32_t TRACE_SCAN_LENGTH = 400;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+fs::path GetBenchDirectory(const std::string& name)
+{
+	fs::path directory = fs::temp_directory_path() / "ResCacheBench" / name;
+	boost::system::error_code error;
+	fs::create_directories(directory, error);
+	return directory;
+}
+
+uint32_t GetBenchOption(const BenchArgs& args, const std::wstring& option, uint32_t defaultValue)
+{
+	for (size_t i = 0; i + 1 < args.size(); ++i)
+	{
+		if (args[i] == option)
+			return (uint32_t)std::wcstoul(args[i + 1].c_str(), nullptr, 10);
+	}
+	return defaultValue;
+}
+
+bool HasBenchFlag(const BenchArgs& args, const std::wstring& flag)
+{
+	return std::find(args.begin(), args.end(), flag) != args.end();
+}
+
+bool DropFileCache(const fs::path& file)
+{
+#if defined(__linux__)
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	bool isDropped = (fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+	close(fd);
+	return isDropped;
+#else
+	return false;
+#endif
+}
+
+void FillBenchData(char* pData, size_t size, uint32_t seed)
+{
+	// Runs of a few letters, repeated, deflate about as well as typical mesh and text assets
+	std::mt19937 random(seed);
+	size_t i = 0;
+	while (i < size)
+	{
+		uint32_t value = random();
+		char letter = 'a' + (value & 15);
+		size_t run = std::min<size_t>(1 + ((value >> 4) & 3), size - i);
+		memset(pData + i, letter, run);
+		i += run;
+	}
+}
+
+std::string GetBenchAssetName(uint32_t index)
+{
+	std::ostringstream name;
+	name << "bench/" << std::setw(5) << std::setfill('0') << index << ".bin";
+	return name.str();
+}
+
+uint32_t GetTraceAssetSize(uint32_t index)
+{
+	std::mt19937 random(index);
+	uint32_t sizeClass = random() % 16;
+	return 512u << std::min<uint32_t>(sizeClass / 2, 7);
+}
+
+std::vector<uint32_t> MakeBenchTrace(uint32_t assetCount, uint32_t requestCount)
+{
+	// The popular assets are the first half, the scans walk the second half
+	uint32_t hotCount = std::max(assetCount / 2, 1u);
+	std::vector<double> cumulative(hotCount);
+	double total = 0.0;
+	for (uint32_t rank = 0; rank < hotCount; ++rank)
+	{
+		total += 1.0 / (rank + 1);
+		cumulative[rank] = total;
+	}
+
+	std::mt19937 random(0x5eed);
+	std::uniform_real_distribution<double> uniform(0.0, total);
+	std::vector<uint32_t> trace;
+	trace.reserve(requestCount);
+	uint32_t nextCold = hotCount;
+	while (trace.size() < requestCount)
+	{
+		if (trace.size() % TRACE_SCAN_INTERVAL == TRACE_SCAN_INTERVAL - 1 && assetCount > hotCount)
+		{
+			for (uint32_t i = 0; i < TRACE_SCAN_LENGTH && trace.size() < requestCount; ++i)
+			{
+				trace.push_back(nextCold);
+				nextCold = (nextCold + 1 < assetCount) ? nextCold + 1 : hotCount;
+			}
+			continue;
+		}
+
+		double pick = uniform(random);
+		trace.push_back((uint32_t)(std::lower_bound(cumulative.begin(), cumulative.end(), pick) - cumulative.begin()));
+	}
+	return trace;
+}
+
+bool MakeBenchPack(const fs::path& packFile, uint32_t count, const std::function<uint32_t(uint32_t)>& sizeOf,
+	PackCodec codec, uint32_t pageSize, uint32_t blockSize)
+{
+	fs::path assetDir = packFile.parent_path() / "assets";
+	boost::system::error_code error;
+	fs::create_directories(assetDir / "bench", error);
+
+	PackFileWriter writer(pageSize, blockSize);
+	std::vector<char> data;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		std::string name = GetBenchAssetName(i);
+		data.resize(sizeOf(i));
+		FillBenchData(data.data(), data.size(), i);
+
+		fs::path assetFile = assetDir / name;
+		fs::ofstream file(assetFile, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+		file.close();
+		if (file.fail())
+		{
+			std::cout << "Can't write " << assetFile.string() << std::endl;
+			return false;
+		}
+		writer.AddFile(name, assetFile.wstring(), codec);
+	}
+
+	if (!writer.Write(packFile.wstring()))
+	{
+		std::cout << "Can't write " << packFile.string() << ": " << writer.GetLastError() << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "../TinyEngine/TinyEngineBase.h"
+#include "../TinyEngine/ResourceCache/PackFile.h"
+#include "boost/filesystem/path.hpp"
+#include <chrono>
+
+// Helpers shared by the benchmarks. Each benchmark builds the asset pack it reads from in a
+// directory of its own under the bench directory, so runs don't depend on a project's assets.
+
+typedef std::vector<std::wstring> BenchArgs;
+
+// Benchmarks add what they computed here so the timed loops are not optimized away
+extern volatile uint64_t g_BenchSink;
+
+double SecondsSince(std::chrono::steady_clock::time_point start);
+// %TEMP%\ResCacheBench\<name>, created when missing
+boost::filesystem::path GetBenchDirectory(const std::string& name);
+// The value following option in args, or defaultValue
+uint32_t GetBenchOption(const BenchArgs& args, const std::wstring& option, uint32_t defaultValue);
+
+bool HasBenchFlag(const BenchArgs& args, const std::wstring& flag);
+// Asks the OS to forget the file's cached pages so the next read goes to the disk. Only Linux
+// can do that for a user, false elsewhere.
+bool DropFileCache(const boost::filesystem::path& file);
+
+// Deterministic content for a benchmark asset, about half of it compresses away
+void FillBenchData(char* pData, size_t size, uint32_t seed);
+// "bench/00042.bin", the name of the index'th asset of a bench pack
+std::string GetBenchAssetName(uint32_t index);
+
+// Writes count assets, sizeOf(index) bytes each, and packs them into packFile. The assets are
+// left next to the pack for benchmarks that read loose files. False when anything failed.
+bool MakeBenchPack(const boost::filesystem::path& packFile, uint32_t count, const std::function<uint32_t(uint32_t)>& sizeOf,
+	PackCodec codec, uint32_t pageSize = PackHeader::DEFAULT_PAGE_SIZE, uint32_t blockSize = PackHeader::DEFAULT_BLOCK_SIZE);
+
+// Trace replay: asset sizes run from 512 bytes to 64 KB, most of them small, like a project's
+// materials, meshes and textures. Popular assets are asked for along a Zipf curve and every
+// so often a one-off pass, a level load or a thumbnail sweep, reads cold assets in order.
+uint32_t GetTraceAssetSize(uint32_t index);
+std::vector<uint32_t> MakeBenchTrace(uint32_t assetCount, uint32_t requestCount);
+
+int RunHitLatencyBench(const BenchArgs& args);
+int RunEvictionPolicyBench(const BenchArgs& args);
+int RunColdPreloadBench(const BenchArgs& args);
+int RunAllocatorBench(const BenchArgs& args);
+int RunBlockInflateBench(const BenchArgs& args);
@@ -0,0 +1,70 @@
+#include "Bench.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "../TinyEngine/Utilities/ThreadPool.h"
+#include <iostream>
+#include <iomanip>
+
+// Reads one large block deflated entry with its blocks inflated by more and more decode
+// threads. The pack is mapped, so after the first run this is inflating alone. The calling
+// thread inflates blocks too, so a pool of n threads inflates on n + 1.
+//
+//   ResCacheBench inflate [-size <MB>] [-blocksize <KB>] [-runs <count>]
+
+namespace
+{
+	const uint32_t THREAD_COUNTS[] = { 0, 1, 2, 3, 5, 7, 11, 15 };
+}
+
+int RunBlockInflateBench(const BenchArgs& args)
+{
+	uint32_t size = GetBenchOption(args, L"-size", 64) * 1024 * 1024;
+	uint32_t blockSize = GetBenchOption(args, L"-blocksize", PackHeader::DEFAULT_BLOCK_SIZE / 1024) * 1024;
+	uint32_t runCount = std::max(GetBenchOption(args, L"-runs", 3), 1u);
+
+	boost::filesystem::path packFile = GetBenchDirectory("inflate") / "inflate.pak";
+	std::cout << "Packing " << size / (1024 * 1024) << " MB in " << blockSize / 1024 << " KB blocks..." << std::endl;
+	if (!MakeBenchPack(packFile, 1, [size](uint32_t) { return size; }, PackCodec_Deflate, PackHeader::DEFAULT_PAGE_SIZE, blockSize))
+		return 1;
+
+	ResourcePackFile pack(packFile.wstring());
+	if (!pack.VOpen())
+	{
+		std::cout << "Can't open " << packFile.string() << std::endl;
+		return 1;
+	}
+
+	Resource r(GetBenchAssetName(0));
+	std::vector<char> expected(size);
+	FillBenchData(expected.data(), size, 0);
+	std::vector<char> buffer(size);
+
+	std::cout << std::setw(10) << "threads" << std::setw(12) << "best s" << std::setw(10) << "MB/s" << std::setw(10) << "speedup" << std::endl;
+	double singleThreaded = 0.0;
+	for (uint32_t threadCount : THREAD_COUNTS)
+	{
+		unique_ptr<ThreadPool> pThreads((threadCount > 0) ? DEBUG_NEW ThreadPool(threadCount) : nullptr);
+		pack.VSetDecodeThreads(pThreads.get());
+
+		double best = 0.0;
+		for (uint32_t run = 0; run < runCount; ++run)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			int64_t bytesRead = pack.VGetRawResource(r, buffer.data());
+			double seconds = SecondsSince(start);
+			if (bytesRead != size || buffer != expected)
+			{
+				std::cout << "The entry did not read back as it was packed" << std::endl;
+				return 1;
+			}
+			best = (run == 0) ? seconds : std::min(best, seconds);
+		}
+		pack.VSetDecodeThreads(nullptr);
+
+		singleThreaded = (threadCount == 0) ? best : singleThreaded;
+		std::cout << std::fixed << std::setw(10) << threadCount + 1
+			<< std::setw(12) << std::setprecision(3) << best
+			<< std::setw(10) << std::setprecision(1) << size / (1024.0 * 1024.0) / best
+			<< std::setw(10) << std::setprecision(2) << singleThreaded / best << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "Bench.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "../TinyEngine/ResourceCache/FileReader.h"
+#include <iostream>
+#include <iomanip>
+
+// Preloads a whole pack into an empty cache once per file reader. The pack's pages are dropped
+// from the OS cache before each run where the OS lets us, elsewhere the runs after the first
+// read from memory and only compare the readers' overhead. Entries are stored unless -deflate
+// is given, so the reads dominate.
+//
+//   ResCacheBench preload [-assets <count>] [-runs <count>] [-deflate]
+
+namespace
+{
+	struct Reader
+	{
+		const char* m_Name;
+		FileReaderType m_Type;
+	};
+
+	const Reader READERS[] =
+	{
+		{ "blocking", FileReader_Blocking },
+		{ "threads", FileReader_ThreadPool },
+		{ "io_uring", FileReader_IoUring },
+	};
+}
+
+int RunColdPreloadBench(const BenchArgs& args)
+{
+	uint32_t assetCount = GetBenchOption(args, L"-assets", 4000);
+	uint32_t runCount = std::max(GetBenchOption(args, L"-runs", 3), 1u);
+	PackCodec codec = HasBenchFlag(args, L"-deflate") ? PackCodec_Deflate : PackCodec_Stored;
+
+	boost::filesystem::path packFile = GetBenchDirectory("preload") / "preload.pak";
+	std::cout << "Packing " << assetCount << " assets..." << std::endl;
+	if (!MakeBenchPack(packFile, assetCount, GetTraceAssetSize, codec))
+		return 1;
+
+	uint64_t totalBytes = 0;
+	for (uint32_t i = 0; i < assetCount; ++i)
+	{
+		totalBytes += GetTraceAssetSize(i);
+	}
+
+	bool isCold = DropFileCache(packFile);
+	std::cout << totalBytes / 1024 << " KB of assets, " << (isCold ? "OS file cache dropped before each run" : "OS file cache left warm") << std::endl;
+	std::cout << std::setw(10) << "reader" << std::setw(12) << "name" << std::setw(12) << "best s" << std::setw(12) << "worst s" << std::setw(10) << "MB/s" << std::endl;
+	for (const Reader& reader : READERS)
+	{
+		// What the reader ends up as, io_uring falls back to the I/O threads where there is none
+		unique_ptr<IFileReader> pProbe = CreateFileReader(reader.m_Type);
+		std::string name = pProbe->VOpen(packFile.wstring()) ? pProbe->VGetName() : "?";
+		pProbe.reset();
+
+		double best = 0.0;
+		double worst = 0.0;
+		for (uint32_t run = 0; run < runCount; ++run)
+		{
+			DropFileCache(packFile);
+
+			ResCache cache(1, "", true, Utility::WS2S(packFile.wstring()));
+			cache.SetFileReader(reader.m_Type);
+			if (!cache.Init())
+			{
+				std::cout << "Can't open " << packFile.string() << std::endl;
+				return 1;
+			}
+			cache.SetBudget(totalBytes * 2);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			int loaded = cache.Preload("*");
+			double seconds = SecondsSince(start);
+			if (loaded != (int)assetCount)
+			{
+				std::cout << reader.m_Name << " preloaded " << loaded << " of " << assetCount << " assets" << std::endl;
+				return 1;
+			}
+
+			best = (run == 0) ? seconds : std::min(best, seconds);
+			worst = std::max(worst, seconds);
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << std::setw(10) << reader.m_Name << std::setw(12) << name
+			<< std::setw(12) << best << std::setw(12) << worst
+			<< std::setw(10) << std::setprecision(1) << totalBytes / (1024.0 * 1024.0) / best << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "Bench.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include <iostream>
+#include <iomanip>
+
+// Replays the same trace through the cache once per eviction policy, with a budget that only
+// holds part of the assets. The assets are deflated, a stored one would be a view into the
+// mapped pack and never charged to the cache. The one-off scans are what 2Q is meant to shrug off.
+//
+//   ResCacheBench policies [-assets <count>] [-requests <count>] [-budget <percent of the assets>]
+
+namespace
+{
+	const char* POLICIES[] = { "lru", "lfu", "2q" };
+}
+
+int RunEvictionPolicyBench(const BenchArgs& args)
+{
+	uint32_t assetCount = GetBenchOption(args, L"-assets", 2000);
+	uint32_t requestCount = GetBenchOption(args, L"-requests", 200000);
+	uint32_t budgetPercent = GetBenchOption(args, L"-budget", 25);
+
+	boost::filesystem::path packFile = GetBenchDirectory("policies") / "policies.pak";
+	std::cout << "Packing " << assetCount << " assets..." << std::endl;
+	if (!MakeBenchPack(packFile, assetCount, GetTraceAssetSize, PackCodec_Deflate))
+		return 1;
+
+	uint64_t totalBytes = 0;
+	std::vector<ResourceId> ids;
+	for (uint32_t i = 0; i < assetCount; ++i)
+	{
+		totalBytes += GetTraceAssetSize(i);
+		ids.push_back(ResourceId(GetBenchAssetName(i)));
+	}
+	std::vector<uint32_t> trace = MakeBenchTrace(assetCount, requestCount);
+	uint64_t budget = totalBytes * budgetPercent / 100;
+	std::cout << trace.size() << " requests, " << budget / 1024 << " KB budget for " << totalBytes / 1024 << " KB of assets" << std::endl;
+
+	std::cout << std::setw(8) << "policy" << std::setw(12) << "hit ratio" << std::setw(12) << "evictions"
+		<< std::setw(14) << "KB loaded" << std::setw(12) << "seconds" << std::endl;
+	for (const char* policy : POLICIES)
+	{
+		ResCache cache(1, "", true, Utility::WS2S(packFile.wstring()));
+		if (!cache.Init())
+		{
+			std::cout << "Can't open " << packFile.string() << std::endl;
+			return 1;
+		}
+		cache.SetBudget(budget);
+		cache.SetEvictionPolicy(CreateEvictionPolicy(policy));
+
+		uint64_t bytesLoaded = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint32_t index : trace)
+		{
+			uint64_t misses = cache.GetStats().m_Misses;
+			shared_ptr<ResHandle> handle = cache.GetHandle(ids[index]);
+			if (!handle)
+			{
+				std::cout << "Can't load " << ids[index].GetName() << std::endl;
+				return 1;
+			}
+			bytesLoaded += (cache.GetStats().m_Misses != misses) ? handle->Size() : 0;
+		}
+		double seconds = SecondsSince(start);
+
+		const ResCacheStats& stats = cache.GetStats();
+		std::cout << std::fixed << std::setw(8) << policy
+			<< std::setw(12) << std::setprecision(3) << stats.GetHitRatio()
+			<< std::setw(12) << stats.m_Evictions
+			<< std::setw(14) << bytesLoaded / 1024
+			<< std::setw(12) << std::setprecision(2) << seconds << std::endl;
+	}
+	return 0;
+}
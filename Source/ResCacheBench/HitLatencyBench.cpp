@@ -0,0 +1,121 @@
+#include "Bench.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "boost/filesystem/operations.hpp"
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+// A hit is one hash probe on the interned id whatever the number of resident handles, so the
+// time per hit should stay flat from a hundred handles to a hundred thousand. The hot column
+// asks for the same HOT_SET_SIZE handles over and over, the way a frame does, and is the one
+// to compare. Asking for any of the handles at random is timed too, once they no longer fit
+// the CPU caches that is memory latency rather than the cache's work. Looking a resource up
+// by name normalizes and hashes the name first.
+//
+//   ResCacheBench hits [-lookups <count>]
+
+namespace
+{
+	const uint32_t HANDLE_COUNTS[] = { 100, 1000, 10000, 100000 };
+	const uint32_t HOT_SET_SIZE = 100;
+	const uint32_t ASSET_SIZE = 64;
+	const uint32_t PAGE_SIZE = 64;
+	const uint32_t CACHE_SIZE_MB = 256;
+}
+
+int RunHitLatencyBench(const BenchArgs& args)
+{
+	uint32_t lookupCount = GetBenchOption(args, L"-lookups", 1000000);
+	uint32_t maxHandles = HANDLE_COUNTS[_countof(HANDLE_COUNTS) - 1];
+
+	boost::filesystem::path packFile = GetBenchDirectory("hits") / "hits.pak";
+	std::cout << "Packing " << maxHandles << " assets..." << std::endl;
+	if (!MakeBenchPack(packFile, maxHandles, [](uint32_t) { return ASSET_SIZE; }, PackCodec_Stored, PAGE_SIZE))
+		return 1;
+
+	std::vector<ResourceId> ids;
+	std::vector<Resource> resources;
+	for (uint32_t i = 0; i < maxHandles; ++i)
+	{
+		resources.push_back(Resource(GetBenchAssetName(i)));
+		ids.push_back(resources.back().m_Id);
+	}
+
+	std::cout << std::setw(10) << "handles" << std::setw(14) << "hot by id ns" << std::setw(14) << "by id ns" << std::setw(14) << "by name ns" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	for (uint32_t handleCount : HANDLE_COUNTS)
+	{
+		ResCache cache(CACHE_SIZE_MB, "", true, Utility::WS2S(packFile.wstring()));
+		if (!cache.Init())
+		{
+			std::cout << "Can't open " << packFile.string() << std::endl;
+			return 1;
+		}
+
+		for (uint32_t i = 0; i < handleCount; ++i)
+		{
+			if (!cache.GetHandle(&resources[i]))
+			{
+				std::cout << "Can't load " << resources[i].GetName() << std::endl;
+				return 1;
+			}
+		}
+
+		// Picked before the clock starts, the hot set spread over all the resident handles
+		std::mt19937 random(handleCount);
+		std::vector<uint32_t> hotSet(HOT_SET_SIZE);
+		for (auto& index : hotSet)
+		{
+			index = random() % handleCount;
+		}
+		std::vector<uint32_t> hotOrder(lookupCount);
+		std::vector<uint32_t> order(lookupCount);
+		for (uint32_t i = 0; i < lookupCount; ++i)
+		{
+			hotOrder[i] = hotSet[random() % HOT_SET_SIZE];
+			order[i] = random() % handleCount;
+		}
+
+		uint64_t checksum = 0;
+		for (uint32_t i = 0; i < handleCount; ++i)
+		{
+			checksum += cache.GetHandle(ids[i])->Size();
+		}
+		cache.ResetStats();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint32_t index : hotOrder)
+		{
+			checksum += cache.GetHandle(ids[index])->Size();
+		}
+		double hotSeconds = SecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		for (uint32_t index : order)
+		{
+			checksum += cache.GetHandle(ids[index])->Size();
+		}
+		double byIdSeconds = SecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		for (uint32_t index : order)
+		{
+			Resource r(resources[index].GetName());
+			checksum += cache.GetHandle(&r)->Size();
+		}
+		double byNameSeconds = SecondsSince(start);
+
+		if (cache.GetStats().m_Misses != 0)
+		{
+			std::cout << "Handles were evicted, the cache is too small for the benchmark" << std::endl;
+			return 1;
+		}
+
+		std::cout << std::setw(10) << handleCount
+			<< std::setw(14) << hotSeconds * 1e9 / lookupCount
+			<< std::setw(14) << byIdSeconds * 1e9 / lookupCount
+			<< std::setw(14) << byNameSeconds * 1e9 / lookupCount << std::endl;
+		g_BenchSink += checksum;
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+// Resource cache benchmarks, each one builds the assets it needs and prints a table
+//
+//   ResCacheBench <benchmark> [options]
+//
+//   hits		hit latency from 100 to 100k resident handles
+//   policies	LRU, LFU and 2Q replaying the same trace
+//   preload	a cold Preload through the blocking, thread pool and io_uring readers
+//   allocators	the slab allocator and new/delete replaying the same trace
+//   inflate	a block deflated entry inflated by 1 to 16 threads
+
+#include "Bench.h"
+#include <iostream>
+
+namespace
+{
+	struct Benchmark
+	{
+		const wchar_t* m_Name;
+		int(*m_pRun)(const BenchArgs& args);
+	};
+
+	const Benchmark BENCHMARKS[] =
+	{
+		{ L"hits", RunHitLatencyBench },
+		{ L"policies", RunEvictionPolicyBench },
+		{ L"preload", RunColdPreloadBench },
+		{ L"allocators", RunAllocatorBench },
+		{ L"inflate", RunBlockInflateBench },
+	};
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	if (argc < 2)
+	{
+		std::wcout << L"Usage: ResCacheBench <benchmark> [options]" << std::endl;
+		for (const Benchmark& benchmark : BENCHMARKS)
+		{
+			std::wcout << L"  " << benchmark.m_Name << std::endl;
+		}
+		return 1;
+	}
+
+	Logger::Init(nullptr);
+	int result = -1;
+	for (const Benchmark& benchmark : BENCHMARKS)
+	{
+		if (benchmark.m_Name == std::wstring(argv[1]))
+		{
+			result = benchmark.m_pRun(BenchArgs(argv + 2, argv + argc));
+		}
+	}
+	if (result < 0)
+	{
+		std::wcout << L"Unknown benchmark " << argv[1] << std::endl;
+		result = 1;
+	}
+	Logger::Destroy();
+	return result;
+}
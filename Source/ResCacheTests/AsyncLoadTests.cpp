@@ -0,0 +1,120 @@
+#include "Tests.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "../TinyEngine/ResourceCache/XmlResource.h"
+#include <thread>
+
+// GetHandleAsync through the XML loader and the default loader, without a game app. The same
+// resource asked for several times before it's loaded is read once and every caller gets it.
+
+namespace
+{
+	const uint32_t REQUEST_COUNT = 3;
+	const char XML_NAME[] = "test/actor.xml";
+	const char XML_TEXT[] = "<Actor type=\"Test\"><TransformComponent><Position x=\"1\" y=\"2\" z=\"3\"/></TransformComponent></Actor>";
+	const char MISSING_NAME[] = "test/missing.bin";
+
+	struct Requested
+	{
+		Requested() : m_Calls(0), m_IsSameHandle(true) {}
+
+		shared_ptr<ResHandle> m_pHandle;
+		uint32_t m_Calls;
+		bool m_IsSameHandle;
+	};
+
+	ResLoadCallback Record(Requested& requested)
+	{
+		return [&requested](shared_ptr<ResHandle> handle)
+		{
+			if (requested.m_Calls++ > 0 && handle != requested.m_pHandle)
+			{
+				requested.m_IsSameHandle = false;
+			}
+			requested.m_pHandle = handle;
+		};
+	}
+
+	bool WaitForLoads(ResCache& cache)
+	{
+		// What the game loop would do, pump OnUpdate until the workers are done
+		for (uint32_t wait = 0; wait < 10000 && cache.HasPendingLoads(); ++wait)
+		{
+			cache.OnUpdate();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return !cache.HasPendingLoads();
+	}
+}
+
+void TestAsyncLoads()
+{
+	std::vector<TestEntry> entries = MakeTestEntries(8, [](uint32_t i) { return 1 + i * 40000; });
+	TestEntry xml;
+	xml.m_Name = XML_NAME;
+	xml.m_Data.assign(XML_TEXT, XML_TEXT + sizeof(XML_TEXT) - 1);
+	xml.m_IsDeflated = true;
+	entries.push_back(xml);
+
+	boost::filesystem::path zipFile = GetTestDirectory("async") / "async.zip";
+	if (!TEST_CHECK(WriteTestZip(zipFile, entries)))
+		return;
+
+	ResCache cache(16, "", true, zipFile.string());
+	if (!TEST_CHECK(cache.Init()))
+		return;
+	cache.RegisterLoader(CreateXmlResourceLoader());
+	cache.SetLoadProfiling(true);
+
+	std::vector<Requested> requested(entries.size());
+	Requested missing;
+	for (uint32_t request = 0; request < REQUEST_COUNT; ++request)
+	{
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			Resource r(entries[i].m_Name);
+			cache.GetHandleAsync(&r, Record(requested[i]));
+		}
+
+		Resource r(MISSING_NAME);
+		cache.GetHandleAsync(&r, Record(missing));
+	}
+
+	if (!TEST_CHECK(WaitForLoads(cache)))
+		return;
+
+	// One load for each resource, the missing one included, however many asked for it
+	TEST_CHECK(cache.GetLoadProfiler()->GetLoadCount() == entries.size() + 1);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		TEST_CHECK(requested[i].m_Calls == REQUEST_COUNT);
+		TEST_CHECK(requested[i].m_IsSameHandle);
+		TEST_CHECK(requested[i].m_pHandle);
+	}
+	TEST_CHECK(missing.m_Calls == REQUEST_COUNT);
+	TEST_CHECK(!missing.m_pHandle);
+
+	for (size_t i = 0; i + 1 < entries.size(); ++i)
+	{
+		shared_ptr<ResHandle> handle = requested[i].m_pHandle;
+		if (handle)
+		{
+			TEST_CHECK(handle->Size() == entries[i].m_Data.size() && memcmp(handle->Buffer(), entries[i].m_Data.data(), entries[i].m_Data.size()) == 0);
+		}
+	}
+
+	shared_ptr<ResHandle> xmlHandle = requested.back().m_pHandle;
+	shared_ptr<XmlResourceExtraData> pXml = xmlHandle ? static_pointer_cast<XmlResourceExtraData>(xmlHandle->GetExtraData()) : nullptr;
+	if (TEST_CHECK(pXml && pXml->GetRoot()))
+	{
+		TEST_CHECK(strcmp(pXml->GetRoot()->Value(), "Actor") == 0);
+		TEST_CHECK(pXml->GetRoot()->FirstChildElement("TransformComponent") != nullptr);
+	}
+
+	// Loaded already, the callback runs right away and nothing is read
+	Requested hit;
+	Resource r(XML_NAME);
+	cache.GetHandleAsync(&r, Record(hit));
+	TEST_CHECK(hit.m_Calls == 1 && hit.m_pHandle == xmlHandle);
+	TEST_CHECK(!cache.HasPendingLoads());
+	TEST_CHECK(cache.GetLoadProfiler()->GetLoadCount() == entries.size() + 1);
+}
@@ -0,0 +1,74 @@
+#include "Tests.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "../TinyEngine/ResourceCache/EvictionPolicy.h"
+
+// A 1MB cache with room for three of the 300KB entries. Held and pinned handles are never
+// evicted, and a load that only fits by dropping one fails with ResLoad_BudgetExhausted.
+
+namespace
+{
+	const uint32_t ENTRY_SIZE = 300 * 1024;
+	const char* POLICIES[] = { "lru", "lfu", "2q" };
+}
+
+void TestEvictHeldAndPinned()
+{
+	std::vector<TestEntry> entries = MakeTestEntries(5, [](uint32_t) { return ENTRY_SIZE; });
+	for (TestEntry& entry : entries)
+	{
+		// Stored entries are views of the mapped file and don't count against the budget
+		entry.m_IsDeflated = true;
+	}
+
+	boost::filesystem::path zipFile = GetTestDirectory("eviction") / "eviction.zip";
+	if (!TEST_CHECK(WriteTestZip(zipFile, entries)))
+		return;
+
+	for (const char* policy : POLICIES)
+	{
+		ResCache cache(1, "", true, zipFile.string());
+		if (!TEST_CHECK(cache.Init()))
+			return;
+		cache.SetEvictionPolicy(CreateEvictionPolicy(policy));
+
+		Resource a(entries[0].m_Name), b(entries[1].m_Name), c(entries[2].m_Name), d(entries[3].m_Name), e(entries[4].m_Name);
+		shared_ptr<ResHandle> heldA = cache.GetHandle(&a);
+		TEST_CHECK(heldA);
+
+		weak_ptr<ResHandle> weakB;
+		{
+			shared_ptr<ResHandle> pinnedB = cache.GetHandle(&b);
+			TEST_CHECK(pinnedB);
+			pinnedB->Pin();
+			weakB = pinnedB;
+		}
+		weak_ptr<ResHandle> weakC = cache.GetHandle(&c);
+
+		// a held and b pinned, d only fits in place of c
+		shared_ptr<ResHandle> heldD = cache.GetHandle(&d);
+		TEST_CHECK(heldD);
+		TEST_CHECK(!weakB.expired());
+		TEST_CHECK(weakC.expired());
+		TEST_CHECK(cache.GetHandle(&a) == heldA);
+
+		// Nothing left to evict
+		TEST_CHECK(!cache.GetHandle(&e));
+		TEST_CHECK(cache.GetLastLoadStatus() == ResLoad_BudgetExhausted);
+
+		// Unpinned and released, b makes room for e
+		shared_ptr<ResHandle> unpinnedB = cache.GetHandle(&b);
+		TEST_CHECK(unpinnedB == weakB.lock());
+		unpinnedB->Unpin();
+		unpinnedB.reset();
+
+		shared_ptr<ResHandle> heldE = cache.GetHandle(&e);
+		TEST_CHECK(heldE);
+		TEST_CHECK(weakB.expired());
+		TEST_CHECK(cache.GetHandle(&a) == heldA);
+		TEST_CHECK(cache.GetHandle(&d) == heldD);
+		if (heldE)
+		{
+			TEST_CHECK(heldE->Size() == ENTRY_SIZE && memcmp(heldE->Buffer(), entries[4].m_Data.data(), ENTRY_SIZE) == 0);
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#include "Tests.h"
+#include "../TinyEngine/ResourceCache/ResCache.h"
+#include "../TinyEngine/Utilities/ThreadPool.h"
+#include <random>
+
+// Entries around the block size written with PackFileWriter and read back whole, through the
+// stored extent the cache's batched reads use, and in ranges across block boundaries. With and
+// without decode threads, mapped and positional.
+
+namespace
+{
+	const uint32_t BLOCK_SIZE = 64 * 1024;
+	const uint32_t ENTRY_SIZES[] =
+	{
+		1, 4095, 4096, BLOCK_SIZE - 1, BLOCK_SIZE, BLOCK_SIZE + 1, 2 * BLOCK_SIZE, 3 * BLOCK_SIZE + 17, 10 * BLOCK_SIZE + 5,
+	};
+	// One more, half noise, the entry deflates but its noise blocks don't and are stored
+	const uint32_t NOISE_SIZE = 4 * BLOCK_SIZE + 3;
+
+	bool IsSame(const std::vector<char>& read, const char* pExpected, size_t size)
+	{
+		return read.size() == size && memcmp(read.data(), pExpected, size) == 0;
+	}
+
+	void CheckEntry(ResourcePackFile& pack, const TestEntry& entry)
+	{
+		Resource r(entry.m_Name);
+		uint64_t size = entry.m_Data.size();
+		if (!TEST_CHECK(pack.VGetRawResourceSize(r) == (int64_t)size))
+			return;
+
+		std::vector<char> read(size);
+		TEST_CHECK(pack.VGetRawResource(r, read.data()) == (int64_t)size && IsSame(read, entry.m_Data.data(), size));
+
+		uint64_t storedOffset = 0;
+		uint64_t storedSize = 0;
+		if (TEST_CHECK(pack.VGetStoredExtent(r, storedOffset, storedSize)))
+		{
+			std::vector<char> stored((size_t)storedSize);
+			std::fill(read.begin(), read.end(), 0);
+			TEST_CHECK(pack.VReadStored(storedOffset, stored.data(), stored.size()));
+			TEST_CHECK(pack.VDecodeStored(r, stored.data(), storedSize, read.data()) == (int64_t)size && IsSame(read, entry.m_Data.data(), size));
+		}
+
+		// A single deflate stream only decodes from its start, ranges are for stored and block entries
+		if (entry.m_IsDeflated && size <= BLOCK_SIZE)
+			return;
+
+		const uint64_t ranges[][2] =
+		{
+			{ 0, size },
+			{ 0, 1 },
+			{ size - 1, 1 },
+			{ size / 2, size - size / 2 },
+			{ BLOCK_SIZE - 1, 2 },
+			{ BLOCK_SIZE, BLOCK_SIZE },
+			{ BLOCK_SIZE + 1, 2 * BLOCK_SIZE },
+		};
+		for (const auto& range : ranges)
+		{
+			uint64_t offset = range[0];
+			uint64_t rangeSize = range[1];
+			if (offset >= size || rangeSize > size - offset)
+				continue;
+
+			read.assign((size_t)rangeSize, 0);
+			TEST_CHECK(pack.VGetRawResourceRange(r, offset, rangeSize, read.data()) == (int64_t)rangeSize &&
+				IsSame(read, entry.m_Data.data() + offset, (size_t)rangeSize));
+		}
+
+		// Past the end is refused rather than read short
+		read.assign(2, 0);
+		TEST_CHECK(pack.VGetRawResourceRange(r, size - 1, 2, read.data()) == 0);
+	}
+}
+
+void TestPackRoundTrip()
+{
+	std::vector<TestEntry> entries = MakeTestEntries(_countof(ENTRY_SIZES) * 2, [](uint32_t i) { return ENTRY_SIZES[i / 2]; });
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		// Every size both stored and deflated
+		entries[i].m_IsDeflated = (i % 2 != 0);
+	}
+
+	TestEntry noise;
+	noise.m_Name = "test/noise.bin";
+	noise.m_Data.resize(NOISE_SIZE);
+	FillTestData(noise.m_Data.data(), 2 * BLOCK_SIZE, NOISE_SIZE);
+	std::mt19937 random(NOISE_SIZE);
+	std::generate(noise.m_Data.begin() + 2 * BLOCK_SIZE, noise.m_Data.end(), [&random]() { return (char)random(); });
+	noise.m_IsDeflated = true;
+	entries.push_back(noise);
+
+	boost::filesystem::path packFile = GetTestDirectory("pack") / "roundtrip.pak";
+	if (!TEST_CHECK(WriteTestPack(packFile, entries, BLOCK_SIZE)))
+		return;
+
+	ThreadPool threads;
+	const FileReaderType readerTypes[] = { FileReader_Mapped, FileReader_Blocking };
+	for (FileReaderType readerType : readerTypes)
+	{
+		for (ThreadPool* pThreads : { (ThreadPool*)nullptr, &threads })
+		{
+			ResourcePackFile pack(packFile.wstring());
+			pack.VSetFileReader(readerType);
+			pack.VSetDecodeThreads(pThreads);
+			if (!TEST_CHECK(pack.VOpen()))
+				continue;
+			TEST_CHECK(pack.VGetNumResources() == (int)entries.size());
+
+			for (const TestEntry& entry : entries)
+			{
+				CheckEntry(pack, entry);
+			}
+		}
+	}
+}
+
+void TestPackLongName()
+{
+	boost::filesystem::path directory = GetTestDirectory("pack_long_name");
+	std::vector<TestEntry> entries = MakeTestEntries(1, [](uint32_t) { return 100; });
+	if (!TEST_CHECK(WriteTestPack(directory / "short.pak", entries)))
+		return;
+
+	// Too long for the table of contents, refused rather than cut short
+	PackFileWriter writer;
+	writer.AddFile(std::string(UINT16_MAX + 1, 'a'), (directory / "assets" / entries[0].m_Name).wstring(), PackCodec_Stored);
+	TEST_CHECK(!writer.Write((directory / "long.pak").wstring()));
+	TEST_CHECK(!writer.GetLastError().empty());
+}
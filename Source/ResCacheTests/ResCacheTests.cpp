@@ -0,0 +1,56 @@
+// Resource cache tests, headless, no renderer and no project needed
+//
+//   ResCacheTests [test]...
+//
+// Runs the named tests, or all of them, and returns the number that failed.
+
+#include "Tests.h"
+#include <iostream>
+
+namespace
+{
+	struct Test
+	{
+		const char* m_Name;
+		void(*m_pRun)();
+	};
+
+	const Test TESTS[] =
+	{
+		{ "zip_parallel_reads", TestZipParallelReads },
+		{ "evict_held_and_pinned", TestEvictHeldAndPinned },
+		{ "async_loads", TestAsyncLoads },
+		{ "pack_round_trip", TestPackRoundTrip },
+		{ "pack_long_name", TestPackLongName },
+	};
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	Logger::Init(nullptr);
+	std::vector<std::string> names;
+	for (int i = 1; i < argc; ++i)
+	{
+		names.push_back(Utility::WS2S(argv[i]));
+	}
+
+	int failedTests = 0;
+	int ranTests = 0;
+	for (const Test& test : TESTS)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), test.m_Name) == names.end())
+			continue;
+
+		uint32_t failedChecks = GetFailedCheckCount();
+		std::cout << test.m_Name << std::endl;
+		test.m_pRun();
+		bool isPassed = (GetFailedCheckCount() == failedChecks);
+		std::cout << (isPassed ? "  passed" : "  FAILED") << std::endl;
+		failedTests += isPassed ? 0 : 1;
+		ranTests++;
+	}
+
+	std::cout << ranTests - failedTests << " of " << ranTests << " tests passed" << std::endl;
+	Logger::Destroy();
+	return failedTests;
+}
@@ -0,0 +1,184 @@
+#include "Tests.h"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/fstream.hpp"
+#include <zlib.h>
+#include <random>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+	uint32_t s_FailedChecks = 0;
+
+	template <class Type>
+	void Put(std::vector<char>& out, Type value)
+	{
+		// Zip fields are little endian, as is every platform the engine runs on
+		const char* pValue = reinterpret_cast<const char*>(&value);
+		out.insert(out.end(), pValue, pValue + sizeof(value));
+	}
+
+	bool DeflateRaw(const std::vector<char>& data, std::vector<char>& packed)
+	{
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return false;
+
+		packed.resize(deflateBound(&stream, (uLong)data.size()));
+		stream.next_in = (Bytef*)data.data();
+		stream.avail_in = (uInt)data.size();
+		stream.next_out = (Bytef*)packed.data();
+		stream.avail_out = (uInt)packed.size();
+		int result = deflate(&stream, Z_FINISH);
+		packed.resize(stream.total_out);
+		deflateEnd(&stream);
+		return result == Z_STREAM_END;
+	}
+}
+
+bool CheckTest(bool isPassed, const char* expression, const char* file, int line)
+{
+	if (!isPassed)
+	{
+		s_FailedChecks++;
+		std::cout << "  " << fs::path(file).filename().string() << "(" << line << "): " << expression << std::endl;
+	}
+	return isPassed;
+}
+
+uint32_t GetFailedCheckCount()
+{
+	return s_FailedChecks;
+}
+
+fs::path GetTestDirectory(const std::string& name)
+{
+	fs::path directory = fs::temp_directory_path() / "ResCacheTests" / name;
+	boost::system::error_code error;
+	fs::remove_all(directory, error);
+	fs::create_directories(directory, error);
+	return directory;
+}
+
+void FillTestData(char* pData, size_t size, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	size_t i = 0;
+	while (i < size)
+	{
+		uint32_t value = random();
+		size_t run = std::min<size_t>(1 + ((value >> 4) & 3), size - i);
+		memset(pData + i, 'a' + (value & 15), run);
+		i += run;
+	}
+}
+
+std::vector<TestEntry> MakeTestEntries(uint32_t count, const std::function<uint32_t(uint32_t)>& sizeOf)
+{
+	std::vector<TestEntry> entries(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		std::ostringstream name;
+		name << "test/" << std::setw(4) << std::setfill('0') << i << ".bin";
+		entries[i].m_Name = name.str();
+		entries[i].m_Data.resize(sizeOf(i));
+		FillTestData(entries[i].m_Data.data(), entries[i].m_Data.size(), i);
+		entries[i].m_IsDeflated = (i % 4 != 0);
+	}
+	return entries;
+}
+
+bool WriteTestZip(const fs::path& zipFile, const std::vector<TestEntry>& entries)
+{
+	std::vector<char> archive;
+	std::vector<char> directory;
+	for (const TestEntry& entry : entries)
+	{
+		std::vector<char> packed;
+		if (entry.m_IsDeflated && !DeflateRaw(entry.m_Data, packed))
+			return false;
+
+		const std::vector<char>& stored = entry.m_IsDeflated ? packed : entry.m_Data;
+		uint32_t crc = crc32(0, (const Bytef*)entry.m_Data.data(), (uInt)entry.m_Data.size());
+		uint16_t method = entry.m_IsDeflated ? Z_DEFLATED : 0;
+		uint32_t headerOffset = (uint32_t)archive.size();
+
+		Put<uint32_t>(archive, 0x04034b50);
+		Put<uint16_t>(archive, 20);
+		Put<uint16_t>(archive, 0);
+		Put<uint16_t>(archive, method);
+		Put<uint32_t>(archive, 0);
+		Put<uint32_t>(archive, crc);
+		Put<uint32_t>(archive, (uint32_t)stored.size());
+		Put<uint32_t>(archive, (uint32_t)entry.m_Data.size());
+		Put<uint16_t>(archive, (uint16_t)entry.m_Name.size());
+		Put<uint16_t>(archive, 0);
+		archive.insert(archive.end(), entry.m_Name.begin(), entry.m_Name.end());
+		archive.insert(archive.end(), stored.begin(), stored.end());
+
+		Put<uint32_t>(directory, 0x02014b50);
+		Put<uint16_t>(directory, 20);
+		Put<uint16_t>(directory, 20);
+		Put<uint16_t>(directory, 0);
+		Put<uint16_t>(directory, method);
+		Put<uint32_t>(directory, 0);
+		Put<uint32_t>(directory, crc);
+		Put<uint32_t>(directory, (uint32_t)stored.size());
+		Put<uint32_t>(directory, (uint32_t)entry.m_Data.size());
+		Put<uint16_t>(directory, (uint16_t)entry.m_Name.size());
+		Put<uint16_t>(directory, 0);
+		Put<uint16_t>(directory, 0);
+		Put<uint16_t>(directory, 0);
+		Put<uint16_t>(directory, 0);
+		Put<uint32_t>(directory, 0);
+		Put<uint32_t>(directory, headerOffset);
+		directory.insert(directory.end(), entry.m_Name.begin(), entry.m_Name.end());
+	}
+
+	uint32_t directoryOffset = (uint32_t)archive.size();
+	archive.insert(archive.end(), directory.begin(), directory.end());
+	Put<uint32_t>(archive, 0x06054b50);
+	Put<uint16_t>(archive, 0);
+	Put<uint16_t>(archive, 0);
+	Put<uint16_t>(archive, (uint16_t)entries.size());
+	Put<uint16_t>(archive, (uint16_t)entries.size());
+	Put<uint32_t>(archive, (uint32_t)directory.size());
+	Put<uint32_t>(archive, directoryOffset);
+	Put<uint16_t>(archive, 0);
+
+	fs::ofstream file(zipFile, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(archive.data(), archive.size());
+	file.close();
+	return !file.fail();
+}
+
+bool WriteTestPack(const fs::path& packFile, const std::vector<TestEntry>& entries, uint32_t blockSize)
+{
+	fs::path assetDir = packFile.parent_path() / "assets";
+	PackFileWriter writer(PackHeader::DEFAULT_PAGE_SIZE, blockSize);
+	for (const TestEntry& entry : entries)
+	{
+		fs::path assetFile = assetDir / entry.m_Name;
+		boost::system::error_code error;
+		fs::create_directories(assetFile.parent_path(), error);
+
+		fs::ofstream file(assetFile, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(entry.m_Data.data(), entry.m_Data.size());
+		file.close();
+		if (file.fail())
+			return false;
+
+		writer.AddFile(entry.m_Name, assetFile.wstring(), entry.m_IsDeflated ? PackCodec_Deflate : PackCodec_Stored);
+	}
+
+	if (!writer.Write(packFile.wstring()))
+	{
+		std::cout << "  " << writer.GetLastError() << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "../TinyEngine/TinyEngineBase.h"
+#include "../TinyEngine/ResourceCache/PackFile.h"
+#include "boost/filesystem/path.hpp"
+
+// Helpers shared by the tests. Each test builds the archives it reads in a directory of its
+// own under the test directory and checks what it reads back against what it wrote.
+
+// A failed check is reported and the test carries on, a test passes when none of its checks failed
+#define TEST_CHECK(expr) CheckTest(!!(expr), #expr, __FILE__, __LINE__)
+bool CheckTest(bool isPassed, const char* expression, const char* file, int line);
+uint32_t GetFailedCheckCount();
+
+// %TEMP%\ResCacheTests\<name>, emptied and created
+boost::filesystem::path GetTestDirectory(const std::string& name);
+// Deterministic content that deflates to about half
+void FillTestData(char* pData, size_t size, uint32_t seed);
+
+struct TestEntry
+{
+	std::string m_Name;
+	std::vector<char> m_Data;
+	bool m_IsDeflated;
+};
+
+std::vector<TestEntry> MakeTestEntries(uint32_t count, const std::function<uint32_t(uint32_t)>& sizeOf);
+// A plain zip archive, as any zip tool would write it
+bool WriteTestZip(const boost::filesystem::path& zipFile, const std::vector<TestEntry>& entries);
+// An asset pack through PackFileWriter, the entries are written next to it first
+bool WriteTestPack(const boost::filesystem::path& packFile, const std::vector<TestEntry>& entries,
+	uint32_t blockSize = PackHeader::DEFAULT_BLOCK_SIZE);
+
+void TestAsyncLoads();
+void TestEvictHeldAndPinned();
+void TestPackLongName();
+void TestPackRoundTrip();
+void TestZipParallelReads();
@@ -0,0 +1,70 @@
+#include "Tests.h"
+#include "../TinyEngine/ResourceCache/ZipFile.h"
+#include "boost/thread/thread.hpp"
+#include <zlib.h>
+#include <atomic>
+
+// Every thread reads every entry of the same ZipFile, each starting at a different entry, and
+// checks the CRC of what it read. Mapped and positional reads both.
+
+namespace
+{
+	const uint32_t ENTRY_COUNT = 600;
+	const uint32_t THREAD_COUNT = 8;
+	const uint32_t ROUND_COUNT = 3;
+}
+
+void TestZipParallelReads()
+{
+	std::vector<TestEntry> entries = MakeTestEntries(ENTRY_COUNT, [](uint32_t i) { return 1 + (i * 7919) % (128 * 1024); });
+	boost::filesystem::path zipFile = GetTestDirectory("zip") / "parallel.zip";
+	if (!TEST_CHECK(WriteTestZip(zipFile, entries)))
+		return;
+
+	std::vector<uint32_t> crcs;
+	for (const TestEntry& entry : entries)
+	{
+		crcs.push_back(crc32(0, (const Bytef*)entry.m_Data.data(), (uInt)entry.m_Data.size()));
+	}
+
+	const FileReaderType readerTypes[] = { FileReader_Mapped, FileReader_Blocking };
+	for (FileReaderType readerType : readerTypes)
+	{
+		ZipFile zip;
+		if (!TEST_CHECK(zip.Init(zipFile.wstring(), readerType)))
+			continue;
+		if (!TEST_CHECK(zip.GetNumFiles() == (int)ENTRY_COUNT))
+			continue;
+
+		std::atomic<uint32_t> reads(0);
+		std::atomic<uint32_t> failures(0);
+		boost::thread_group threads;
+		for (uint32_t t = 0; t < THREAD_COUNT; ++t)
+		{
+			threads.create_thread([&zip, &crcs, &entries, &reads, &failures, t]()
+			{
+				std::vector<char> buffer;
+				for (uint32_t round = 0; round < ROUND_COUNT; ++round)
+				{
+					for (uint32_t k = 0; k < ENTRY_COUNT; ++k)
+					{
+						uint32_t entry = (k + t * ENTRY_COUNT / THREAD_COUNT) % ENTRY_COUNT;
+						int i = zip.Find(entries[entry].m_Name);
+						buffer.assign((size_t)std::max<int64_t>(zip.GetFileLen(i), 0), 0);
+						bool isRead = (i >= 0) && zip.ReadFile(i, buffer.data());
+						if (!isRead || buffer.size() != entries[entry].m_Data.size() ||
+							crc32(0, (const Bytef*)buffer.data(), (uInt)buffer.size()) != crcs[entry])
+						{
+							failures++;
+						}
+						reads++;
+					}
+				}
+			});
+		}
+		threads.join_all();
+
+		TEST_CHECK(reads == THREAD_COUNT * ROUND_COUNT * ENTRY_COUNT);
+		TEST_CHECK(failures == 0);
+	}
+}
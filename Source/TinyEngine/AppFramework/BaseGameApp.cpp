@@ -3,8 +3,10 @@
 #include "BaseGameLogic.h"
 #include "../Graphics3D/D3D11Renderer.h"
 #include "../ResourceCache/ResCache.h"
+#include "../ResourceCache/FileReader.h"
 #include "../ResourceCache/XmlResource.h"
 #include "../EventManager/EventManagerImpl.h"
+#include "../EventManager/Events.h"
 #include "../ResourceCache/MaterialResource.h"
 
 BaseGameApp* g_pApp = nullptr;
@@ -17,6 +19,8 @@ BaseGameApp::BaseGameApp()
 	m_pGameLogic(nullptr),
 	m_hInstance(nullptr),
 	m_hMainWnd(nullptr),
+	m_hLowMemoryNotification(nullptr),
+	m_IsLowMemory(false),
 	m_pEventManager(nullptr),
 	m_HasModalDialog(false),
 	m_IsExiting(false),
@@ -27,6 +31,10 @@ BaseGameApp::BaseGameApp()
 
 BaseGameApp::~BaseGameApp()
 {
+	if (m_hLowMemoryNotification != nullptr)
+	{
+		CloseHandle(m_hLowMemoryNotification);
+	}
 }
 
 bool BaseGameApp::InitEnvironment()
@@ -268,6 +276,23 @@ void BaseGameApp::OnUpdate(const GameTime& gameTime)
 		PostMessage(m_hMainWnd, WM_CLOSE, 0, 0);
 	}
 
+	if (g_pApp->m_pResCache != nullptr)
+	{
+		g_pApp->m_pResCache->OnUpdate();
+
+		// Give memory back once each time the system starts running low, several editor
+		// windows each hold a cache of their own
+		BOOL isLowMemory = FALSE;
+		if (g_pApp->m_hLowMemoryNotification != nullptr && QueryMemoryResourceNotification(g_pApp->m_hLowMemoryNotification, &isLowMemory))
+		{
+			if (isLowMemory && !g_pApp->m_IsLowMemory)
+			{
+				g_pApp->m_pResCache->Trim(g_pApp->m_Config.m_ResCacheLowMemoryTrim);
+			}
+			g_pApp->m_IsLowMemory = (isLowMemory != FALSE);
+		}
+	}
+
 	if (g_pApp->m_pGameLogic != nullptr)
 	{
 		IEventManager::Get()->VUpdate(20);
@@ -446,6 +471,15 @@ void BaseGameApp::OnClose()
 	{
 		SAFE_DELETE(m_pGameLogic);
 		SAFE_DELETE(m_pEventManager);
+		if (m_pResCache != nullptr && m_pResCache->GetDerivedDataCache() != nullptr)
+		{
+			DEBUG_INFO(m_pResCache->GetDerivedDataCache()->GetStatsReport());
+		}
+		if (m_pResCache != nullptr && m_pResCache->GetLoadProfiler() != nullptr)
+		{
+			DEBUG_INFO(m_pResCache->GetLoadProfiler()->GetSummary());
+			m_pResCache->WriteLoadProfile(m_Config.m_ResCacheLoadProfile);
+		}
 		SAFE_DELETE(m_pResCache);
 	}
 
@@ -462,7 +496,8 @@ bool BaseGameApp::InitResource()
 {
 	if (m_pResCache == nullptr)
 	{
-		m_pResCache = DEBUG_NEW ResCache(50, Utility::GetDirectory(m_Config.m_Project), m_Config.m_IsZipResource);
+		m_pResCache = DEBUG_NEW ResCache(m_Config.m_ResCacheSizeInMb, Utility::GetDirectory(m_Config.m_Project), m_Config.m_IsZipResource, m_Config.m_ResourceFile);
+		m_pResCache->SetFileReader(GetFileReaderType(m_Config.m_ResCacheFileReader));
 
 		if (!m_pResCache->Init())
 		{
@@ -470,6 +505,26 @@ bool BaseGameApp::InitResource()
 			return false;
 		}
 
+		m_pResCache->SetEvictionPolicy(CreateEvictionPolicy(m_Config.m_ResCacheEvictionPolicy));
+		for (const auto& budget : m_Config.m_ResCacheCategoryBudgetsInMb)
+		{
+			m_pResCache->SetCategoryBudget(budget.first, (uint64_t)budget.second * 1024 * 1024);
+		}
+		m_pResCache->SetBorrowAcrossCategories(m_Config.m_IsResCacheBorrowing);
+		m_pResCache->SetCompressedCacheBudget((uint64_t)m_Config.m_ResCacheCompressedSizeInMb * MEGABYTE);
+		m_pResCache->SetLoadProfiling(!m_Config.m_ResCacheLoadProfile.empty());
+		if (!m_Config.m_DerivedDataDir.empty())
+		{
+			shared_ptr<DerivedDataCache> pDerivedData(DEBUG_NEW DerivedDataCache(m_Config.m_DerivedDataDir, (uint64_t)m_Config.m_DerivedDataSizeInMb * MEGABYTE));
+			if (pDerivedData->Open())
+			{
+				m_pResCache->SetDerivedDataCache(pDerivedData);
+			}
+		}
+		if (m_Config.m_ResCacheLowMemoryTrim > 0.0f && m_hLowMemoryNotification == nullptr)
+		{
+			m_hLowMemoryNotification = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+		}
 		m_pResCache->RegisterLoader(CreateDdsResourceLoader());
 		m_pResCache->RegisterLoader(CreateJpgResourceLoader());
 		m_pResCache->RegisterLoader(CreatePngResourceLoader());
@@ -479,16 +534,29 @@ bool BaseGameApp::InitResource()
 		m_pResCache->RegisterLoader(CreateFxSourceEffectResourceLoader());
 		m_pResCache->RegisterLoader(CreateFxObjectEffectResourceLoader());
 		m_pResCache->RegisterLoader(CreateMaterialResourceLoader());
+
+		// Scene nodes rebuild what they made from changed resources before the next frame
+		m_pResCache->SetResourceChangedCallback([](const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected)
+		{
+			IEventManager::Get()->VTriggerEvent(IEventDataPtr(DEBUG_NEW EvtData_Resource_Changed(changed, affected)));
+		});
+		if (m_Config.m_IsResCacheHotReload && m_pResCache->IsUsingDevelopmentDirectories())
+		{
+			m_pResCache->WatchAssetDirectory();
+		}
 	}
 
-	m_pResCache->Preload("*.dds");
-	m_pResCache->Preload("*.jpg");
-	m_pResCache->Preload("*.png");
-	m_pResCache->Preload("*.bmp");
-	m_pResCache->Preload("*.tiff");
-	m_pResCache->Preload("*.fx");
-	m_pResCache->Preload("*.fxo");
-	m_pResCache->Preload("*.mat");
+	std::vector<std::string> preloadPatterns;
+	preloadPatterns.push_back("*.dds");
+	preloadPatterns.push_back("*.jpg");
+	preloadPatterns.push_back("*.png");
+	preloadPatterns.push_back("*.bmp");
+	preloadPatterns.push_back("*.tiff");
+	preloadPatterns.push_back("*.fx");
+	preloadPatterns.push_back("*.fxo");
+	preloadPatterns.push_back("*.mat");
+	ScopedResCallSite callSite(m_pResCache, "Startup preload");
+	m_pResCache->Preload(preloadPatterns);
 	return true;
 }
 
@@ -554,30 +622,21 @@ uint32_t BaseGameApp::AddEffect(const std::string& effectObjectPath, const std::
 uint32_t BaseGameApp::ModifyEffect(const std::string& effectObjectPath, const std::string& effectName)
 {
 	Resource effectRes(effectObjectPath);
-	// first remove the old effect object resource
-	m_pResCache->RemoveHandle(&effectRes);
+	// drop the old effect object, only the scene nodes using it are rebuilt
+	m_pResCache->Reload(std::vector<ResourceId>(1, effectRes.m_Id));
 
-	// use DevelopmentResourceZipFile::AddNewResFile reload the resource
 	shared_ptr<ResHandle> pEffectResHandle = m_pResCache->GetHandle(&effectRes);
 	if (pEffectResHandle != nullptr)
 	{
 		shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(pEffectResHandle->GetExtraData());
 		if (extra != nullptr)
 		{
-			for (auto view : g_pApp->m_pGameLogic->m_GameViews)
-			{
-				view->VOnDeleteGameViews();
-			}
-
-			for (auto view : g_pApp->m_pGameLogic->m_GameViews)
-			{
-				view->VOnInitGameViews();
-			}
-
 			Effect* pEffect = extra->GetEffect();
 			return pEffect->GenerateXml(effectObjectPath, effectName, true);
 		}
 	}
+
+	return 0;
 }
 
 const std::string& BaseGameApp::GetEffectXml(const std::string& effectObjectPath)
@@ -600,8 +659,16 @@ const std::string& BaseGameApp::GetEffectXml(const std::string& effectObjectPath
 void BaseGameApp::ModifyMaterial(const std::string& materialPath, bool withEffect)
 {
 	Resource materialRes(materialPath);
-	// first remove the old material resource
-	m_pResCache->RemoveHandle(&materialRes);
+	if (withEffect)
+	{
+		// the material may use another effect now, the scene nodes using it rebuild their passes
+		m_pResCache->Reload(std::vector<ResourceId>(1, materialRes.m_Id));
+	}
+	else
+	{
+		// only variables changed, they are read from the material every frame
+		m_pResCache->RemoveHandle(&materialRes);
+	}
 
 	// add to resource cache
 	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
@@ -613,17 +680,4 @@ void BaseGameApp::ModifyMaterial(const std::string& materialPath, bool withEffec
 
 		}
 	}
-
-	if (withEffect)
-	{
-		for (auto view : g_pApp->m_pGameLogic->m_GameViews)
-		{
-			view->VOnDeleteGameViews();
-		}
-
-		for (auto view : g_pApp->m_pGameLogic->m_GameViews)
-		{
-			view->VOnInitGameViews();
-		}
-	}
 }
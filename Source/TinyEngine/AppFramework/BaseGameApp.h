@@ -75,6 +75,8 @@ private:
 
 	HINSTANCE m_hInstance;
 	HWND m_hMainWnd;
+	HANDLE m_hLowMemoryNotification;		// signaled while the system is low on physical memory
+	bool m_IsLowMemory;
 
 	GameTime m_GameTime;
 	EventManager* m_pEventManager;
@@ -4,6 +4,7 @@
 #include "../Actors/Actor.h"
 #include "../ResourceCache/XmlResource.h"
 #include "../ResourceCache/MaterialResource.h"
+#include "../ResourceCache/ResCache.h"
 #include "../EventManager/Events.h"
 #include "../UserInterface/HumanView.h"
 
@@ -19,7 +20,9 @@ BaseGameLogic::BaseGameLogic()
 	m_IsProxy(false),
 	m_RemotePlayerId(0),
 	m_IsRenderDiagnostics(false),
-	m_pPhysics(nullptr)
+	m_pPhysics(nullptr),
+	m_ManifestFile(),
+	m_ManifestFramesLeft(0)
 {
 // 	m_pProjectManager = DEBUG_NEW ProjectManager;
 // 	DEBUG_ASSERT(m_pProjectManager);
@@ -80,6 +83,7 @@ bool BaseGameLogic::VLoadGame(const std::string& projectFile)
 		return false;
 	}
 
+	ScopedResCallSite callSite(g_pApp->GetResCache(), "Project load");
 	std::string assetFile = projectFile;
 	assetFile.replace(assetFile.find_last_of('.'), assetFile.length(), ".asset");
 	LoadAssets(assetFile);
@@ -278,6 +282,11 @@ void BaseGameLogic::VOnUpdate(const GameTime& gameTime)
 	case BGS_Running:
 // 		m_pProcessManager->UpdateProcesses(gameTime);
 
+		if (m_ManifestFramesLeft > 0 && --m_ManifestFramesLeft == 0)
+		{
+			SaveManifest();
+		}
+
 		if (m_pPhysics && !m_IsProxy)
 		{
 			m_pPhysics->VOnUpdate(gameTime);
@@ -610,36 +619,93 @@ bool BaseGameLogic::CreateDefaultAsset(const std::string& asset)
 
 bool BaseGameLogic::LoadAssets(const std::string& asset)
 {
+	ResCache* pResCache = g_pApp->GetResCache();
+	std::vector<ResourceId> manifest;
+
+	// A manifest from an earlier load knows what the project really uses. Without one the
+	// assets the project declares are the best guess.
+	m_ManifestFile = asset;
+	m_ManifestFile.replace(m_ManifestFile.find_last_of('.'), m_ManifestFile.length(), ".manifest");
+	tinyxml2::XMLDocument manifestDoc;
+	if (manifestDoc.LoadFile(m_ManifestFile.c_str()) == tinyxml2::XML_SUCCESS && manifestDoc.RootElement() != nullptr)
+	{
+		for (tinyxml2::XMLElement* pNode = manifestDoc.RootElement()->FirstChildElement("Resource"); pNode; pNode = pNode->NextSiblingElement("Resource"))
+		{
+			if (pNode->GetText() != nullptr)
+			{
+				manifest.push_back(ResourceId(pNode->GetText()));
+			}
+		}
+	}
+
 	unique_ptr<tinyxml2::XMLDocument> pDoc = unique_ptr<tinyxml2::XMLDocument>(DEBUG_NEW tinyxml2::XMLDocument());
-	if (pDoc == nullptr || (pDoc->LoadFile(asset.c_str()) != tinyxml2::XML_SUCCESS))
+	bool isLoaded = pDoc != nullptr && (pDoc->LoadFile(asset.c_str()) == tinyxml2::XML_SUCCESS) && pDoc->RootElement() != nullptr;
+	if (!isLoaded)
 	{
 		DEBUG_ERROR("Failed to parse asset file: " + asset);
-		return false;
 	}
+	else if (manifest.empty())
+	{
+		tinyxml2::XMLElement *pRoot = pDoc->RootElement();
+		tinyxml2::XMLElement* pEffects = pRoot->FirstChildElement("Effects");
+		for (tinyxml2::XMLElement* pNode = (pEffects != nullptr) ? pEffects->FirstChildElement() : nullptr; pNode; pNode = pNode->NextSiblingElement())
+		{
+			if (pNode->Attribute("object") != nullptr)
+			{
+				manifest.push_back(ResourceId(pNode->Attribute("object")));
+			}
+		}
 
-	tinyxml2::XMLElement *pRoot = pDoc->RootElement();
-	if (pRoot == nullptr)
+		const char* sections[] = { "Materials", "Models", "Textures" };
+		for (const char* section : sections)
+		{
+			tinyxml2::XMLElement* pSection = pRoot->FirstChildElement(section);
+			for (tinyxml2::XMLElement* pNode = (pSection != nullptr) ? pSection->FirstChildElement() : nullptr; pNode; pNode = pNode->NextSiblingElement())
+			{
+				if (pNode->GetText() != nullptr)
+				{
+					manifest.push_back(ResourceId(pNode->GetText()));
+				}
+			}
+		}
+	}
+
+	if (pResCache != nullptr)
 	{
-		return false;
+		ScopedResCallSite callSite(pResCache, "Asset manifest prefetch");
+		pResCache->Prefetch(manifest);
+		pResCache->StartRecording();
+		m_ManifestFramesLeft = MANIFEST_RECORD_FRAMES;
 	}
 
-// 	tinyxml2::XMLElement* pEffects = pRoot->FirstChildElement("Effects");
-// 	if (pEffects != nullptr)
-// 	{
-// 	}
-// 
-// 	tinyxml2::XMLElement* pMaterials = pRoot->FirstChildElement("Materials");
-// 	if (pMaterials != nullptr)
-// 	{
-// 	}
-// 
-// 	tinyxml2::XMLElement* pModels = pRoot->FirstChildElement("Models");
-// 	if (pModels)
-// 	{
-// 		for (tinyxml2::XMLElement* pNode = pModels->FirstChildElement(); pNode; pNode = pNode->NextSiblingElement())
-// 		{
-// 		}
-// 	}
+	return isLoaded;
+}
 
-	return true;
+void BaseGameLogic::SaveManifest()
+{
+	ResCache* pResCache = g_pApp->GetResCache();
+	if (pResCache == nullptr || !pResCache->IsRecording())
+		return;
+
+	const ResRecordingStats& stats = pResCache->GetRecordingStats();
+	DEBUG_INFO("Asset manifest: " + std::to_string(stats.m_Requested) + " resources used while loading, " +
+		std::to_string(stats.m_PrefetchHits) + " first frame misses avoided by prefetching, " +
+		std::to_string(stats.m_Misses) + " still missed");
+
+	std::vector<ResourceId> recorded = pResCache->StopRecording();
+
+	tinyxml2::XMLDocument outDoc;
+	tinyxml2::XMLElement* pRoot = outDoc.NewElement("Manifest");
+	outDoc.InsertEndChild(pRoot);
+	for (const auto& id : recorded)
+	{
+		tinyxml2::XMLElement* pResource = outDoc.NewElement("Resource");
+		pResource->SetText(id.GetName().c_str());
+		pRoot->InsertEndChild(pResource);
+	}
+
+	if (outDoc.SaveFile(m_ManifestFile.c_str()) != tinyxml2::XML_SUCCESS)
+	{
+		DEBUG_WARNING("Failed to save asset manifest: " + m_ManifestFile);
+	}
 }
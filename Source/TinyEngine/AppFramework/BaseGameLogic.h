@@ -117,11 +117,18 @@ protected:
 	bool m_IsRenderDiagnostics;
 	shared_ptr<IGamePhysics> m_pPhysics;
 	ProjectManager* m_pProjectManager;
+	std::string m_ManifestFile;
+	uint32_t m_ManifestFramesLeft;		// 0 when not recording
 
 private:
+	// Resources touched while the project loads and through its first frames are recorded into
+	// a manifest next to the project, the next load prefetches them before creating actors
+	static const uint32_t MANIFEST_RECORD_FRAMES = 30;
+
 	bool CreateDefaultProject(const std::string& project, const std::string& defautAsset);
 	bool CreateDefaultAsset(const std::string& asset);
 	bool LoadAssets(const std::string& asset);
+	void SaveManifest();
 	void AddVariableElement(
 		tinyxml2::XMLDocument& outDoc,
 		tinyxml2::XMLElement* pVariables,
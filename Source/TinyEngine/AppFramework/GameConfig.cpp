@@ -9,6 +9,18 @@ GameConfig::GameConfig()
 	m_IsVSync(true),
 	m_AntiAliasingSample(0),
 	m_IsZipResource(false),
+	m_ResCacheSizeInMb(256),
+	m_ResCacheEvictionPolicy("lru"),
+	m_ResCacheCategoryBudgetsInMb(),
+	m_IsResCacheBorrowing(false),
+	m_ResCacheCompressedSizeInMb(0),
+	m_ResCacheLowMemoryTrim(0.5f),
+	m_IsResCacheHotReload(false),
+	m_ResCacheFileReader("map"),
+	m_ResCacheLoadProfile(),
+	m_DerivedDataDir(),
+	m_DerivedDataSizeInMb(512),
+	m_ResourceFile("Assets.zip"),
 	m_pDocument(nullptr)
 {
 
@@ -75,6 +87,54 @@ void GameConfig::InitConfig(const std::string& xmlFileName, LPWSTR lpCmdLine)
 		if (pNode)
 		{
 			m_IsZipResource = pNode->BoolAttribute("useZipResource");
+			if (pNode->Attribute("resourceFile") != nullptr)
+			{
+				m_ResourceFile = pNode->Attribute("resourceFile");
+			}
+
+			if (pNode->Attribute("sizeInMb") != nullptr)
+			{
+				m_ResCacheSizeInMb = std::max(pNode->IntAttribute("sizeInMb"), 1);
+			}
+
+			if (pNode->Attribute("evictionPolicy") != nullptr)
+			{
+				m_ResCacheEvictionPolicy = pNode->Attribute("evictionPolicy");
+			}
+
+			m_IsResCacheBorrowing = pNode->BoolAttribute("borrowAcrossCategories");
+			if (pNode->Attribute("compressedSizeInMb") != nullptr)
+			{
+				m_ResCacheCompressedSizeInMb = std::max(pNode->IntAttribute("compressedSizeInMb"), 0);
+			}
+			if (pNode->Attribute("lowMemoryTrim") != nullptr)
+			{
+				m_ResCacheLowMemoryTrim = std::min(std::max(pNode->FloatAttribute("lowMemoryTrim"), 0.0f), 1.0f);
+			}
+			m_IsResCacheHotReload = pNode->BoolAttribute("hotReload");
+			if (pNode->Attribute("fileReader") != nullptr)
+			{
+				m_ResCacheFileReader = pNode->Attribute("fileReader");
+			}
+			if (pNode->Attribute("loadProfile") != nullptr)
+			{
+				m_ResCacheLoadProfile = pNode->Attribute("loadProfile");
+			}
+			if (pNode->Attribute("derivedDataDir") != nullptr)
+			{
+				m_DerivedDataDir = pNode->Attribute("derivedDataDir");
+			}
+			if (pNode->Attribute("derivedDataSizeInMb") != nullptr)
+			{
+				m_DerivedDataSizeInMb = std::max(pNode->IntAttribute("derivedDataSizeInMb"), 1);
+			}
+			for (tinyxml2::XMLElement* pBudget = pNode->FirstChildElement("Budget"); pBudget != nullptr; pBudget = pBudget->NextSiblingElement("Budget"))
+			{
+				if (pBudget->Attribute("category") != nullptr)
+				{
+					m_ResCacheCategoryBudgetsInMb.push_back(std::make_pair(std::string(pBudget->Attribute("category")), (uint32_t)std::max(pBudget->IntAttribute("sizeInMb"), 0)));
+				}
+			}
 		}
 	}
 }
@@ -20,6 +20,18 @@ public:
 	uint32_t m_AntiAliasingSample;
 
 	bool m_IsZipResource;
+	uint32_t m_ResCacheSizeInMb;		// raw and decoded resources together
+	std::string m_ResCacheEvictionPolicy;		// "lru", "lfu" or "2q"
+	std::vector<std::pair<std::string, uint32_t> > m_ResCacheCategoryBudgetsInMb;
+	bool m_IsResCacheBorrowing;		// categories may go past their budget into unused cache memory
+	uint32_t m_ResCacheCompressedSizeInMb;		// second tier for evicted raw resources, 0 to turn it off
+	float m_ResCacheLowMemoryTrim;		// share of the cache kept when the system runs low on memory, 0 to never trim
+	bool m_IsResCacheHotReload;		// reload assets changed on disk, development directories only
+	std::string m_ResCacheFileReader;		// "map", "blocking", "threads" or "io_uring"
+	std::string m_ResCacheLoadProfile;		// load timings written here at shutdown, .json or .csv, empty to not profile
+	std::string m_DerivedDataDir;		// compiled effects and parsed models kept between runs, empty to turn it off
+	uint32_t m_DerivedDataSizeInMb;
+	std::string m_ResourceFile;		// packaged resources, a .zip archive or a .pak asset pack
 
 	unique_ptr<tinyxml2::XMLDocument> m_pDocument;
 };
@@ -5,6 +5,7 @@ const EventType EvtData_Destroy_Actor::sk_EventType(0xe770151c);
 const EventType EvtData_Move_Actor::sk_EventType(0xb8164362);
 const EventType EvtData_New_Render_Component::sk_EventType(0x5f50fe63);
 const EventType EvtData_Modified_Render_Component::sk_EventType(0x60614b7b);
+const EventType EvtData_Resource_Changed::sk_EventType(0x3b9e51c4);
 const EventType EvtData_Environment_Loaded::sk_EventType(0xf4fc058a);
 const EventType EvtData_Update_Tick::sk_EventType(0x43fe5e17);
 const EventType EvtData_Remote_Environment_Loaded::sk_EventType(0x5f9e7993);
@@ -1,5 +1,6 @@
 #pragma once
 #include "EventManager.h"
+#include "../ResourceCache/ResourceId.h"
 
 class SceneNode;
 class EvtData_New_Actor : public BaseEventData
@@ -245,6 +246,57 @@ private:
 	ActorId m_ActorId;
 };
 
+// Resource files changed on disk and were dropped from the resource cache. Triggered right away,
+// listeners holding on to data built from the old resources rebuild it before the next frame.
+class EvtData_Resource_Changed : public BaseEventData
+{
+public:
+	EvtData_Resource_Changed() {}
+	explicit EvtData_Resource_Changed(const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected)
+		: m_Changed(changed), m_Affected(affected)
+	{
+
+	}
+
+	virtual void VSerialize(std::ostrstream& out)
+	{
+		DEBUG_ERROR("You should not be serializing resource changes!");
+	}
+
+	virtual EventType VGetEventType() const override
+	{
+		return sk_EventType;
+	}
+
+	virtual IEventDataPtr VCopy() const
+	{
+		return IEventDataPtr(DEBUG_NEW EvtData_Resource_Changed(m_Changed, m_Affected));
+	}
+
+	virtual const char* VGetName() const
+	{
+		return "EvtData_Resource_Changed";
+	}
+
+	// The resources whose files changed
+	const std::vector<ResourceId>& GetChanged() const
+	{
+		return m_Changed;
+	}
+
+	// The changed resources and everything that depends on them
+	const std::vector<ResourceId>& GetAffected() const
+	{
+		return m_Affected;
+	}
+
+	static const EventType sk_EventType;
+
+private:
+	std::vector<ResourceId> m_Changed;
+	std::vector<ResourceId> m_Affected;
+};
+
 
 class EvtData_Environment_Loaded : public BaseEventData
 {
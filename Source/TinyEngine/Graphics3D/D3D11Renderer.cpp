@@ -32,6 +32,133 @@ struct VERTEX_CONSTANT_BUFFER
 	float        mvp[4][4];
 };
 
+// Rough footprint of an effect: the byte code of the shaders its passes use plus its constant buffers
+static uint64_t GetEffectMemorySize(ID3DX11Effect* pEffect)
+{
+	D3DX11_EFFECT_DESC effectDesc;
+	if (pEffect == nullptr || FAILED(pEffect->GetDesc(&effectDesc)))
+		return 0;
+
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < effectDesc.ConstantBuffers; i++)
+	{
+		D3DX11_EFFECT_TYPE_DESC typeDesc;
+		if (SUCCEEDED(pEffect->GetConstantBufferByIndex(i)->GetType()->GetDesc(&typeDesc)))
+		{
+			size += typeDesc.UnpackedSize;
+		}
+	}
+
+	for (uint32_t t = 0; t < effectDesc.Techniques; t++)
+	{
+		ID3DX11EffectTechnique* pTechnique = pEffect->GetTechniqueByIndex(t);
+		D3DX11_TECHNIQUE_DESC techniqueDesc;
+		if (FAILED(pTechnique->GetDesc(&techniqueDesc)))
+			continue;
+
+		for (uint32_t p = 0; p < techniqueDesc.Passes; p++)
+		{
+			ID3DX11EffectPass* pPass = pTechnique->GetPassByIndex(p);
+			D3DX11_PASS_SHADER_DESC passShaders[6] = {};
+			pPass->GetVertexShaderDesc(&passShaders[0]);
+			pPass->GetHullShaderDesc(&passShaders[1]);
+			pPass->GetDomainShaderDesc(&passShaders[2]);
+			pPass->GetGeometryShaderDesc(&passShaders[3]);
+			pPass->GetPixelShaderDesc(&passShaders[4]);
+			pPass->GetComputeShaderDesc(&passShaders[5]);
+
+			for (const D3DX11_PASS_SHADER_DESC& passShader : passShaders)
+			{
+				D3DX11_EFFECT_SHADER_DESC shaderDesc;
+				if (passShader.pShaderVariable != nullptr && passShader.pShaderVariable->IsValid() &&
+					SUCCEEDED(passShader.pShaderVariable->GetShaderDesc(passShader.ShaderIndex, &shaderDesc)))
+				{
+					size += shaderDesc.BytecodeLength;
+				}
+			}
+		}
+	}
+
+	return size;
+}
+
+static uint64_t GetSurfaceSize(DXGI_FORMAT format, uint32_t width, uint32_t height)
+{
+	uint64_t blocks = (uint64_t)std::max(1u, (width + 3) / 4) * std::max(1u, (height + 3) / 4);
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		return blocks * 8;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return blocks * 16;
+	default:
+		break;
+	}
+
+	uint32_t bitsPerPixel = 32;
+	if (format >= DXGI_FORMAT_R32G32B32A32_TYPELESS && format <= DXGI_FORMAT_R32G32B32A32_SINT)
+		bitsPerPixel = 128;
+	else if (format >= DXGI_FORMAT_R32G32B32_TYPELESS && format <= DXGI_FORMAT_R32G32B32_SINT)
+		bitsPerPixel = 96;
+	else if (format >= DXGI_FORMAT_R16G16B16A16_TYPELESS && format <= DXGI_FORMAT_X32_TYPELESS_G8X24_UINT)
+		bitsPerPixel = 64;
+	else if ((format >= DXGI_FORMAT_R8G8_TYPELESS && format <= DXGI_FORMAT_R16_SINT) ||
+		format == DXGI_FORMAT_B5G6R5_UNORM || format == DXGI_FORMAT_B5G5R5A1_UNORM)
+		bitsPerPixel = 16;
+	else if (format >= DXGI_FORMAT_R8_TYPELESS && format <= DXGI_FORMAT_A8_UNORM)
+		bitsPerPixel = 8;
+
+	return (uint64_t)width * height * bitsPerPixel / 8;
+}
+
+static uint64_t GetTextureMemorySize(ID3D11ShaderResourceView* pView)
+{
+	if (pView == nullptr)
+		return 0;
+
+	ID3D11Resource* pResource = nullptr;
+	pView->GetResource(&pResource);
+	if (pResource == nullptr)
+		return 0;
+
+	D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+	pResource->GetType(&dimension);
+
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	uint32_t width = 1, height = 1, depth = 1, mipLevels = 1, arraySize = 1;
+	if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE1D)
+	{
+		D3D11_TEXTURE1D_DESC desc;
+		static_cast<ID3D11Texture1D*>(pResource)->GetDesc(&desc);
+		format = desc.Format; width = desc.Width; mipLevels = desc.MipLevels; arraySize = desc.ArraySize;
+	}
+	else if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		static_cast<ID3D11Texture2D*>(pResource)->GetDesc(&desc);
+		format = desc.Format; width = desc.Width; height = desc.Height; mipLevels = desc.MipLevels; arraySize = desc.ArraySize;
+	}
+	else if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE3D)
+	{
+		D3D11_TEXTURE3D_DESC desc;
+		static_cast<ID3D11Texture3D*>(pResource)->GetDesc(&desc);
+		format = desc.Format; width = desc.Width; height = desc.Height; depth = desc.Depth; mipLevels = desc.MipLevels;
+	}
+	SAFE_RELEASE(pResource);
+
+	uint64_t size = 0;
+	for (uint32_t mip = 0; mip < mipLevels; mip++)
+	{
+		size += GetSurfaceSize(format, std::max(1u, width >> mip), std::max(1u, height >> mip)) * std::max(1u, depth >> mip);
+	}
+	return size * arraySize;
+}
+
 D3D11Renderer::D3D11Renderer()
 	: m_pDevice(nullptr),
 	m_pDeviceContext(nullptr),
@@ -836,15 +963,9 @@ bool D3D11Renderer::VCompileShaderFromMemory(const void* pBuffer, uint32_t lengh
 		return false;
 	}
 
-	uint32_t shaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-#ifdef _DEBUG
-	shaderFlags |= D3DCOMPILE_DEBUG;
-	shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
 	ID3D10Blob* errorMessages = nullptr;
 	HRESULT hr = D3DX11CompileEffectFromMemory(pBuffer, lenght, nullptr, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		shaderFlags, 0, m_pDevice, &pShaderExtra->m_pD3DX11Effect, &errorMessages);
+		GetShaderFlags(), 0, m_pDevice, &pShaderExtra->m_pD3DX11Effect, &errorMessages);
 
 	if (FAILED(hr))
 	{
@@ -855,6 +976,7 @@ bool D3D11Renderer::VCompileShaderFromMemory(const void* pBuffer, uint32_t lengh
 	}
 
 	pShaderExtra->m_pEffect = DEBUG_NEW Effect(m_pDevice, pShaderExtra->m_pD3DX11Effect);
+	pShaderExtra->m_Size = GetEffectMemorySize(pShaderExtra->m_pD3DX11Effect);
 
 	return true;
 }
@@ -880,10 +1002,50 @@ bool D3D11Renderer::VCreateShaderFromMemory(const void* pBuffer, uint32_t length
 	}
 
 	pShaderExtra->m_pEffect = DEBUG_NEW Effect(m_pDevice, pShaderExtra->m_pD3DX11Effect);
+	pShaderExtra->m_Size = GetEffectMemorySize(pShaderExtra->m_pD3DX11Effect);
 
 	return true;
 }
 
+bool D3D11Renderer::VCompileShaderToByteCode(const void* pBuffer, uint32_t length, std::vector<char>& byteCode)
+{
+	// The same compile D3DX11CompileEffectFromMemory does, without creating the effect
+	ID3D10Blob* pByteCode = nullptr;
+	ID3D10Blob* errorMessages = nullptr;
+	HRESULT hr = D3DCompile(pBuffer, length, nullptr, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		"", "fx_5_0", GetShaderFlags(), 0, &pByteCode, &errorMessages);
+
+	if (FAILED(hr))
+	{
+		char* errorMessage = (errorMessages != nullptr ? (char*)errorMessages->GetBufferPointer() : "D3DCompile() failed");
+		DEBUG_ERROR(errorMessage);
+		SAFE_RELEASE(errorMessages);
+		SAFE_RELEASE(pByteCode);
+		return false;
+	}
+
+	const char* pData = (const char*)pByteCode->GetBufferPointer();
+	byteCode.assign(pData, pData + pByteCode->GetBufferSize());
+	SAFE_RELEASE(errorMessages);
+	SAFE_RELEASE(pByteCode);
+	return true;
+}
+
+std::string D3D11Renderer::VGetShaderCompileOptions()
+{
+	return "fx_5_0 " + std::to_string(GetShaderFlags()) + " " + std::to_string(D3D_COMPILER_VERSION);
+}
+
+uint32_t D3D11Renderer::GetShaderFlags()
+{
+	uint32_t shaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+#ifdef _DEBUG
+	shaderFlags |= D3DCOMPILE_DEBUG;
+	shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+	return shaderFlags;
+}
+
 bool D3D11Renderer::VCreateDDSTextureResoure(char *rawBuffer, uint32_t rawSize, shared_ptr<IResourceExtraData> pExtraData)
 {
 	if (m_pDevice == nullptr || m_pDeviceContext == nullptr)
@@ -903,6 +1065,8 @@ bool D3D11Renderer::VCreateDDSTextureResoure(char *rawBuffer, uint32_t rawSize,
 	{
 		return false;
 	}
+
+	pTextureExtra->m_Size = GetTextureMemorySize(pTextureExtra->m_pTexture);
 	return true;
 }
 
@@ -926,5 +1090,6 @@ bool D3D11Renderer::VCreateWICTextureResoure(char *rawBuffer, uint32_t rawSize,
 		return false;
 	}
 
+	pTextureExtra->m_Size = GetTextureMemorySize(pTextureExtra->m_pTexture);
 	return true;
 }
\ No newline at end of file
@@ -29,6 +29,8 @@ public:
 
 	virtual bool VCompileShaderFromMemory(const void* pBuffer, uint32_t lenght, shared_ptr<IResourceExtraData> pExtraData) override;
 	virtual bool VCreateShaderFromMemory(const void* pBuffer, uint32_t lenght, shared_ptr<IResourceExtraData> pExtraData) override;
+	virtual bool VCompileShaderToByteCode(const void* pBuffer, uint32_t length, std::vector<char>& byteCode) override;
+	virtual std::string VGetShaderCompileOptions() override;
 	virtual bool VCreateDDSTextureResoure(char *rawBuffer, uint32_t rawSize, shared_ptr<IResourceExtraData> pExtraData) override;
 	virtual bool VCreateWICTextureResoure(char *rawBuffer, uint32_t rawSize, shared_ptr<IResourceExtraData> pExtraData) override;
 	virtual const std::string& VGetDeviceName() override { return m_DeviceName; }
@@ -41,6 +43,7 @@ private:
 	bool CreateImGuiBuffers();
 	void DeleteImGuiBuffers();
 	void RenderDrawLists();
+	static uint32_t GetShaderFlags();
 
 	D3D_FEATURE_LEVEL m_FeatureLevel;
 	ID3D11Device* m_pDevice;
@@ -41,12 +41,12 @@ HRESULT DebugGizmosNode::VOnInitSceneNode(Scene* pScene)
 
 
 	Resource effectRes("Effects\\DebugAssist.fx");
-	shared_ptr<ResHandle> pEffectResHandle = g_pApp->GetResCache()->GetHandle(&effectRes);
-	if (pEffectResHandle == nullptr)
+	m_pEffectResHandle = g_pApp->GetResCache()->GetHandle(&effectRes);
+	if (m_pEffectResHandle == nullptr)
 	{
 		return S_FALSE;
 	}
-	shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(pEffectResHandle->GetExtraData());
+	shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(m_pEffectResHandle->GetExtraData());
 	if (extra == nullptr)
 	{
 		return S_FALSE;
@@ -54,6 +54,7 @@ private:
 	void ScalePicked(Scene* pScene);
 	void RotatePicked(Scene* pScene);
 
+	shared_ptr<ResHandle> m_pEffectResHandle;		// keeps m_pEffect alive when the effect is reloaded
 	Effect* m_pEffect;
 	Pass* m_pCurrentPass;
 	ID3D11Buffer* m_pVertexBuffer;
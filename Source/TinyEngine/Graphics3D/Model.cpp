@@ -2,6 +2,51 @@
 #include "../Utilities/SpatialSort.h"
 #include <sstream>
 
+namespace
+{
+	// The binary form is read back on the machine that wrote it, so plain copies are enough
+	template <typename T>
+	void Write(std::vector<char>& data, const T& value)
+	{
+		const char* p = (const char*)&value;
+		data.insert(data.end(), p, p + sizeof(T));
+	}
+
+	template <typename T>
+	void WriteArray(std::vector<char>& data, const std::vector<T>& values)
+	{
+		Write(data, (uint32_t)values.size());
+		const char* p = (const char*)values.data();
+		data.insert(data.end(), p, p + values.size() * sizeof(T));
+	}
+
+	template <typename T>
+	bool Read(const char*& pData, const char* pEnd, T& value)
+	{
+		if ((size_t)(pEnd - pData) < sizeof(T))
+			return false;
+
+		memcpy(&value, pData, sizeof(T));
+		pData += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	bool ReadArray(const char*& pData, const char* pEnd, std::vector<T>& values)
+	{
+		uint32_t count = 0;
+		if (!Read(pData, pEnd, count) || (size_t)(pEnd - pData) / sizeof(T) < count)
+			return false;
+
+		values.resize(count);
+		memcpy(values.data(), pData, count * sizeof(T));
+		pData += count * sizeof(T);
+		return true;
+	}
+
+	const uint32_t MODEL_MAGIC = 0x4c444d54;		// "TMDL"
+}
+
 Model::Model(const std::string& filename)
 	: m_Meshes()
 {
@@ -52,6 +97,12 @@ Model::Model(const char* pBuffer, uint32_t length)
 	BoundingSphere::CreateFromBoundingBox(m_Sphere, m_AABox);
 }
 
+Model::Model()
+	: m_Meshes()
+{
+
+}
+
 Model::~Model()
 {
 	for (auto mesh : m_Meshes)
@@ -66,6 +117,40 @@ const std::vector<Mesh*>& Model::GetMeshes() const
 	return m_Meshes;
 }
 
+void Model::Serialize(std::vector<char>& data) const
+{
+	Write(data, MODEL_MAGIC);
+	Write(data, BINARY_VERSION);
+	Write(data, m_AABox);
+	Write(data, m_Sphere);
+	Write(data, (uint32_t)m_Meshes.size());
+	for (auto mesh : m_Meshes)
+	{
+		mesh->Serialize(data);
+	}
+}
+
+unique_ptr<Model> Model::Deserialize(const char* pData, uint64_t size)
+{
+	const char* pEnd = pData + size;
+	uint32_t magic = 0, version = 0, meshCount = 0;
+	unique_ptr<Model> pModel(DEBUG_NEW Model());
+	if (!Read(pData, pEnd, magic) || magic != MODEL_MAGIC || !Read(pData, pEnd, version) || version != BINARY_VERSION ||
+		!Read(pData, pEnd, pModel->m_AABox) || !Read(pData, pEnd, pModel->m_Sphere) || !Read(pData, pEnd, meshCount))
+	{
+		return unique_ptr<Model>();
+	}
+
+	for (uint32_t i = 0; i < meshCount; i++)
+	{
+		Mesh* mesh = DEBUG_NEW Mesh();
+		pModel->m_Meshes.push_back(mesh);
+		if (!mesh->Deserialize(pData, pEnd))
+			return unique_ptr<Model>();
+	}
+	return pModel;
+}
+
 Mesh::Mesh(Model* pModel, const tinyxml2::XMLElement* pMeshNode)
 	: m_PrimitiveType(PT_Unknow),
 	m_Vertices(),
@@ -205,11 +290,72 @@ Mesh::Mesh(std::vector<VertexPositionNormalTexture> vertices, std::vector<uint16
 	CalculateTangentSpace();
 }
 
+Mesh::Mesh()
+	: m_PrimitiveType(PT_Unknow)
+{
+
+}
+
 Mesh::~Mesh()
 {
 
 }
 
+void Mesh::Serialize(std::vector<char>& data) const
+{
+	Write(data, (uint32_t)m_PrimitiveType);
+	WriteArray(data, m_Vertices);
+	WriteArray(data, m_Normals);
+	WriteArray(data, m_Tangents);
+	WriteArray(data, m_BiNormals);
+	Write(data, (uint32_t)m_TextureCoordinates.size());
+	for (const auto& textureCoordinates : m_TextureCoordinates)
+	{
+		WriteArray(data, textureCoordinates);
+	}
+	Write(data, (uint32_t)m_VertexColors.size());
+	for (const auto& vertexColors : m_VertexColors)
+	{
+		WriteArray(data, vertexColors);
+	}
+	WriteArray(data, m_Indices);
+	Write(data, m_AABox);
+	Write(data, m_Sphere);
+}
+
+bool Mesh::Deserialize(const char*& pData, const char* pEnd)
+{
+	uint32_t primitiveType = 0;
+	if (!Read(pData, pEnd, primitiveType) || primitiveType > PT_Triangle)
+		return false;
+	m_PrimitiveType = (PrimitiveType)primitiveType;
+
+	if (!ReadArray(pData, pEnd, m_Vertices) || !ReadArray(pData, pEnd, m_Normals) ||
+		!ReadArray(pData, pEnd, m_Tangents) || !ReadArray(pData, pEnd, m_BiNormals))
+		return false;
+
+	uint32_t count = 0;
+	if (!Read(pData, pEnd, count) || count > (size_t)(pEnd - pData))
+		return false;
+	m_TextureCoordinates.resize(count);
+	for (auto& textureCoordinates : m_TextureCoordinates)
+	{
+		if (!ReadArray(pData, pEnd, textureCoordinates))
+			return false;
+	}
+
+	if (!Read(pData, pEnd, count) || count > (size_t)(pEnd - pData))
+		return false;
+	m_VertexColors.resize(count);
+	for (auto& vertexColors : m_VertexColors)
+	{
+		if (!ReadArray(pData, pEnd, vertexColors))
+			return false;
+	}
+
+	return ReadArray(pData, pEnd, m_Indices) && Read(pData, pEnd, m_AABox) && Read(pData, pEnd, m_Sphere);
+}
+
 void Mesh::CalculateTangentSpace()
 {
 	if (!m_Tangents.empty()) return;
@@ -15,12 +15,22 @@ public:
 	Model(const char* pBuffer, uint32_t length);
 	~Model();
 
+	// Bump when the binary layout written by Serialize changes
+	static const uint32_t BINARY_VERSION = 1;
+
+	// The parsed meshes in a flat binary form, restored much faster than the xml is parsed
+	void Serialize(std::vector<char>& data) const;
+	// nullptr when the data is cut short or otherwise malformed
+	static unique_ptr<Model> Deserialize(const char* pData, uint64_t size);
+
 	const std::vector<Mesh*>& GetMeshes() const;
 
 	const BoundingBox& GetBoundingBox() const { return m_AABox; }
 	const BoundingSphere& GetBoundingSphere() const { return m_Sphere; }
 
 private:
+	Model();
+
 	std::vector<Mesh*> m_Meshes;
 	BoundingBox m_AABox;
 	BoundingSphere m_Sphere;
@@ -28,6 +38,8 @@ private:
 
 class Mesh : public boost::noncopyable
 {
+	friend class Model;
+
 public:
 	Mesh(Model* pModel, const tinyxml2::XMLElement* pMeshNode);
 	Mesh(std::vector<VertexPositionNormalTexture> vertices, std::vector<uint16_t> indices);
@@ -52,6 +64,10 @@ public:
 	const BoundingSphere& GetBoundingSphere() const { return m_Sphere; }
 
 private:
+	Mesh();
+
+	void Serialize(std::vector<char>& data) const;
+	bool Deserialize(const char*& pData, const char* pEnd);
 	void CalculateTangentSpace();
 
 	PrimitiveType m_PrimitiveType;
@@ -25,10 +25,7 @@ ModelNode::ModelNode(
 		m_ModelName = pMeshRender->GetModelName();
 	}
 
-	Resource modelRes(m_ModelName);
-	shared_ptr<ResHandle> pModelResHandle = g_pApp->GetResCache()->GetHandle(&modelRes);
-	m_pModel = unique_ptr<Model>(DEBUG_NEW Model(pModelResHandle->Buffer(), pModelResHandle->Size()));
-	SetBoundingBox(m_pModel->GetBoundingBox());
+	LoadModel();
 }
 
 ModelNode::~ModelNode()
@@ -36,6 +33,49 @@ ModelNode::~ModelNode()
 	VOnDeleteSceneNode(nullptr);
 }
 
+bool ModelNode::LoadModel()
+{
+	Resource modelRes(m_ModelName);
+	shared_ptr<ResHandle> pModelResHandle = g_pApp->GetResCache()->GetHandle(&modelRes);
+	if (pModelResHandle == nullptr)
+	{
+		// Deleted, renamed or still being written, the model already loaded stays until it's back
+		DEBUG_WARNING("Can't load model: " + m_ModelName);
+		return false;
+	}
+
+	const char* pBuffer = pModelResHandle->Buffer();
+	uint32_t size = static_cast<uint32_t>(pModelResHandle->Size());
+
+	// Parsing the xml is slow, the meshes parsed by an earlier run are read back instead
+	m_pModel.reset();
+	shared_ptr<DerivedDataCache> pDerivedData = g_pApp->GetResCache()->GetDerivedDataCache();
+	uint64_t key = 0;
+	std::vector<char> data;
+	if (pDerivedData != nullptr)
+	{
+		key = DerivedDataCache::MakeKey(pBuffer, size, "model", Model::BINARY_VERSION, "");
+		if (pDerivedData->Get(key, data))
+		{
+			m_pModel = Model::Deserialize(data.data(), data.size());
+		}
+	}
+
+	if (m_pModel == nullptr)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_pModel = unique_ptr<Model>(DEBUG_NEW Model(pBuffer, size));
+		if (pDerivedData != nullptr)
+		{
+			data.clear();
+			m_pModel->Serialize(data);
+			pDerivedData->Put(key, data.data(), data.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+	}
+	SetBoundingBox(m_pModel->GetBoundingBox());
+	return true;
+}
+
 HRESULT ModelNode::VOnInitSceneNode(Scene *pScene)
 {
 	VOnDeleteSceneNode(pScene);
@@ -43,23 +83,32 @@ HRESULT ModelNode::VOnInitSceneNode(Scene *pScene)
 	ModelRenderComponent* pMeshRender = static_cast<ModelRenderComponent*>(m_pRenderComponent);
 	if (pMeshRender != nullptr)
 	{
-		m_MaterialNames = pMeshRender->GetMaterialName();
+		const std::vector<std::string>& materialNames = pMeshRender->GetMaterialName();
+		m_MaterialIds.assign(materialNames.begin(), materialNames.end());
 	}
 
+	ResourceId modelId(m_ModelName);
+	for (const auto& materialId : m_MaterialIds)
+	{
+		g_pApp->GetResCache()->AddDependency(modelId, materialId);
+	}
+
+	if (m_pModel == nullptr)
+		return S_FALSE;
+
 	uint32_t meshSize = m_pModel->GetMeshes().size();
 	m_pEffects.resize(meshSize);
 	m_pPasses.resize(meshSize);
 	m_pVertexBuffers.resize(meshSize);
 	m_pIndexBuffers.resize(meshSize);
 	m_IndexCounts.resize(meshSize);
-	DEBUG_ASSERT(m_MaterialNames.size() == meshSize);
+	DEBUG_ASSERT(m_MaterialIds.size() == meshSize);
 
 	for (uint32_t i = 0; i < meshSize; i++)
 	{
 		const tinyxml2::XMLElement* rootNode = nullptr;
 
-		Resource materialRes(m_MaterialNames[i]);
-		shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
+		shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(m_MaterialIds[i]);
 		if (pMaterialResHandle != nullptr)
 		{
 			shared_ptr<XmlResourceExtraData> extra = static_pointer_cast<XmlResourceExtraData>(pMaterialResHandle->GetExtraData());
@@ -71,7 +120,7 @@ HRESULT ModelNode::VOnInitSceneNode(Scene *pScene)
 
 		if (nullptr == rootNode)
 		{
-			DEBUG_ERROR("Material is not exist or valid: " + m_MaterialNames[i]);
+			DEBUG_ERROR("Material is not exist or valid: " + m_MaterialIds[i].GetName());
 			return S_FALSE;
 		}
 
@@ -157,12 +206,14 @@ HRESULT ModelNode::VOnUpdate(Scene* pScene, const GameTime& gameTime)
 
 HRESULT ModelNode::VRender(Scene* pScene, const GameTime& gameTime)
 {
+	if (m_pModel == nullptr)
+		return S_FALSE;
+
 	for (uint32_t i = 0, count = m_pModel->GetMeshes().size(); i < count; i++)
 	{
 		const tinyxml2::XMLElement* rootNode = nullptr;
 
-		Resource materialRes(m_MaterialNames[i]);
-		shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
+		shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(m_MaterialIds[i]);
 		if (pMaterialResHandle != nullptr)
 		{
 			shared_ptr<XmlResourceExtraData> extra = static_pointer_cast<XmlResourceExtraData>(pMaterialResHandle->GetExtraData());
@@ -287,9 +338,8 @@ HRESULT ModelNode::VRender(Scene* pScene, const GameTime& gameTime)
 				const char* resourName = pNode->Attribute("resourcename");
 				if (resourName != nullptr)
 				{
-					std::string textureName = std::string("Textures\\") + resourName;
-					Resource resource(textureName);
-					shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(&resource);
+					ResourceId textureId("Textures\\", resourName);
+					shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(textureId);
 					if (pTextureRes != nullptr)
 					{
 						shared_ptr<D3D11TextureResourceExtraData> extra =
@@ -344,6 +394,9 @@ HRESULT ModelNode::VRender(Scene* pScene, const GameTime& gameTime)
 
 void ModelNode::VPick(Scene* pScene, int cursorX, int cursorY)
 {
+	if (m_pModel == nullptr)
+		return;
+
 	const Matrix& projectMat = pScene->GetCamera()->GetProjectMatrix();
 	float viewX = (2.0f * cursorX / g_pApp->GetGameConfig().m_ScreenWidth - 1.0f) / projectMat.m[0][0];
 	float viewY = (1.0f - 2.0f * cursorY / g_pApp->GetGameConfig().m_ScreenHeight) / projectMat.m[1][1];
@@ -407,3 +460,20 @@ void ModelNode::VPick(Scene* pScene, int cursorX, int cursorY)
 		}
 	}
 }
+
+void ModelNode::VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected)
+{
+	SceneNode::VOnResourceChanged(pScene, changed, affected);
+
+	// The model depends on its materials, they in turn on their effects and textures
+	ResourceId modelId(m_ModelName);
+	if (std::find(affected.begin(), affected.end(), modelId) == affected.end())
+		return;
+
+	// The materials may have changed with it, they are set up again even when the model failed
+	if (std::find(changed.begin(), changed.end(), modelId) != changed.end())
+	{
+		LoadModel();
+	}
+	VOnInitSceneNode(pScene);
+}
@@ -14,8 +14,12 @@ public:
 	virtual HRESULT VOnUpdate(Scene* pScene, const GameTime& gameTime) override;
 	virtual HRESULT VRender(Scene* pScene, const GameTime& gameTime) override;
 	virtual void VPick(Scene* pScene, int cursorX, int cursorY) override;
+	virtual void VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected) override;
 
 private:
+	// Keeps the model loaded before when the resource can't be loaded
+	bool LoadModel();
+
 	std::vector<Effect*> m_pEffects;
 	std::vector<Pass*> m_pPasses;
 	std::vector<ID3D11Buffer*> m_pVertexBuffers;
@@ -24,5 +28,5 @@ private:
 	std::unique_ptr<Model> m_pModel;
 
 	std::string m_ModelName;
-	std::vector<std::string> m_MaterialNames;
+	std::vector<ResourceId> m_MaterialIds;		// resolved once in VOnInitSceneNode, looked up every frame
 };
@@ -22,6 +22,7 @@ Scene::Scene(shared_ptr<IRenderer> pRenderer)
 	pEventMgr->VAddListener(boost::bind(&Scene::NewRenderComponentDelegate, this, _1), EvtData_New_Render_Component::sk_EventType);
 	pEventMgr->VAddListener(boost::bind(&Scene::DestroyActorDelegate, this, _1), EvtData_Destroy_Actor::sk_EventType);
 	pEventMgr->VAddListener(boost::bind(&Scene::ModifiedRenderComponentDelegate, this, _1), EvtData_Modified_Render_Component::sk_EventType);
+	pEventMgr->VAddListener(boost::bind(&Scene::ResourceChangedDelegate, this, _1), EvtData_Resource_Changed::sk_EventType);
 }
 
 Scene::~Scene()
@@ -30,6 +31,7 @@ Scene::~Scene()
 	pEventMgr->VRemoveListener(boost::bind(&Scene::NewRenderComponentDelegate, this, _1), EvtData_New_Render_Component::sk_EventType);
 	pEventMgr->VRemoveListener(boost::bind(&Scene::DestroyActorDelegate, this, _1), EvtData_Destroy_Actor::sk_EventType);
 	pEventMgr->VRemoveListener(boost::bind(&Scene::ModifiedRenderComponentDelegate, this, _1), EvtData_Modified_Render_Component::sk_EventType);
+	pEventMgr->VRemoveListener(boost::bind(&Scene::ResourceChangedDelegate, this, _1), EvtData_Resource_Changed::sk_EventType);
 }
 
 HRESULT Scene::OnUpdate(const GameTime& gameTime)
@@ -158,6 +160,16 @@ void Scene::DestroyActorDelegate(IEventDataPtr pEventData)
 	RemoveChild(pCastEventData->GetActorId());
 }
 
+void Scene::ResourceChangedDelegate(IEventDataPtr pEventData)
+{
+	// Only the nodes built on the changed resources rebuild themselves
+	shared_ptr<EvtData_Resource_Changed> pCastEventData = static_pointer_cast<EvtData_Resource_Changed>(pEventData);
+	if (m_pRootNode != nullptr)
+	{
+		m_pRootNode->VOnResourceChanged(this, pCastEventData->GetChanged(), pCastEventData->GetAffected());
+	}
+}
+
 // void Scene::MoveActorDelegate(IEventDataPtr pEventData)
 // {
 // 	shared_ptr<EvtData_Move_Actor> pCastEventData = static_pointer_cast<EvtData_Move_Actor>(pEventData);
@@ -167,6 +167,14 @@ void SceneNode::VPick(Scene* pScene, int cursorX, int cursorY)
 	}
 }
 
+void SceneNode::VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected)
+{
+	for (auto& child : m_Children)
+	{
+		child->VOnResourceChanged(pScene, changed, affected);
+	}
+}
+
 void SceneNode::SetBoundingBox(const BoundingBox& aabb)
 {
 	m_Properties.m_AABox = aabb;
@@ -283,10 +291,10 @@ GridNode::GridNode(ActorId actorId, WeakBaseRenderComponentPtr renderComponent)
 	}
 
 	Resource effectRes("Effects\\Grid.fx");
-	shared_ptr<ResHandle> pEffectResHandle = g_pApp->GetResCache()->GetHandle(&effectRes);
-	if (pEffectResHandle != nullptr)
+	m_pEffectResHandle = g_pApp->GetResCache()->GetHandle(&effectRes);
+	if (m_pEffectResHandle != nullptr)
 	{
-		shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(pEffectResHandle->GetExtraData());
+		shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(m_pEffectResHandle->GetExtraData());
 		if (extra != nullptr)
 		{
 			m_pEffect = extra->GetEffect();
@@ -434,13 +442,12 @@ HRESULT GeometryNode::VOnInitSceneNode(Scene* pScene)
 	GeometryRenderComponent* pGeometryRender = static_cast<GeometryRenderComponent*>(m_pRenderComponent);
 	if (pGeometryRender != nullptr)
 	{
-		m_MaterialName = pGeometryRender->GetMaterialName();
+		m_MaterialId = ResourceId(pGeometryRender->GetMaterialName());
 	}
 
 	const tinyxml2::XMLElement* rootNode = nullptr;
 
-	Resource materialRes(m_MaterialName);
-	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
+	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(m_MaterialId);
 	if (pMaterialResHandle != nullptr)
 	{
 		shared_ptr<XmlResourceExtraData> extra = static_pointer_cast<XmlResourceExtraData>(pMaterialResHandle->GetExtraData());
@@ -452,7 +459,7 @@ HRESULT GeometryNode::VOnInitSceneNode(Scene* pScene)
 
 	if (nullptr == rootNode)
 	{
-		DEBUG_ERROR("Material is not exist or valid: " + m_MaterialName);
+		DEBUG_ERROR("Material is not exist or valid: " + m_MaterialId.GetName());
 		return S_FALSE;
 	}
 
@@ -523,8 +530,7 @@ HRESULT GeometryNode::VRender(Scene* pScene, const GameTime& gameTime)
 {
 	const tinyxml2::XMLElement* rootNode = nullptr;
 
-	Resource materialRes(m_MaterialName);
-	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(&materialRes);
+	shared_ptr<ResHandle> pMaterialResHandle = g_pApp->GetResCache()->GetHandle(m_MaterialId);
 	if (pMaterialResHandle != nullptr)
 	{
 		shared_ptr<XmlResourceExtraData> extra = static_pointer_cast<XmlResourceExtraData>(pMaterialResHandle->GetExtraData());
@@ -649,9 +655,8 @@ HRESULT GeometryNode::VRender(Scene* pScene, const GameTime& gameTime)
 			const char* resourName = pNode->Attribute("resourcename");
 			if (resourName != nullptr)
 			{
-				std::string textureName = std::string("Textures\\") + resourName;
-				Resource resource(textureName);
-				shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(&resource);
+				ResourceId textureId("Textures\\", resourName);
+				shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(textureId);
 				if (pTextureRes != nullptr)
 				{
 					shared_ptr<D3D11TextureResourceExtraData> extra =
@@ -725,6 +730,17 @@ void GeometryNode::VPick(Scene* pScene, int cursorX, int cursorY)
 	}
 }
 
+void GeometryNode::VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected)
+{
+	SceneNode::VOnResourceChanged(pScene, changed, affected);
+
+	// The material, its effect or one of its textures, the passes are built from the effect
+	if (std::find(affected.begin(), affected.end(), m_MaterialId) != affected.end())
+	{
+		VOnInitSceneNode(pScene);
+	}
+}
+
 void GeometryNode::CreateSphere()
 {
 	SphereRenderComponent* pMeshRender = static_cast<SphereRenderComponent*>(m_pRenderComponent);
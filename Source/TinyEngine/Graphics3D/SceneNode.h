@@ -1,6 +1,7 @@
 #pragma once
 #include "../TinyEngineBase.h"
 #include "../TinyEngineInterface.h"
+#include "../ResourceCache/ResourceId.h"
 #include "d3dx11effect.h"
 #include "GeometricPrimitive.h"
 
@@ -79,6 +80,7 @@ public:
 	virtual bool VRemoveChild(ActorId actorId) override;
 
 	virtual void VPick(Scene* pScene, int cursorX, int cursorY) override;
+	virtual void VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected) override;
 
 protected:
 	void SetBoundingBox(const BoundingBox& aabb);
@@ -128,6 +130,7 @@ private:
 
 	void InitGridVertex();
 
+	shared_ptr<ResHandle> m_pEffectResHandle;		// keeps m_pEffect alive when the effect is reloaded
 	Effect* m_pEffect;
 	Pass* m_pCurrentPass;
 	ID3D11Buffer* m_pVertexBuffer;
@@ -148,6 +151,7 @@ public:
 	virtual HRESULT VOnUpdate(Scene* pScene, const GameTime& gameTime) override;
 	virtual HRESULT VRender(Scene* pScene, const GameTime& gameTime) override;
 	virtual void VPick(Scene* pScene, int cursorX, int cursorY) override;
+	virtual void VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected) override;
 
 private:
 	void CreateSphere();
@@ -162,7 +166,7 @@ private:
 	uint32_t m_IndexCount;
 	std::unique_ptr<Mesh> m_Mesh;
 
-	std::string m_MaterialName;
+	ResourceId m_MaterialId;
 
 	static const std::string m_Sphere;
 	static const std::string m_Torus;
@@ -18,14 +18,14 @@ SkyboxNode::SkyboxNode(ActorId actorId, WeakBaseRenderComponentPtr renderCompone
 	SkyboxRenderComponent* pSkyboxRender = static_cast<SkyboxRenderComponent*>(m_pRenderComponent);
 	if (pSkyboxRender != nullptr)
 	{
-		m_TextureName = pSkyboxRender->GetTextureName();
+		m_TextureId = ResourceId(pSkyboxRender->GetTextureName());
 	}
 
 	Resource effectRes("Effects\\Skybox.fx");
-	shared_ptr<ResHandle> pEffectResHandle = g_pApp->GetResCache()->GetHandle(&effectRes);
-	if (pEffectResHandle != nullptr)
+	m_pEffectResHandle = g_pApp->GetResCache()->GetHandle(&effectRes);
+	if (m_pEffectResHandle != nullptr)
 	{
-		shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(pEffectResHandle->GetExtraData());
+		shared_ptr<HlslResourceExtraData> extra = static_pointer_cast<HlslResourceExtraData>(m_pEffectResHandle->GetExtraData());
 		if (extra != nullptr)
 		{
 			m_pEffect = extra->GetEffect();
@@ -103,8 +103,7 @@ HRESULT SkyboxNode::VRender(Scene* pScene, const GameTime& gameTime)
 		}
 		else if (variable->GetVariableType() == "TextureCube")
 		{
-			Resource resource(m_TextureName);
-			shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(&resource);
+			shared_ptr<ResHandle> pTextureRes = g_pApp->GetResCache()->GetHandle(m_TextureId);
 			if (pTextureRes != nullptr)
 			{
 				shared_ptr<D3D11TextureResourceExtraData> extra =
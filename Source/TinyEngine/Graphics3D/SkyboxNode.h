@@ -18,6 +18,7 @@ public:
 	virtual HRESULT VOnUpdate(Scene* pScene, const GameTime& gameTime) override;
 
 private:
+	shared_ptr<ResHandle> m_pEffectResHandle;		// keeps m_pEffect alive when the effect is reloaded
 	Effect* m_pEffect;
 	Pass* m_pCurrentPass;
 	ID3D11Buffer* m_pVertexBuffer;
@@ -25,5 +26,5 @@ private:
 	uint32_t m_IndexCount;
 	Matrix m_ScaleMatrix;
 
-	std::string m_TextureName;
+	ResourceId m_TextureId;
 };
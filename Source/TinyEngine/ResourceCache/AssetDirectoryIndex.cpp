@@ -0,0 +1,309 @@
+#include "AssetDirectoryIndex.h"
+#include "boost/filesystem/operations.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+	// '/' separates directories everywhere boost::filesystem runs
+	fs::path ToPath(const std::string& name)
+	{
+		std::string portable = name;
+		std::replace(portable.begin(), portable.end(), '\\', '/');
+		return fs::path(portable);
+	}
+
+	bool IsHidden(const fs::path& path)
+	{
+		std::string fileName = path.filename().string();
+		if (fileName.empty() || fileName[0] == '.')
+			return true;
+
+#ifdef _WIN32
+		DWORD attributes = GetFileAttributesW(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_HIDDEN) != 0;
+#else
+		return false;
+#endif
+	}
+}
+
+AssetDirectoryIndex::AssetDirectoryIndex(const std::string& rootDir)
+	: m_Root(ToPath(rootDir)),
+	m_ChangeCount(0)
+{
+
+}
+
+void AssetDirectoryIndex::Scan()
+{
+	m_Assets.clear();
+	m_Index.clear();
+	m_Missing.clear();
+	m_Directories.clear();
+	ListDirectory("", m_Root);
+}
+
+uint32_t AssetDirectoryIndex::Rescan()
+{
+	m_ChangeCount = 0;
+
+	std::vector<std::string> changed;
+	for (auto& directory : m_Directories)
+	{
+		boost::system::error_code error;
+		std::time_t writeTime = fs::last_write_time(directory.second.m_Path, error);
+		if (error || writeTime != directory.second.m_WriteTime || writeTime >= directory.second.m_ListedAt)
+		{
+			changed.push_back(directory.first);
+		}
+	}
+
+	for (const auto& name : changed)
+	{
+		// Gone already if a parent directory was removed before
+		DirectoryMap::iterator directory = m_Directories.find(name);
+		if (directory == m_Directories.end())
+			continue;
+
+		boost::system::error_code error;
+		if (fs::is_directory(directory->second.m_Path, error))
+		{
+			ListDirectory(name, directory->second.m_Path);
+		}
+		else
+		{
+			RemoveDirectory(name);
+		}
+	}
+
+	// Anything remembered as missing may have shown up
+	if (m_ChangeCount > 0)
+	{
+		m_Missing.clear();
+	}
+	return m_ChangeCount;
+}
+
+int AssetDirectoryIndex::Find(const ResourceId& id, bool isAddingNewFiles)
+{
+	// Another name with the same hash is a miss, the file system can't have both under one key
+	std::unordered_map<uint64_t, int>::const_iterator it = m_Index.find(id.GetHash());
+	if (it != m_Index.end())
+		return (m_Assets[it->second].m_Name == id.GetName()) ? it->second : -1;
+
+	if (!isAddingNewFiles)
+		return -1;
+
+	std::unordered_map<uint64_t, Missing>::iterator missing = m_Missing.find(id.GetHash());
+	if (missing != m_Missing.end())
+	{
+		if (!HasDirectoryChanged(id.GetName(), missing->second))
+			return -1;
+
+		m_Missing.erase(missing);
+	}
+
+	fs::path path = m_Root / ToPath(id.GetName());
+	boost::system::error_code error;
+	if (fs::is_regular_file(path, error) && UpdateAsset(id.GetName(), id.GetHash(), path))
+	{
+		DirectoryMap::iterator directory = m_Directories.find(GetDirectoryName(id.GetName()));
+		if (directory != m_Directories.end())
+		{
+			directory->second.m_Files.insert(id.GetHash());
+		}
+		return m_Index[id.GetHash()];
+	}
+
+#ifndef _WIN32
+	// Names are lower case, on a case sensitive file system the listing has the name as it is on disk
+	DirectoryMap::iterator directory = m_Directories.find(GetDirectoryName(id.GetName()));
+	if (directory != m_Directories.end())
+	{
+		ListDirectory(directory->first, directory->second.m_Path);
+		it = m_Index.find(id.GetHash());
+		if (it != m_Index.end() && m_Assets[it->second].m_Name == id.GetName())
+			return it->second;
+	}
+#endif
+
+	// Taken after the look, a file added in between shows in the next second's check
+	Missing& entry = m_Missing[id.GetHash()];
+	entry.m_DirectoryWriteTime = GetDirectoryWriteTime(id.GetName());
+	entry.m_CheckedAt = std::time(nullptr);
+	return -1;
+}
+
+bool AssetDirectoryIndex::HasDirectoryChanged(const std::string& name, Missing& missing)
+{
+	std::time_t now = std::time(nullptr);
+	if (now == missing.m_CheckedAt)
+		return false;
+
+	// A change within the second of the last check may have come after it
+	std::time_t writeTime = GetDirectoryWriteTime(name);
+	if (writeTime != missing.m_DirectoryWriteTime || writeTime >= missing.m_CheckedAt)
+		return true;
+
+	missing.m_CheckedAt = now;
+	return false;
+}
+
+std::time_t AssetDirectoryIndex::GetDirectoryWriteTime(const std::string& name) const
+{
+	boost::system::error_code error;
+	std::time_t writeTime = fs::last_write_time(m_Root / ToPath(GetDirectoryName(name)), error);
+	return error ? 0 : writeTime;
+}
+
+void AssetDirectoryIndex::Remove(const ResourceId& id)
+{
+	RemoveAsset(id.GetHash());
+	m_Missing.erase(id.GetHash());
+}
+
+std::string AssetDirectoryIndex::GetDirectoryName(const std::string& name)
+{
+	size_t separator = name.rfind('\\');
+	return (separator == std::string::npos) ? std::string() : name.substr(0, separator + 1);
+}
+
+void AssetDirectoryIndex::ListDirectory(const std::string& name, const fs::path& path)
+{
+	boost::system::error_code error;
+	Directory& directory = m_Directories[name];
+	directory.m_Path = path;
+	directory.m_WriteTime = fs::last_write_time(path, error);
+	directory.m_ListedAt = std::time(nullptr);
+
+	std::unordered_set<uint64_t> files;
+	std::vector<std::string> subdirectories;
+	std::vector<fs::path> subdirectoryPaths;		// names are lower case, the file system may not be
+	for (fs::directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+	{
+		const fs::path& entryPath = it->path();
+		if (IsHidden(entryPath))
+			continue;
+
+		std::string entryName = name + ResourceId::Normalize(entryPath.filename().string());
+		boost::system::error_code statusError;
+		fs::file_status status = it->status(statusError);
+		if (fs::is_directory(status))
+		{
+			subdirectories.push_back(entryName + "\\");
+			subdirectoryPaths.push_back(entryPath);
+		}
+		else if (fs::is_regular_file(status))
+		{
+			uint64_t hash = ResourceId::Hash(entryName);
+			if (UpdateAsset(entryName, hash, entryPath))
+			{
+				files.insert(hash);
+			}
+		}
+	}
+
+	// The listing replaces what was known about this directory, and only this directory.
+	// The reference is still good, nothing was added to the map since.
+	for (uint64_t hash : directory.m_Files)
+	{
+		if (files.find(hash) == files.end())
+		{
+			RemoveAsset(hash);
+		}
+	}
+	directory.m_Files.swap(files);
+
+	std::vector<std::string> removedSubdirectories;
+	for (const auto& subdirectory : directory.m_Subdirectories)
+	{
+		if (std::find(subdirectories.begin(), subdirectories.end(), subdirectory) == subdirectories.end())
+		{
+			removedSubdirectories.push_back(subdirectory);
+		}
+	}
+	directory.m_Subdirectories = subdirectories;
+
+	for (const auto& subdirectory : removedSubdirectories)
+	{
+		RemoveDirectory(subdirectory);
+	}
+
+	// New subdirectories are listed in full, known ones are up to their own write time
+	for (size_t i = 0; i < subdirectories.size(); i++)
+	{
+		if (m_Directories.find(subdirectories[i]) == m_Directories.end())
+		{
+			ListDirectory(subdirectories[i], subdirectoryPaths[i]);
+		}
+	}
+}
+
+void AssetDirectoryIndex::RemoveDirectory(const std::string& name)
+{
+	// Subdirectories sort right after their parent
+	DirectoryMap::iterator it = m_Directories.lower_bound(name);
+	while (it != m_Directories.end() && it->first.compare(0, name.length(), name) == 0)
+	{
+		for (uint64_t hash : it->second.m_Files)
+		{
+			RemoveAsset(hash);
+		}
+		it = m_Directories.erase(it);
+	}
+}
+
+bool AssetDirectoryIndex::UpdateAsset(const std::string& name, uint64_t hash, const fs::path& path)
+{
+	boost::system::error_code sizeError, timeError;
+	int64_t size = (int64_t)fs::file_size(path, sizeError);
+	std::time_t writeTime = fs::last_write_time(path, timeError);
+	if (sizeError || timeError)
+		return false;
+
+	std::unordered_map<uint64_t, int>::iterator it = m_Index.find(hash);
+	if (it != m_Index.end() && m_Assets[it->second].m_Name != name)
+	{
+		DEBUG_WARNING("Name hash collision between assets " + m_Assets[it->second].m_Name + " and " + name + ", " + name + " can't be found");
+		return false;
+	}
+
+	if (it == m_Index.end())
+	{
+		it = m_Index.insert(std::make_pair(hash, (int)m_Assets.size())).first;
+		m_Assets.push_back(Asset());
+		m_Assets.back().m_Name = name;
+		m_Assets.back().m_Hash = hash;
+		m_Assets.back().m_Size = -1;
+		m_Assets.back().m_WriteTime = 0;
+	}
+
+	Asset& asset = m_Assets[it->second];
+	if (asset.m_Size != size || asset.m_WriteTime != writeTime)
+	{
+		m_ChangeCount++;
+	}
+	asset.m_Path = path;
+	asset.m_Size = size;
+	asset.m_WriteTime = writeTime;
+	return true;
+}
+
+void AssetDirectoryIndex::RemoveAsset(uint64_t hash)
+{
+	std::unordered_map<uint64_t, int>::iterator it = m_Index.find(hash);
+	if (it == m_Index.end())
+		return;
+
+	// Move the last asset into the hole so indices stay dense
+	int index = it->second;
+	m_Index.erase(it);
+	if (index != (int)m_Assets.size() - 1)
+	{
+		m_Assets[index] = m_Assets.back();
+		m_Index[m_Assets[index].m_Hash] = index;
+	}
+	m_Assets.pop_back();
+	m_ChangeCount++;
+}
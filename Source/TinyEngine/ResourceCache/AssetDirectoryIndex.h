@@ -0,0 +1,78 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "ResourceId.h"
+#include "boost/filesystem/path.hpp"
+#include <unordered_set>
+#include <ctime>
+
+// Index of the loose files under the asset directory, portable through boost::filesystem.
+// Files are found by the hash of their normalized name, the same key the packed formats use.
+// Names that were looked up and are not there are remembered with the write time of their
+// directory. Asking for a missing file again looks at that directory at most once a second,
+// and at the file only when the directory changed.
+//
+// Rescan only lists directories again whose modification time changed, which covers files
+// being added, removed or renamed. Rewriting a file in place does not touch its directory,
+// Remove drops a single entry so the next Find looks at the file again. Not thread safe.
+class AssetDirectoryIndex : public boost::noncopyable
+{
+public:
+	struct Asset
+	{
+		std::string m_Name;				// normalized, relative to the root
+		uint64_t m_Hash;
+		boost::filesystem::path m_Path;	// as found on disk
+		int64_t m_Size;
+		std::time_t m_WriteTime;
+	};
+
+	explicit AssetDirectoryIndex(const std::string& rootDir);
+
+	void Scan();
+	// Returns how many assets were added, removed or changed
+	uint32_t Rescan();
+
+	// Index of the asset, -1 if there is none. With isAddingNewFiles a name that is not
+	// indexed yet is looked up on disk once, the result is remembered either way.
+	int Find(const ResourceId& id, bool isAddingNewFiles);
+	// Forgets the asset, found or missing, the next Find goes to the file system
+	void Remove(const ResourceId& id);
+
+	int GetAssetCount() const { return (int)m_Assets.size(); }
+	const Asset& GetAsset(int index) const { return m_Assets[index]; }
+
+private:
+	struct Directory
+	{
+		boost::filesystem::path m_Path;
+		std::time_t m_WriteTime;
+		std::time_t m_ListedAt;			// changes within the same second need another look
+		std::unordered_set<uint64_t> m_Files;
+		std::vector<std::string> m_Subdirectories;
+	};
+	typedef std::map<std::string, Directory> DirectoryMap;		// by normalized name ending in '\', the root is ""
+
+	static std::string GetDirectoryName(const std::string& name);
+
+	void ListDirectory(const std::string& name, const boost::filesystem::path& path);
+	void RemoveDirectory(const std::string& name);
+	bool UpdateAsset(const std::string& name, uint64_t hash, const boost::filesystem::path& path);
+	void RemoveAsset(uint64_t hash);
+
+	boost::filesystem::path m_Root;
+	std::vector<Asset> m_Assets;
+	std::unordered_map<uint64_t, int> m_Index;
+	struct Missing
+	{
+		std::time_t m_DirectoryWriteTime;	// 0 when the directory was not there either
+		std::time_t m_CheckedAt;
+	};
+
+	// Whether the directory of a missing name changed since it was found missing
+	bool HasDirectoryChanged(const std::string& name, Missing& missing);
+	std::time_t GetDirectoryWriteTime(const std::string& name) const;
+
+	std::unordered_map<uint64_t, Missing> m_Missing;
+	DirectoryMap m_Directories;
+	uint32_t m_ChangeCount;
+};
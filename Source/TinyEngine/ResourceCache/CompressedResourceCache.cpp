@@ -0,0 +1,168 @@
+#include "CompressedResourceCache.h"
+#include <zlib.h>
+
+CompressedResourceCache::CompressedResourceCache(uint64_t budget)
+	: m_Budget(budget)
+{
+
+}
+
+void CompressedResourceCache::SetBudget(uint64_t bytes)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Budget = bytes;
+	DropDownTo(m_Budget);
+}
+
+uint64_t CompressedResourceCache::GetBudget() const
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return m_Budget;
+}
+
+uint32_t CompressedResourceCache::BeginInsert(const ResourceId& id)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	std::unordered_map<ResourceId, Generation>::iterator it = m_Generations.find(id);
+	if (it == m_Generations.end())
+	{
+		Generation added;
+		added.m_Current = 0;
+		added.m_InFlight = 0;
+		it = m_Generations.insert(std::make_pair(id, added)).first;
+	}
+	it->second.m_InFlight++;
+	return it->second.m_Current;
+}
+
+void CompressedResourceCache::Insert(const ResourceId& id, uint32_t generation, const char* pBuffer, uint64_t size)
+{
+	// Compress outside the lock, this runs on the resource worker threads. zlib takes 32 bit sizes on Windows.
+	shared_ptr<Entry> pEntry;
+	if (size > 0 && size <= UINT32_MAX && size <= GetBudget())
+	{
+		std::vector<char> scratch(compressBound((uLong)size));
+		uLongf compressedSize = (uLongf)scratch.size();
+		if (compress2((Bytef*)&scratch[0], &compressedSize, (const Bytef*)pBuffer, (uLong)size, Z_BEST_SPEED) == Z_OK)
+		{
+			pEntry.reset(DEBUG_NEW Entry());
+			pEntry->m_Data.assign(scratch.begin(), scratch.begin() + compressedSize);
+			pEntry->m_RawSize = size;
+		}
+	}
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	std::unordered_map<ResourceId, Generation>::iterator current = m_Generations.find(id);
+	bool isCurrent = (current != m_Generations.end() && current->second.m_Current == generation);
+	if (current != m_Generations.end() && --current->second.m_InFlight == 0)
+	{
+		m_Generations.erase(current);
+	}
+	if (pEntry == nullptr || !isCurrent || pEntry->m_Data.size() > m_Budget)
+		return;
+
+	uint64_t compressedSize = pEntry->m_Data.size();
+
+	std::unordered_map<ResourceId, Slot>::iterator existing = m_Entries.find(id);
+	if (existing != m_Entries.end())
+	{
+		Erase(existing);
+	}
+	DropDownTo(m_Budget - compressedSize);
+
+	m_Order.push_front(id);
+	Slot& slot = m_Entries[id];
+	slot.m_pEntry = pEntry;
+	slot.m_Position = m_Order.begin();
+
+	m_Stats.m_Insertions++;
+	m_Stats.m_RawBytes += size;
+	m_Stats.m_CompressedBytes += compressedSize;
+}
+
+shared_ptr<const CompressedResourceCache::Entry> CompressedResourceCache::Take(const ResourceId& id)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Stats.m_Lookups++;
+
+	std::unordered_map<ResourceId, Slot>::iterator it = m_Entries.find(id);
+	if (it == m_Entries.end())
+		return shared_ptr<const Entry>();
+
+	// Remove drops entries right away, whatever is held is current
+	shared_ptr<const Entry> pEntry = it->second.m_pEntry;
+	Erase(it);
+	m_Stats.m_Hits++;
+	return pEntry;
+}
+
+bool CompressedResourceCache::Inflate(const Entry& entry, char* pBuffer)
+{
+	uLongf size = (uLongf)entry.m_RawSize;
+	int result = uncompress((Bytef*)pBuffer, &size, (const Bytef*)entry.m_Data.data(), (uLong)entry.m_Data.size());
+	return result == Z_OK && size == entry.m_RawSize;
+}
+
+void CompressedResourceCache::Remove(const ResourceId& id)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	std::unordered_map<ResourceId, Generation>::iterator current = m_Generations.find(id);
+	if (current != m_Generations.end())
+	{
+		current->second.m_Current++;
+	}
+
+	std::unordered_map<ResourceId, Slot>::iterator it = m_Entries.find(id);
+	if (it != m_Entries.end())
+	{
+		Erase(it);
+	}
+}
+
+void CompressedResourceCache::Trim(double targetFraction)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	DropDownTo((uint64_t)(m_Stats.m_CompressedBytes * std::min(std::max(targetFraction, 0.0), 1.0)));
+}
+
+void CompressedResourceCache::Clear()
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Order.clear();
+	m_Entries.clear();
+	m_Stats.m_RawBytes = 0;
+	m_Stats.m_CompressedBytes = 0;
+}
+
+CompressedCacheStats CompressedResourceCache::GetStats() const
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return m_Stats;
+}
+
+void CompressedResourceCache::ResetStats()
+{
+	// The byte counts describe what is held, they are not reset
+	boost::mutex::scoped_lock lock(m_Mutex);
+	CompressedCacheStats stats;
+	stats.m_RawBytes = m_Stats.m_RawBytes;
+	stats.m_CompressedBytes = m_Stats.m_CompressedBytes;
+	m_Stats = stats;
+}
+
+void CompressedResourceCache::Erase(std::unordered_map<ResourceId, Slot>::iterator it)
+{
+	m_Stats.m_RawBytes -= it->second.m_pEntry->m_RawSize;
+	m_Stats.m_CompressedBytes -= it->second.m_pEntry->m_Data.size();
+	m_Order.erase(it->second.m_Position);
+	m_Entries.erase(it);
+}
+
+void CompressedResourceCache::DropDownTo(uint64_t bytes)
+{
+	while (m_Stats.m_CompressedBytes > bytes && !m_Order.empty())
+	{
+		Erase(m_Entries.find(m_Order.back()));
+		m_Stats.m_Drops++;
+	}
+}
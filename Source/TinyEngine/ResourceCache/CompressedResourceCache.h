@@ -0,0 +1,85 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "ResourceId.h"
+#include "boost/thread/mutex.hpp"
+
+struct CompressedCacheStats
+{
+	CompressedCacheStats()
+		: m_Lookups(0), m_Hits(0), m_Insertions(0), m_Drops(0), m_RawBytes(0), m_CompressedBytes(0) {}
+
+	double GetHitRatio() const { return (m_Lookups == 0) ? 0.0 : (double)m_Hits / m_Lookups; }
+	double GetCompressionRatio() const { return (m_RawBytes == 0) ? 0.0 : (double)m_CompressedBytes / m_RawBytes; }
+
+	uint64_t m_Lookups;			// reads that missed the first tier
+	uint64_t m_Hits;
+	uint64_t m_Insertions;
+	uint64_t m_Drops;			// entries pushed out to stay within the budget
+	uint64_t m_RawBytes;		// of the entries held right now
+	uint64_t m_CompressedBytes;
+};
+
+// Second tier below ResCache. Raw buffers of evicted handles are kept deflated at the fastest
+// zlib level within a budget of their own, so loading them again skips the resource file.
+// Entries are handed out once, a hit goes back to the first tier. Thread safe.
+//
+// Ids with buffers being compressed have a generation, Remove moves it on. Buffers are inserted
+// with the generation they were evicted under, so one still being compressed when its resource
+// changes is not kept. The generation is forgotten once nothing is on its way, Remove drops the
+// entry itself then.
+class CompressedResourceCache : public boost::noncopyable
+{
+public:
+	struct Entry
+	{
+		std::vector<char> m_Data;
+		uint64_t m_RawSize;
+	};
+
+	explicit CompressedResourceCache(uint64_t budget = 0);
+
+	// A budget of 0 turns the tier off
+	void SetBudget(uint64_t bytes);
+	uint64_t GetBudget() const;
+
+	// Take it on the main thread when the handle is evicted, every call is followed by one Insert
+	uint32_t BeginInsert(const ResourceId& id);
+	// Drops the oldest entries to make room, buffers that do not fit at all are not kept and
+	// neither are buffers of an older generation
+	void Insert(const ResourceId& id, uint32_t generation, const char* pBuffer, uint64_t size);
+	// Removes and returns the entry, nullptr on a miss
+	shared_ptr<const Entry> Take(const ResourceId& id);
+	static bool Inflate(const Entry& entry, char* pBuffer);
+	// For resources that changed or were let go of, the current entry and any on its way are dropped
+	void Remove(const ResourceId& id);
+	// Keeps at most targetFraction of the compressed bytes held now
+	void Trim(double targetFraction);
+	void Clear();
+
+	CompressedCacheStats GetStats() const;
+	void ResetStats();
+
+private:
+	typedef std::list<ResourceId> EntryList;
+	struct Slot
+	{
+		shared_ptr<const Entry> m_pEntry;
+		EntryList::iterator m_Position;
+	};
+
+	struct Generation
+	{
+		uint32_t m_Current;
+		uint32_t m_InFlight;		// BeginInsert calls still waiting for their Insert
+	};
+
+	void Erase(std::unordered_map<ResourceId, Slot>::iterator it);
+	void DropDownTo(uint64_t bytes);
+
+	mutable boost::mutex m_Mutex;
+	uint64_t m_Budget;
+	EntryList m_Order;		// newest first
+	std::unordered_map<ResourceId, Slot> m_Entries;
+	std::unordered_map<ResourceId, Generation> m_Generations;		// only ids with buffers on their way
+	CompressedCacheStats m_Stats;
+};
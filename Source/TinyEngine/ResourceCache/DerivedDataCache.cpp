@@ -0,0 +1,353 @@
+#include "DerivedDataCache.h"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/fstream.hpp"
+#include <zlib.h>
+#include <chrono>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+	const uint32_t BLOB_MAGIC = 0x43444454;		// "TDDC"
+	const uint32_t BLOB_FORMAT_VERSION = 1;
+
+	struct BlobHeader
+	{
+		uint32_t m_Magic;
+		uint32_t m_FormatVersion;
+		uint64_t m_Key;
+		uint64_t m_Size;			// of the payload following the header
+		uint32_t m_Checksum;		// crc32 of the payload
+		float m_BuildSeconds;
+	};
+
+	// Deletes down to this share of the budget, so the next few writes do not delete again
+	const double CLEANUP_TARGET = 0.9;
+
+	// 64 bit FNV-1a over raw bytes, ResourceId::Hash folds case and is for names only
+	uint64_t HashBytes(const void* pData, uint64_t size, uint64_t hash)
+	{
+		const unsigned char* p = (const unsigned char*)pData;
+		for (uint64_t i = 0; i < size; i++)
+		{
+			hash ^= p[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	uint32_t Checksum(const char* pData, uint64_t size)
+	{
+		uLong crc = crc32(0L, Z_NULL, 0);
+		while (size > 0)
+		{
+			uInt chunk = (uInt)std::min<uint64_t>(size, 0x40000000);
+			crc = crc32(crc, (const Bytef*)pData, chunk);
+			pData += chunk;
+			size -= chunk;
+		}
+		return (uint32_t)crc;
+	}
+
+	double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+DerivedDataCache::DerivedDataCache(const std::string& directory, uint64_t budget)
+	: m_Directory(directory),
+	m_Budget(budget)
+{
+	std::string portable = directory;
+	std::replace(portable.begin(), portable.end(), '\\', '/');
+	m_Path = fs::path(portable);
+}
+
+bool DerivedDataCache::Open()
+{
+	boost::system::error_code error;
+	fs::create_directories(m_Path, error);
+	if (!fs::is_directory(m_Path, error))
+	{
+		DEBUG_WARNING("Can't open the derived data cache: " + m_Directory);
+		return false;
+	}
+
+	struct Found
+	{
+		std::time_t m_WriteTime;
+		uint64_t m_Key;
+		uint64_t m_Size;
+	};
+	std::vector<Found> found;
+	for (fs::directory_iterator it(m_Path, error), end; !error && it != end; it.increment(error))
+	{
+		const fs::path& path = it->path();
+		boost::system::error_code fileError;
+		if (path.extension() == ".tmp")
+		{
+			// Left over from a write that never finished
+			fs::remove(path, fileError);
+			continue;
+		}
+
+		std::string stem = path.stem().string();
+		if (path.extension() != ".ddc" || stem.size() != 16 || stem.find_first_not_of("0123456789abcdef") != std::string::npos)
+			continue;
+
+		Found blob;
+		blob.m_Key = std::strtoull(stem.c_str(), nullptr, 16);
+		blob.m_Size = fs::file_size(path, fileError);
+		blob.m_WriteTime = fs::last_write_time(path, fileError);
+		if (!fileError)
+		{
+			found.push_back(blob);
+		}
+	}
+
+	std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.m_WriteTime > b.m_WriteTime; });
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Order.clear();
+	m_Entries.clear();
+	m_Stats.m_BytesOnDisk = 0;
+	for (const auto& blob : found)
+	{
+		Entry& entry = m_Entries[blob.m_Key];
+		entry.m_Size = blob.m_Size;
+		entry.m_Position = m_Order.insert(m_Order.end(), blob.m_Key);
+		m_Stats.m_BytesOnDisk += blob.m_Size;
+	}
+	m_Stats.m_EntryCount = m_Entries.size();
+	if (m_Stats.m_BytesOnDisk > m_Budget)
+	{
+		DeleteDownTo((uint64_t)(m_Budget * CLEANUP_TARGET));
+	}
+	return true;
+}
+
+uint64_t DerivedDataCache::MakeKey(const void* pSource, uint64_t size, const std::string& transform, uint32_t version, const std::string& options)
+{
+	// Lengths go in too, so the fields can't run into each other
+	uint64_t hash = 14695981039346656037ULL;
+	hash = HashBytes(&size, sizeof(size), hash);
+	hash = HashBytes(pSource, size, hash);
+	uint64_t length = transform.size();
+	hash = HashBytes(&length, sizeof(length), hash);
+	hash = HashBytes(transform.data(), length, hash);
+	hash = HashBytes(&version, sizeof(version), hash);
+	length = options.size();
+	hash = HashBytes(&length, sizeof(length), hash);
+	hash = HashBytes(options.data(), length, hash);
+	return hash;
+}
+
+fs::path DerivedDataCache::GetBlobPath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.ddc", (unsigned long long)key);
+	return m_Path / name;
+}
+
+bool DerivedDataCache::Get(uint64_t key, std::vector<char>& data)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		boost::mutex::scoped_lock lock(m_Mutex);
+		if (m_Entries.find(key) == m_Entries.end())
+		{
+			m_Stats.m_Misses++;
+			return false;
+		}
+	}
+
+	// Read without the lock, a blob deleted meanwhile is a miss like any other failed read
+	BlobHeader header;
+	bool isValid = false;
+	boost::system::error_code error;
+	fs::path path = GetBlobPath(key);
+	uint64_t fileSize = fs::file_size(path, error);
+	fs::ifstream file(path, std::ios::in | std::ios::binary);
+	// The size is checked against the file before anything is allocated for it
+	if (!error && fileSize >= sizeof(header) && file && file.read((char*)&header, sizeof(header)) &&
+		header.m_Magic == BLOB_MAGIC && header.m_FormatVersion == BLOB_FORMAT_VERSION && header.m_Key == key &&
+		header.m_Size == fileSize - sizeof(header))
+	{
+		data.resize((size_t)header.m_Size);
+		isValid = (header.m_Size == 0 || file.read(data.data(), (std::streamsize)header.m_Size)) &&
+			Checksum(data.data(), header.m_Size) == header.m_Checksum;
+	}
+	file.close();
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	EntryMap::iterator it = m_Entries.find(key);
+	if (!isValid)
+	{
+		data.clear();
+		m_Stats.m_Misses++;
+		m_Stats.m_Corrupt++;
+		if (it != m_Entries.end())
+		{
+			Erase(it);
+		}
+		return false;
+	}
+
+	m_Stats.m_Hits++;
+	m_Stats.m_BytesRead += header.m_Size;
+	m_Stats.m_HitSeconds += SecondsSince(start);
+	m_Stats.m_SavedSeconds += header.m_BuildSeconds;
+	if (it != m_Entries.end())
+	{
+		Touch(key);
+	}
+	return true;
+}
+
+bool DerivedDataCache::Put(uint64_t key, const char* pData, uint64_t size, double buildSeconds)
+{
+	BlobHeader header;
+	header.m_Magic = BLOB_MAGIC;
+	header.m_FormatVersion = BLOB_FORMAT_VERSION;
+	header.m_Key = key;
+	header.m_Size = size;
+	header.m_Checksum = Checksum(pData, size);
+	header.m_BuildSeconds = (float)buildSeconds;
+
+	// Unique per writer, two threads building the same blob never share a temporary file
+	boost::system::error_code error;
+	fs::path tempPath = m_Path / fs::unique_path("%%%%-%%%%-%%%%-%%%%.tmp", error);
+	if (error)
+		return false;
+
+	fs::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	bool isWritten = file && file.write((const char*)&header, sizeof(header)) && (size == 0 || file.write(pData, (std::streamsize)size));
+	file.close();
+	isWritten = isWritten && !file.fail();
+
+	// The rename replaces an existing blob in one step, readers see the old or the new one
+	if (isWritten)
+	{
+		fs::rename(tempPath, GetBlobPath(key), error);
+		isWritten = !error;
+	}
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Stats.m_BuildSeconds += buildSeconds;
+	if (!isWritten)
+	{
+		fs::remove(tempPath, error);
+		DEBUG_WARNING("Can't write to the derived data cache: " + m_Directory);
+		return false;
+	}
+
+	m_Stats.m_Writes++;
+	m_Stats.m_BytesWritten += size;
+	Insert(key, sizeof(header) + size);
+	if (m_Stats.m_BytesOnDisk > m_Budget)
+	{
+		DeleteDownTo((uint64_t)(m_Budget * CLEANUP_TARGET));
+	}
+	return true;
+}
+
+bool DerivedDataCache::Fetch(uint64_t key, std::vector<char>& data, const BuildFunction& build)
+{
+	if (Get(key, data))
+		return true;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	data.clear();
+	if (!build(data))
+		return false;
+
+	Put(key, data.data(), data.size(), SecondsSince(start));
+	return true;
+}
+
+void DerivedDataCache::SetBudget(uint64_t bytes)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Budget = bytes;
+	if (m_Stats.m_BytesOnDisk > m_Budget)
+	{
+		DeleteDownTo((uint64_t)(m_Budget * CLEANUP_TARGET));
+	}
+}
+
+uint64_t DerivedDataCache::GetBudget() const
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return m_Budget;
+}
+
+DerivedDataCacheStats DerivedDataCache::GetStats() const
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return m_Stats;
+}
+
+std::string DerivedDataCache::GetStatsReport() const
+{
+	DerivedDataCacheStats stats = GetStats();
+	std::ostringstream report;
+	report << "Derived data cache " << m_Directory << ": "
+		<< stats.m_Hits << " hits, " << stats.m_Misses << " misses (" << (int)(stats.GetHitRatio() * 100.0 + 0.5) << "%), "
+		<< stats.m_Corrupt << " corrupt, " << stats.m_Writes << " writes, " << stats.m_Evictions << " evictions, "
+		<< stats.m_BytesRead / 1024 << " KB read, " << stats.m_BytesWritten / 1024 << " KB written, "
+		<< stats.m_EntryCount << " blobs in " << stats.m_BytesOnDisk / 1024 << " KB. "
+		<< "Hits took " << stats.m_HitSeconds << " s and saved " << stats.m_SavedSeconds << " s of building, "
+		<< "misses took " << stats.m_BuildSeconds << " s to build.";
+	return report.str();
+}
+
+void DerivedDataCache::Touch(uint64_t key)
+{
+	Entry& entry = m_Entries[key];
+	m_Order.splice(m_Order.begin(), m_Order, entry.m_Position);
+
+	// The write time carries the order over to the next run
+	boost::system::error_code error;
+	fs::last_write_time(GetBlobPath(key), std::time(nullptr), error);
+}
+
+void DerivedDataCache::Insert(uint64_t key, uint64_t size)
+{
+	EntryMap::iterator it = m_Entries.find(key);
+	if (it != m_Entries.end())
+	{
+		m_Stats.m_BytesOnDisk -= it->second.m_Size;
+		it->second.m_Size = size;
+		m_Order.splice(m_Order.begin(), m_Order, it->second.m_Position);
+	}
+	else
+	{
+		Entry& entry = m_Entries[key];
+		entry.m_Size = size;
+		entry.m_Position = m_Order.insert(m_Order.begin(), key);
+	}
+	m_Stats.m_BytesOnDisk += size;
+	m_Stats.m_EntryCount = m_Entries.size();
+}
+
+void DerivedDataCache::Erase(EntryMap::iterator it)
+{
+	boost::system::error_code error;
+	fs::remove(GetBlobPath(it->first), error);
+
+	m_Stats.m_BytesOnDisk -= it->second.m_Size;
+	m_Order.erase(it->second.m_Position);
+	m_Entries.erase(it);
+	m_Stats.m_EntryCount = m_Entries.size();
+}
+
+void DerivedDataCache::DeleteDownTo(uint64_t bytes)
+{
+	while (m_Stats.m_BytesOnDisk > bytes && !m_Order.empty())
+	{
+		Erase(m_Entries.find(m_Order.back()));
+		m_Stats.m_Evictions++;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "boost/filesystem/path.hpp"
+#include "boost/thread/mutex.hpp"
+
+// Counted since the cache was opened
+struct DerivedDataCacheStats
+{
+	DerivedDataCacheStats()
+		: m_Hits(0), m_Misses(0), m_Writes(0), m_Evictions(0), m_Corrupt(0),
+		m_BytesRead(0), m_BytesWritten(0), m_BytesOnDisk(0), m_EntryCount(0),
+		m_HitSeconds(0.0), m_BuildSeconds(0.0), m_SavedSeconds(0.0) {}
+
+	double GetHitRatio() const { return (m_Hits + m_Misses == 0) ? 0.0 : (double)m_Hits / (m_Hits + m_Misses); }
+
+	uint64_t m_Hits;
+	uint64_t m_Misses;
+	uint64_t m_Writes;
+	uint64_t m_Evictions;		// blobs deleted to stay within the budget
+	uint64_t m_Corrupt;			// blobs that failed their checksum or were cut short, dropped and counted as misses
+	uint64_t m_BytesRead;
+	uint64_t m_BytesWritten;
+	uint64_t m_BytesOnDisk;		// right now, all blobs together
+	uint64_t m_EntryCount;
+	double m_HitSeconds;		// reading and checking the blobs that hit
+	double m_BuildSeconds;		// what the misses took to build, as reported to Put
+	double m_SavedSeconds;		// what the hits took to build back when they were written
+};
+
+// Artifacts built from resources, compiled effects and parsed models, kept on disk between runs.
+// Blobs are keyed by a hash of the source bytes, the name and version of the transform and its
+// options, so a changed source or a new transform version simply misses and the stale blob
+// ages out. Writes go to a temporary file that is renamed into place, a crash never leaves a
+// half written blob behind. The least recently used blobs are deleted once the directory grows
+// past its budget, the order survives restarts through the files' write times. Thread safe.
+class DerivedDataCache : public boost::noncopyable
+{
+public:
+	typedef std::function<bool(std::vector<char>& data)> BuildFunction;
+
+	DerivedDataCache(const std::string& directory, uint64_t budget);
+
+	// Creates the directory if needed and indexes the blobs already in it
+	bool Open();
+
+	static uint64_t MakeKey(const void* pSource, uint64_t size, const std::string& transform, uint32_t version, const std::string& options);
+
+	bool Get(uint64_t key, std::vector<char>& data);
+	// buildSeconds is what it took to build the data, it is kept with the blob for the stats
+	bool Put(uint64_t key, const char* pData, uint64_t size, double buildSeconds);
+	// Get, or build and Put on a miss. False only when the build fails.
+	bool Fetch(uint64_t key, std::vector<char>& data, const BuildFunction& build);
+
+	void SetBudget(uint64_t bytes);
+	uint64_t GetBudget() const;
+	const std::string& GetDirectory() const { return m_Directory; }
+
+	DerivedDataCacheStats GetStats() const;
+	std::string GetStatsReport() const;
+
+private:
+	typedef std::list<uint64_t> EntryList;
+	struct Entry
+	{
+		uint64_t m_Size;			// of the file, header included
+		EntryList::iterator m_Position;
+	};
+	typedef std::unordered_map<uint64_t, Entry> EntryMap;
+
+	boost::filesystem::path GetBlobPath(uint64_t key) const;
+	void Touch(uint64_t key);
+	void Insert(uint64_t key, uint64_t size);
+	void Erase(EntryMap::iterator it);
+	// Deletes the least recently used blobs until the rest fits in bytes
+	void DeleteDownTo(uint64_t bytes);
+
+	std::string m_Directory;
+	boost::filesystem::path m_Path;
+
+	mutable boost::mutex m_Mutex;
+	uint64_t m_Budget;
+	EntryList m_Order;		// most recently used first
+	EntryMap m_Entries;
+	DerivedDataCacheStats m_Stats;
+};
@@ -0,0 +1,433 @@
+#include "EvictionPolicy.h"
+#include "ResCache.h"
+
+namespace
+{
+	typedef std::list<ResHandle*> HandleList;
+
+	// The oldest handle canEvict accepts, only held handles are walked past
+	ResHandle* FindOldest(HandleList& handles, const IResourceEvictionPolicy::CanEvictPredicate& canEvict)
+	{
+		for (HandleList::reverse_iterator it = handles.rbegin(); it != handles.rend(); ++it)
+		{
+			if (canEvict(*it))
+				return *it;
+		}
+		return nullptr;
+	}
+
+	template <class Lists>
+	Lists& GetCategory(std::vector<Lists>& categories, uint32_t category)
+	{
+		if (category >= categories.size())
+		{
+			categories.resize(category + 1);
+		}
+		return categories[category];
+	}
+}
+
+void LruEvictionPolicy::VOnInsert(ResHandle* pHandle)
+{
+	Entry& entry = m_Entries[pHandle];
+	entry.m_Category = pHandle->GetCategory();
+	entry.m_LastUsed = ++m_Clock;
+	entry.m_IsPinned = pHandle->IsPinned();
+	if (!entry.m_IsPinned)
+	{
+		HandleList& handles = GetCategory(m_Categories, entry.m_Category);
+		handles.push_front(pHandle);
+		entry.m_Position = handles.begin();
+	}
+}
+
+void LruEvictionPolicy::VOnAccess(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end())
+		return;
+
+	// splice only relinks the node, the stored iterator stays valid
+	Entry& entry = it->second;
+	entry.m_LastUsed = ++m_Clock;
+	if (!entry.m_IsPinned)
+	{
+		HandleList& handles = m_Categories[entry.m_Category];
+		handles.splice(handles.begin(), handles, entry.m_Position);
+	}
+}
+
+void LruEvictionPolicy::VOnRemove(ResHandle* pHandle, bool isEvicted)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end())
+		return;
+
+	if (!it->second.m_IsPinned)
+	{
+		m_Categories[it->second.m_Category].erase(it->second.m_Position);
+	}
+	m_Entries.erase(it);
+}
+
+void LruEvictionPolicy::VOnPin(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end() || it->second.m_IsPinned)
+		return;
+
+	m_Categories[it->second.m_Category].erase(it->second.m_Position);
+	it->second.m_IsPinned = true;
+}
+
+void LruEvictionPolicy::VOnUnpin(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end() || !it->second.m_IsPinned)
+		return;
+
+	// It was in use all the while it was pinned
+	Entry& entry = it->second;
+	HandleList& handles = m_Categories[entry.m_Category];
+	handles.push_front(pHandle);
+	entry.m_Position = handles.begin();
+	entry.m_LastUsed = ++m_Clock;
+	entry.m_IsPinned = false;
+}
+
+ResHandle* LruEvictionPolicy::VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict)
+{
+	ResHandle* pVictim = nullptr;
+	uint64_t victimLastUsed = 0;
+	for (uint32_t category : categories)
+	{
+		if (category >= m_Categories.size())
+			continue;
+
+		ResHandle* pCandidate = FindOldest(m_Categories[category], canEvict);
+		if (pCandidate == nullptr)
+			continue;
+
+		uint64_t lastUsed = m_Entries[pCandidate].m_LastUsed;
+		if (pVictim == nullptr || lastUsed < victimLastUsed)
+		{
+			pVictim = pCandidate;
+			victimLastUsed = lastUsed;
+		}
+	}
+	return pVictim;
+}
+
+void LruEvictionPolicy::VClear()
+{
+	m_Categories.clear();
+	m_Entries.clear();
+}
+
+void LfuEvictionPolicy::VOnInsert(ResHandle* pHandle)
+{
+	Entry& entry = m_Entries[pHandle];
+	entry.m_Count = 1;
+	entry.m_Category = pHandle->GetCategory();
+	entry.m_LastUsed = ++m_Clock;
+	entry.m_IsPinned = pHandle->IsPinned();
+	if (!entry.m_IsPinned)
+	{
+		Link(pHandle, entry);
+	}
+}
+
+void LfuEvictionPolicy::VOnAccess(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end())
+		return;
+
+	Entry& entry = it->second;
+	entry.m_LastUsed = ++m_Clock;
+	if (entry.m_IsPinned)
+	{
+		entry.m_Count++;
+		return;
+	}
+
+	BucketMap& buckets = m_Categories[entry.m_Category];
+	BucketMap::iterator from = buckets.find(entry.m_Count);
+	HandleList& to = buckets[entry.m_Count + 1];
+	to.splice(to.begin(), from->second, entry.m_Position);
+	if (from->second.empty())
+	{
+		buckets.erase(from);
+	}
+	entry.m_Count++;
+}
+
+void LfuEvictionPolicy::VOnRemove(ResHandle* pHandle, bool isEvicted)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end())
+		return;
+
+	if (!it->second.m_IsPinned)
+	{
+		Unlink(it->second);
+	}
+	m_Entries.erase(it);
+}
+
+void LfuEvictionPolicy::VOnPin(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end() || it->second.m_IsPinned)
+		return;
+
+	Unlink(it->second);
+	it->second.m_IsPinned = true;
+}
+
+void LfuEvictionPolicy::VOnUnpin(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end() || !it->second.m_IsPinned)
+		return;
+
+	it->second.m_LastUsed = ++m_Clock;
+	it->second.m_IsPinned = false;
+	Link(pHandle, it->second);
+}
+
+ResHandle* LfuEvictionPolicy::VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict)
+{
+	ResHandle* pVictim = nullptr;
+	const Entry* pVictimEntry = nullptr;
+	for (uint32_t category : categories)
+	{
+		if (category >= m_Categories.size())
+			continue;
+
+		// The first bucket with a handle canEvict accepts holds this category's candidate
+		ResHandle* pCandidate = nullptr;
+		for (auto& bucket : m_Categories[category])
+		{
+			pCandidate = FindOldest(bucket.second, canEvict);
+			if (pCandidate != nullptr)
+				break;
+		}
+		if (pCandidate == nullptr)
+			continue;
+
+		const Entry& entry = m_Entries[pCandidate];
+		if (pVictimEntry == nullptr || entry.m_Count < pVictimEntry->m_Count ||
+			(entry.m_Count == pVictimEntry->m_Count && entry.m_LastUsed < pVictimEntry->m_LastUsed))
+		{
+			pVictim = pCandidate;
+			pVictimEntry = &entry;
+		}
+	}
+	return pVictim;
+}
+
+void LfuEvictionPolicy::VClear()
+{
+	m_Categories.clear();
+	m_Entries.clear();
+}
+
+void LfuEvictionPolicy::Link(ResHandle* pHandle, Entry& entry)
+{
+	HandleList& bucket = GetCategory(m_Categories, entry.m_Category)[entry.m_Count];
+	bucket.push_front(pHandle);
+	entry.m_Position = bucket.begin();
+}
+
+void LfuEvictionPolicy::Unlink(Entry& entry)
+{
+	BucketMap& buckets = m_Categories[entry.m_Category];
+	BucketMap::iterator bucket = buckets.find(entry.m_Count);
+	bucket->second.erase(entry.m_Position);
+	if (bucket->second.empty())
+	{
+		buckets.erase(bucket);
+	}
+}
+
+TwoQueueEvictionPolicy::TwoQueueEvictionPolicy(double probationShare)
+	: m_ProbationShare(probationShare),
+	m_ProbationBytes(0),
+	m_TotalBytes(0),
+	m_Clock(0)
+{
+
+}
+
+void TwoQueueEvictionPolicy::VOnInsert(ResHandle* pHandle)
+{
+	Entry entry;
+	entry.m_Size = pHandle->GetMemorySize();
+	entry.m_Category = pHandle->GetCategory();
+	entry.m_Queued = ++m_Clock;
+	entry.m_IsPinned = pHandle->IsPinned();
+
+	// Loaded again not long after it was evicted from probation, it is part of the working set
+	std::unordered_map<ResourceId, GhostList::iterator>::iterator ghost = m_GhostPositions.find(pHandle->GetId());
+	entry.m_IsMain = (ghost != m_GhostPositions.end());
+	if (entry.m_IsMain)
+	{
+		m_Ghosts.erase(ghost->second);
+		m_GhostPositions.erase(ghost);
+	}
+	else
+	{
+		m_ProbationBytes += entry.m_Size;
+	}
+
+	GetCategory(m_Categories, entry.m_Category);
+	if (!entry.m_IsPinned)
+	{
+		HandleList& queue = GetQueue(entry);
+		queue.push_front(pHandle);
+		entry.m_Position = queue.begin();
+	}
+
+	m_TotalBytes += entry.m_Size;
+	m_Entries[pHandle] = entry;
+}
+
+void TwoQueueEvictionPolicy::VOnAccess(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end())
+		return;
+
+	// Asked for again, promote it out of probation
+	Entry& entry = it->second;
+	if (!entry.m_IsPinned)
+	{
+		HandleList& main = m_Categories[entry.m_Category].m_Main;
+		main.splice(main.begin(), GetQueue(entry), entry.m_Position);
+	}
+	if (!entry.m_IsMain)
+	{
+		m_ProbationBytes -= entry.m_Size;
+		entry.m_IsMain = true;
+	}
+	entry.m_Queued = ++m_Clock;
+}
+
+void TwoQueueEvictionPolicy::VOnRemove(ResHandle* pHandle, bool isEvicted)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end())
+		return;
+
+	Entry& entry = it->second;
+	m_TotalBytes -= entry.m_Size;
+	if (!entry.m_IsPinned)
+	{
+		GetQueue(entry).erase(entry.m_Position);
+	}
+
+	if (!entry.m_IsMain)
+	{
+		m_ProbationBytes -= entry.m_Size;
+		if (isEvicted && m_GhostPositions.find(pHandle->GetId()) == m_GhostPositions.end())
+		{
+			m_Ghosts.push_front(pHandle->GetId());
+			m_GhostPositions[pHandle->GetId()] = m_Ghosts.begin();
+		}
+	}
+	m_Entries.erase(it);
+
+	size_t maxGhosts = std::max(m_Entries.size() / 2, (size_t)MIN_GHOSTS);
+	while (m_Ghosts.size() > maxGhosts)
+	{
+		m_GhostPositions.erase(m_Ghosts.back());
+		m_Ghosts.pop_back();
+	}
+}
+
+void TwoQueueEvictionPolicy::VOnPin(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end() || it->second.m_IsPinned)
+		return;
+
+	GetQueue(it->second).erase(it->second.m_Position);
+	it->second.m_IsPinned = true;
+}
+
+void TwoQueueEvictionPolicy::VOnUnpin(ResHandle* pHandle)
+{
+	std::unordered_map<ResHandle*, Entry>::iterator it = m_Entries.find(pHandle);
+	if (it == m_Entries.end() || !it->second.m_IsPinned)
+		return;
+
+	// Back to the front of the queue it was in, or was promoted to while pinned
+	Entry& entry = it->second;
+	HandleList& queue = GetQueue(entry);
+	queue.push_front(pHandle);
+	entry.m_Position = queue.begin();
+	entry.m_Queued = ++m_Clock;
+	entry.m_IsPinned = false;
+}
+
+ResHandle* TwoQueueEvictionPolicy::VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict)
+{
+	bool isProbationFirst = m_ProbationBytes > m_TotalBytes * m_ProbationShare;
+	ResHandle* pVictim = FindVictim(categories, !isProbationFirst, canEvict);
+	return (pVictim != nullptr) ? pVictim : FindVictim(categories, isProbationFirst, canEvict);
+}
+
+void TwoQueueEvictionPolicy::VClear()
+{
+	m_Categories.clear();
+	m_Ghosts.clear();
+	m_GhostPositions.clear();
+	m_Entries.clear();
+	m_ProbationBytes = 0;
+	m_TotalBytes = 0;
+}
+
+ResHandle* TwoQueueEvictionPolicy::FindVictim(const CategoryList& categories, bool isMain, const CanEvictPredicate& canEvict)
+{
+	ResHandle* pVictim = nullptr;
+	uint64_t victimQueued = 0;
+	for (uint32_t category : categories)
+	{
+		if (category >= m_Categories.size())
+			continue;
+
+		Queues& queues = m_Categories[category];
+		ResHandle* pCandidate = FindOldest(isMain ? queues.m_Main : queues.m_Probation, canEvict);
+		if (pCandidate == nullptr)
+			continue;
+
+		uint64_t queued = m_Entries[pCandidate].m_Queued;
+		if (pVictim == nullptr || queued < victimQueued)
+		{
+			pVictim = pCandidate;
+			victimQueued = queued;
+		}
+	}
+	return pVictim;
+}
+
+shared_ptr<IResourceEvictionPolicy> CreateEvictionPolicy(const std::string& name)
+{
+	std::string lower = name;
+	std::transform(lower.begin(), lower.end(), lower.begin(), (int(*)(int)) std::tolower);
+
+	if (lower == "lfu")
+	{
+		return shared_ptr<IResourceEvictionPolicy>(DEBUG_NEW LfuEvictionPolicy());
+	}
+	else if (lower == "2q")
+	{
+		return shared_ptr<IResourceEvictionPolicy>(DEBUG_NEW TwoQueueEvictionPolicy());
+	}
+	else if (lower != "lru")
+	{
+		DEBUG_WARNING("Unknown resource eviction policy " + name + ", using lru");
+	}
+	return shared_ptr<IResourceEvictionPolicy>(DEBUG_NEW LruEvictionPolicy());
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "ResourceId.h"
+
+class ResHandle;
+
+// Decides which resident handle the cache gives up when it needs room. The cache owns the
+// handles, a policy only keeps its own bookkeeping about them. Handles are kept apart by budget
+// category so a victim from one category is found without walking the others, and pinned
+// handles are left out until they are unpinned. Main thread only.
+class IResourceEvictionPolicy
+{
+public:
+	typedef std::function<bool(ResHandle*)> CanEvictPredicate;
+	typedef std::vector<uint32_t> CategoryList;
+
+	virtual ~IResourceEvictionPolicy() {}
+	virtual const char* VGetName() const = 0;
+	virtual void VOnInsert(ResHandle* pHandle) = 0;
+	virtual void VOnAccess(ResHandle* pHandle) = 0;
+	// isEvicted is false when the handle is removed or flushed rather than chosen as a victim
+	virtual void VOnRemove(ResHandle* pHandle, bool isEvicted) = 0;
+	// Called when the handle's first pin is taken and when its last pin is released
+	virtual void VOnPin(ResHandle* pHandle) = 0;
+	virtual void VOnUnpin(ResHandle* pHandle) = 0;
+	// The next handle to evict from the given categories among those canEvict accepts, nullptr if there is none
+	virtual ResHandle* VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict) = 0;
+	virtual void VClear() = 0;
+};
+
+// Least recently used, the cache's behaviour so far
+class LruEvictionPolicy : public IResourceEvictionPolicy
+{
+public:
+	LruEvictionPolicy() : m_Clock(0) {}
+
+	virtual const char* VGetName() const override { return "lru"; }
+	virtual void VOnInsert(ResHandle* pHandle) override;
+	virtual void VOnAccess(ResHandle* pHandle) override;
+	virtual void VOnRemove(ResHandle* pHandle, bool isEvicted) override;
+	virtual void VOnPin(ResHandle* pHandle) override;
+	virtual void VOnUnpin(ResHandle* pHandle) override;
+	virtual ResHandle* VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict) override;
+	virtual void VClear() override;
+
+private:
+	typedef std::list<ResHandle*> HandleList;
+
+	struct Entry
+	{
+		uint32_t m_Category;
+		uint64_t m_LastUsed;		// compares the oldest handles of different categories
+		bool m_IsPinned;			// pinned handles are in no list
+		HandleList::iterator m_Position;
+	};
+
+	std::vector<HandleList> m_Categories;		// per category, most recently used first
+	std::unordered_map<ResHandle*, Entry> m_Entries;
+	uint64_t m_Clock;
+};
+
+// Least frequently used, ties go to the least recently used. Counts are never aged, so this
+// suits projects that Flush between levels rather than long running sessions.
+class LfuEvictionPolicy : public IResourceEvictionPolicy
+{
+public:
+	LfuEvictionPolicy() : m_Clock(0) {}
+
+	virtual const char* VGetName() const override { return "lfu"; }
+	virtual void VOnInsert(ResHandle* pHandle) override;
+	virtual void VOnAccess(ResHandle* pHandle) override;
+	virtual void VOnRemove(ResHandle* pHandle, bool isEvicted) override;
+	virtual void VOnPin(ResHandle* pHandle) override;
+	virtual void VOnUnpin(ResHandle* pHandle) override;
+	virtual ResHandle* VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict) override;
+	virtual void VClear() override;
+
+private:
+	typedef std::list<ResHandle*> HandleList;
+	typedef std::map<uint64_t, HandleList> BucketMap;		// access count to handles, most recently used first
+
+	struct Entry
+	{
+		uint64_t m_Count;
+		uint32_t m_Category;
+		uint64_t m_LastUsed;		// breaks ties between categories
+		bool m_IsPinned;			// pinned handles are in no bucket
+		HandleList::iterator m_Position;
+	};
+
+	void Link(ResHandle* pHandle, Entry& entry);
+	void Unlink(Entry& entry);
+
+	std::vector<BucketMap> m_Categories;
+	std::unordered_map<ResHandle*, Entry> m_Entries;
+	uint64_t m_Clock;
+};
+
+// Scan resistant 2Q. New handles go to a FIFO probation queue and move to the LRU main queue
+// when they are asked for again, or loaded again shortly after being evicted from probation.
+// A one-off Preload or thumbnail pass churns through probation and leaves the working set alone.
+class TwoQueueEvictionPolicy : public IResourceEvictionPolicy
+{
+public:
+	// probationShare is the part of the resident bytes the probation queue may hold before it is
+	// evicted from first. Remembered ids of handles evicted from probation are capped at half the
+	// resident handle count, but never fewer than MIN_GHOSTS.
+	explicit TwoQueueEvictionPolicy(double probationShare = 0.25);
+
+	virtual const char* VGetName() const override { return "2q"; }
+	virtual void VOnInsert(ResHandle* pHandle) override;
+	virtual void VOnAccess(ResHandle* pHandle) override;
+	virtual void VOnRemove(ResHandle* pHandle, bool isEvicted) override;
+	virtual void VOnPin(ResHandle* pHandle) override;
+	virtual void VOnUnpin(ResHandle* pHandle) override;
+	virtual ResHandle* VSelectVictim(const CategoryList& categories, const CanEvictPredicate& canEvict) override;
+	virtual void VClear() override;
+
+	enum { MIN_GHOSTS = 64 };
+
+private:
+	typedef std::list<ResHandle*> HandleList;
+	typedef std::list<ResourceId> GhostList;
+
+	struct Entry
+	{
+		bool m_IsMain;
+		uint64_t m_Size;		// charged size when inserted, the handle may be gone when it is removed
+		uint32_t m_Category;
+		uint64_t m_Queued;		// when it entered its queue or was last used there
+		bool m_IsPinned;		// pinned handles are in no queue
+		HandleList::iterator m_Position;
+	};
+
+	struct Queues
+	{
+		HandleList m_Probation;		// newest first
+		HandleList m_Main;			// most recently used first
+	};
+
+	HandleList& GetQueue(const Entry& entry) { Queues& queues = m_Categories[entry.m_Category]; return entry.m_IsMain ? queues.m_Main : queues.m_Probation; }
+	ResHandle* FindVictim(const CategoryList& categories, bool isMain, const CanEvictPredicate& canEvict);
+
+	double m_ProbationShare;
+	std::vector<Queues> m_Categories;
+	GhostList m_Ghosts;			// newest first
+	std::unordered_map<ResourceId, GhostList::iterator> m_GhostPositions;
+	std::unordered_map<ResHandle*, Entry> m_Entries;
+	uint64_t m_ProbationBytes;
+	uint64_t m_TotalBytes;
+	uint64_t m_Clock;
+};
+
+// "lru", "lfu" or "2q", anything else falls back to LRU with a warning
+shared_ptr<IResourceEvictionPolicy> CreateEvictionPolicy(const std::string& name);
@@ -0,0 +1,581 @@
+#include "FileReader.h"
+#include "../Utilities/ThreadPool.h"
+#include "boost/thread/mutex.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+namespace
+{
+	// Reads in flight at once, enough to keep the queue of a fast drive busy
+	const uint32_t IO_THREAD_COUNT = 16;
+	const uint32_t IO_URING_DEPTH = 64;
+	// Largest single read, Win32 counts in 32 bits
+	const size_t MAX_READ = 0x40000000;
+
+	// One read at a time on the calling thread
+	class PositionalFileReader : public IFileReader, public boost::noncopyable
+	{
+	public:
+		explicit PositionalFileReader(bool isMapping);
+		virtual ~PositionalFileReader() { Close(); }
+
+		virtual bool VOpen(const std::wstring& fileName) override;
+		virtual uint64_t VGetSize() const override { return m_FileSize; }
+		virtual const char* VGetMappedData() const override { return m_pMappedData; }
+		virtual bool VRead(uint64_t offset, void* pBuffer, size_t size) override;
+		virtual bool VReadBatch(std::vector<FileReadRequest>& requests) override;
+		virtual const char* VGetName() const override { return (m_pMappedData != nullptr) ? "map" : "blocking"; }
+
+	protected:
+		void Close();
+
+		bool m_IsMapping;
+		uint64_t m_FileSize;
+		const char* m_pMappedData;
+#if defined(_WIN32)
+		HANDLE m_hFile;
+		HANDLE m_hMapping;
+#else
+		int m_Fd;
+#endif
+	};
+
+	PositionalFileReader::PositionalFileReader(bool isMapping)
+		: m_IsMapping(isMapping),
+		m_FileSize(0),
+		m_pMappedData(nullptr),
+#if defined(_WIN32)
+		m_hFile(INVALID_HANDLE_VALUE),
+		m_hMapping(nullptr)
+#else
+		m_Fd(-1)
+#endif
+	{
+	}
+
+#if defined(_WIN32)
+
+	bool PositionalFileReader::VOpen(const std::wstring& fileName)
+	{
+		Close();
+
+		m_hFile = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_hFile, &fileSize))
+		{
+			Close();
+			return false;
+		}
+		m_FileSize = fileSize.QuadPart;
+
+		// Can fail for very large files in a 32 bit process, reads still work then
+		m_hMapping = (m_IsMapping && m_FileSize > 0) ? CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		if (m_hMapping != nullptr)
+		{
+			m_pMappedData = (const char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+			if (m_pMappedData == nullptr)
+			{
+				CloseHandle(m_hMapping);
+				m_hMapping = nullptr;
+			}
+		}
+		return true;
+	}
+
+	void PositionalFileReader::Close()
+	{
+		if (m_pMappedData != nullptr)
+		{
+			UnmapViewOfFile(m_pMappedData);
+			m_pMappedData = nullptr;
+		}
+		if (m_hMapping != nullptr)
+		{
+			CloseHandle(m_hMapping);
+			m_hMapping = nullptr;
+		}
+		if (m_hFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_hFile);
+			m_hFile = INVALID_HANDLE_VALUE;
+		}
+		m_FileSize = 0;
+	}
+
+	bool PositionalFileReader::VRead(uint64_t offset, void* pBuffer, size_t size)
+	{
+		if (offset > m_FileSize || size > m_FileSize - offset)
+			return false;
+
+		char* pDest = (char*)pBuffer;
+		while (size > 0)
+		{
+			OVERLAPPED overlapped;
+			memset(&overlapped, 0, sizeof(overlapped));
+			overlapped.Offset = (DWORD)(offset & 0xffffffff);
+			overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+			DWORD bytesRead = 0;
+			if (!ReadFile(m_hFile, pDest, (DWORD)std::min(size, MAX_READ), &bytesRead, &overlapped) || bytesRead == 0)
+				return false;
+
+			pDest += bytesRead;
+			offset += bytesRead;
+			size -= bytesRead;
+		}
+		return true;
+	}
+
+#else
+
+	bool PositionalFileReader::VOpen(const std::wstring& fileName)
+	{
+		Close();
+
+		m_Fd = open(Utility::WS2S(fileName).c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_Fd < 0)
+			return false;
+
+		struct stat status;
+		if (fstat(m_Fd, &status) != 0)
+		{
+			Close();
+			return false;
+		}
+		m_FileSize = status.st_size;
+
+		if (m_IsMapping && m_FileSize > 0 && m_FileSize <= SIZE_MAX)
+		{
+			void* pMapped = mmap(nullptr, (size_t)m_FileSize, PROT_READ, MAP_SHARED, m_Fd, 0);
+			m_pMappedData = (pMapped != MAP_FAILED) ? (const char*)pMapped : nullptr;
+		}
+		return true;
+	}
+
+	void PositionalFileReader::Close()
+	{
+		if (m_pMappedData != nullptr)
+		{
+			munmap((void*)m_pMappedData, (size_t)m_FileSize);
+			m_pMappedData = nullptr;
+		}
+		if (m_Fd >= 0)
+		{
+			close(m_Fd);
+			m_Fd = -1;
+		}
+		m_FileSize = 0;
+	}
+
+	bool PositionalFileReader::VRead(uint64_t offset, void* pBuffer, size_t size)
+	{
+		if (offset > m_FileSize || size > m_FileSize - offset)
+			return false;
+
+		char* pDest = (char*)pBuffer;
+		while (size > 0)
+		{
+			ssize_t bytesRead = pread(m_Fd, pDest, std::min(size, MAX_READ), (off_t)offset);
+			if (bytesRead < 0 && errno == EINTR)
+				continue;
+			if (bytesRead <= 0)
+				return false;
+
+			pDest += bytesRead;
+			offset += bytesRead;
+			size -= bytesRead;
+		}
+		return true;
+	}
+
+#endif
+
+	bool PositionalFileReader::VReadBatch(std::vector<FileReadRequest>& requests)
+	{
+		bool success = true;
+		for (auto& request : requests)
+		{
+			request.m_IsDone = VRead(request.m_Offset, request.m_pBuffer, request.m_Size);
+			success = success && request.m_IsDone;
+		}
+		return success;
+	}
+
+	// Blocking reads spread over threads of its own, they wait on the drive and not on the CPU
+	// so they don't take workers away from decoding. A mapped file reads through the mapping
+	// and gets no threads.
+	class ThreadPoolFileReader : public PositionalFileReader
+	{
+	public:
+		explicit ThreadPoolFileReader(bool isMapping) : PositionalFileReader(isMapping) {}
+
+		virtual bool VOpen(const std::wstring& fileName) override;
+		virtual bool VReadBatch(std::vector<FileReadRequest>& requests) override;
+		virtual const char* VGetName() const override { return (m_pMappedData != nullptr) ? "map" : "threads"; }
+
+	private:
+		unique_ptr<ThreadPool> m_pThreads;
+	};
+
+	bool ThreadPoolFileReader::VOpen(const std::wstring& fileName)
+	{
+		if (!PositionalFileReader::VOpen(fileName))
+			return false;
+
+		if (m_pMappedData == nullptr && m_pThreads == nullptr)
+		{
+			m_pThreads.reset(DEBUG_NEW ThreadPool(IO_THREAD_COUNT));
+		}
+		return true;
+	}
+
+	bool ThreadPoolFileReader::VReadBatch(std::vector<FileReadRequest>& requests)
+	{
+		if (m_pThreads == nullptr)
+			return PositionalFileReader::VReadBatch(requests);
+
+		m_pThreads->ParallelFor((uint32_t)requests.size(), [this, &requests](uint32_t i)
+		{
+			FileReadRequest& request = requests[i];
+			request.m_IsDone = VRead(request.m_Offset, request.m_pBuffer, request.m_Size);
+		});
+
+		for (const auto& request : requests)
+		{
+			if (!request.m_IsDone)
+				return false;
+		}
+		return true;
+	}
+
+#if defined(__linux__)
+
+	// Submits a whole batch to an io_uring and reaps the completions, one thread keeps
+	// IO_URING_DEPTH reads in flight. Batches that find the ring busy, or a kernel without
+	// io_uring, use the thread pool instead.
+	class IoUringFileReader : public ThreadPoolFileReader
+	{
+	public:
+		explicit IoUringFileReader(bool isMapping);
+		virtual ~IoUringFileReader() { CloseRing(); }
+
+		virtual bool VOpen(const std::wstring& fileName) override;
+		virtual bool VReadBatch(std::vector<FileReadRequest>& requests) override;
+		virtual const char* VGetName() const override { return (m_pMappedData != nullptr) ? "map" : (m_RingFd >= 0) ? "io_uring" : "threads"; }
+
+	private:
+		bool SetupRing();
+		void CloseRing();
+		// False when the ring itself failed, the requests not done are left for the caller
+		bool ReadOnRing(std::vector<FileReadRequest>& requests);
+
+		boost::mutex m_RingMutex;
+		int m_RingFd;
+		uint32_t m_Depth;
+		void* m_pSqRing;
+		size_t m_SqRingSize;
+		void* m_pCqRing;
+		size_t m_CqRingSize;
+		io_uring_sqe* m_pSqes;
+		size_t m_SqesSize;
+		unsigned* m_pSqTail;
+		unsigned* m_pSqMask;
+		unsigned* m_pSqArray;
+		unsigned* m_pCqHead;
+		unsigned* m_pCqTail;
+		unsigned* m_pCqMask;
+		io_uring_cqe* m_pCqes;
+	};
+
+	IoUringFileReader::IoUringFileReader(bool isMapping)
+		: ThreadPoolFileReader(isMapping),
+		m_RingFd(-1),
+		m_Depth(0),
+		m_pSqRing(nullptr),
+		m_SqRingSize(0),
+		m_pCqRing(nullptr),
+		m_CqRingSize(0),
+		m_pSqes(nullptr),
+		m_SqesSize(0)
+	{
+	}
+
+	bool IoUringFileReader::VOpen(const std::wstring& fileName)
+	{
+		CloseRing();
+		if (!ThreadPoolFileReader::VOpen(fileName))
+			return false;
+
+		if (m_pMappedData == nullptr && !SetupRing())
+		{
+			DEBUG_INFO("io_uring is not available, reading with threads");
+		}
+		return true;
+	}
+
+	bool IoUringFileReader::SetupRing()
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		m_RingFd = (int)syscall(__NR_io_uring_setup, IO_URING_DEPTH, &params);
+		if (m_RingFd < 0)
+			return false;
+
+		// Newer kernels put both rings in one mapping
+		m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool isSingleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (isSingleMapping)
+		{
+			m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+		}
+
+		void* pSqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQ_RING);
+		m_pSqRing = (pSqRing != MAP_FAILED) ? pSqRing : nullptr;
+		void* pCqRing = isSingleMapping ? pSqRing : mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_CQ_RING);
+		m_pCqRing = (pCqRing != MAP_FAILED) ? pCqRing : nullptr;
+		m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		void* pSqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQES);
+		m_pSqes = (pSqes != MAP_FAILED) ? (io_uring_sqe*)pSqes : nullptr;
+		if (m_pSqRing == nullptr || m_pCqRing == nullptr || m_pSqes == nullptr)
+		{
+			CloseRing();
+			return false;
+		}
+
+		char* pSq = (char*)m_pSqRing;
+		m_pSqTail = (unsigned*)(pSq + params.sq_off.tail);
+		m_pSqMask = (unsigned*)(pSq + params.sq_off.ring_mask);
+		m_pSqArray = (unsigned*)(pSq + params.sq_off.array);
+		char* pCq = (char*)m_pCqRing;
+		m_pCqHead = (unsigned*)(pCq + params.cq_off.head);
+		m_pCqTail = (unsigned*)(pCq + params.cq_off.tail);
+		m_pCqMask = (unsigned*)(pCq + params.cq_off.ring_mask);
+		m_pCqes = (io_uring_cqe*)(pCq + params.cq_off.cqes);
+
+		// The completion ring is at least as large, it can never overflow
+		m_Depth = params.sq_entries;
+		return true;
+	}
+
+	void IoUringFileReader::CloseRing()
+	{
+		if (m_pSqes != nullptr)
+		{
+			munmap(m_pSqes, m_SqesSize);
+			m_pSqes = nullptr;
+		}
+		if (m_pCqRing != nullptr && m_pCqRing != m_pSqRing)
+		{
+			munmap(m_pCqRing, m_CqRingSize);
+		}
+		m_pCqRing = nullptr;
+		if (m_pSqRing != nullptr)
+		{
+			munmap(m_pSqRing, m_SqRingSize);
+			m_pSqRing = nullptr;
+		}
+		if (m_RingFd >= 0)
+		{
+			close(m_RingFd);
+			m_RingFd = -1;
+		}
+	}
+
+	bool IoUringFileReader::VReadBatch(std::vector<FileReadRequest>& requests)
+	{
+		boost::mutex::scoped_lock lock(m_RingMutex, boost::try_to_lock);
+		if (!lock.owns_lock() || m_RingFd < 0)
+			return ThreadPoolFileReader::VReadBatch(requests);
+
+		if (ReadOnRing(requests))
+		{
+			for (const auto& request : requests)
+			{
+				if (!request.m_IsDone)
+					return false;
+			}
+			return true;
+		}
+
+		// Whatever the ring did not finish goes to the threads, the ring is not used again
+		DEBUG_WARNING("io_uring failed, reading with threads");
+		CloseRing();
+		std::vector<FileReadRequest> rest;
+		std::vector<size_t> restIndices;
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			if (!requests[i].m_IsDone)
+			{
+				rest.push_back(requests[i]);
+				restIndices.push_back(i);
+			}
+		}
+		bool success = ThreadPoolFileReader::VReadBatch(rest);
+		for (size_t n = 0; n < rest.size(); ++n)
+		{
+			requests[restIndices[n]].m_IsDone = rest[n].m_IsDone;
+		}
+		return success;
+	}
+
+	bool IoUringFileReader::ReadOnRing(std::vector<FileReadRequest>& requests)
+	{
+		struct Read
+		{
+			uint64_t m_Done;
+			struct iovec m_Vector;
+		};
+		std::vector<Read> reads(requests.size());
+
+		// Waiting for a slot, back to front so they go out in file order. Short reads come back here.
+		std::vector<size_t> waiting;
+		waiting.reserve(requests.size());
+		for (size_t i = requests.size(); i-- > 0;)
+		{
+			FileReadRequest& request = requests[i];
+			reads[i].m_Done = 0;
+			request.m_IsDone = (request.m_Size == 0);
+			if (!request.m_IsDone && request.m_Offset <= m_FileSize && request.m_Size <= m_FileSize - request.m_Offset)
+			{
+				waiting.push_back(i);
+			}
+		}
+
+		uint32_t inFlight = 0;
+		uint32_t unsubmitted = 0;
+		bool isFailing = false;
+		while (inFlight > 0 || (!waiting.empty() && !isFailing))
+		{
+			while (!waiting.empty() && !isFailing && inFlight < m_Depth)
+			{
+				size_t i = waiting.back();
+				waiting.pop_back();
+				const FileReadRequest& request = requests[i];
+				Read& read = reads[i];
+				read.m_Vector.iov_base = request.m_pBuffer + read.m_Done;
+				read.m_Vector.iov_len = std::min<uint64_t>(request.m_Size - read.m_Done, MAX_READ);
+
+				unsigned tail = *m_pSqTail;
+				unsigned index = tail & *m_pSqMask;
+				io_uring_sqe* pSqe = &m_pSqes[index];
+				memset(pSqe, 0, sizeof(*pSqe));
+				pSqe->opcode = IORING_OP_READV;
+				pSqe->fd = m_Fd;
+				pSqe->addr = (uint64_t)(uintptr_t)&read.m_Vector;
+				pSqe->len = 1;
+				pSqe->off = request.m_Offset + read.m_Done;
+				pSqe->user_data = i;
+				m_pSqArray[index] = index;
+				__atomic_store_n(m_pSqTail, tail + 1, __ATOMIC_RELEASE);
+				++inFlight;
+				++unsubmitted;
+			}
+
+			int submitted = (int)syscall(__NR_io_uring_enter, m_RingFd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (submitted >= 0)
+			{
+				unsubmitted -= submitted;
+			}
+			else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				// What never reached the kernel is dropped, what did is still waited for
+				inFlight -= unsubmitted;
+				unsubmitted = 0;
+				if (isFailing)
+					break;
+				isFailing = true;
+			}
+
+			unsigned head = *m_pCqHead;
+			while (head != __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE))
+			{
+				const io_uring_cqe& cqe = m_pCqes[head & *m_pCqMask];
+				size_t i = (size_t)cqe.user_data;
+				--inFlight;
+				if (cqe.res > 0)
+				{
+					reads[i].m_Done += cqe.res;
+					if (reads[i].m_Done < requests[i].m_Size)
+					{
+						waiting.push_back(i);
+					}
+					else
+					{
+						requests[i].m_IsDone = true;
+					}
+				}
+				else if (cqe.res == -EAGAIN || cqe.res == -EINTR)
+				{
+					waiting.push_back(i);
+				}
+				++head;
+			}
+			__atomic_store_n(m_pCqHead, head, __ATOMIC_RELEASE);
+		}
+		return !isFailing;
+	}
+
+#endif
+}
+
+unique_ptr<IFileReader> CreateFileReader(FileReaderType type)
+{
+	switch (type)
+	{
+	case FileReader_Blocking:
+		return unique_ptr<IFileReader>(DEBUG_NEW PositionalFileReader(false));
+	case FileReader_ThreadPool:
+		return unique_ptr<IFileReader>(DEBUG_NEW ThreadPoolFileReader(false));
+#if defined(__linux__)
+	case FileReader_IoUring:
+		return unique_ptr<IFileReader>(DEBUG_NEW IoUringFileReader(false));
+	default:
+		return unique_ptr<IFileReader>(DEBUG_NEW IoUringFileReader(true));
+#else
+	case FileReader_IoUring:
+		return unique_ptr<IFileReader>(DEBUG_NEW ThreadPoolFileReader(false));
+	default:
+		return unique_ptr<IFileReader>(DEBUG_NEW ThreadPoolFileReader(true));
+#endif
+	}
+}
+
+FileReaderType GetFileReaderType(const std::string& name)
+{
+	std::string lower = name;
+	std::transform(lower.begin(), lower.end(), lower.begin(), (int(*)(int)) std::tolower);
+
+	if (lower == "blocking")
+	{
+		return FileReader_Blocking;
+	}
+	else if (lower == "threads")
+	{
+		return FileReader_ThreadPool;
+	}
+	else if (lower == "io_uring")
+	{
+		return FileReader_IoUring;
+	}
+	else if (lower != "map" && !lower.empty())
+	{
+		DEBUG_WARNING("Unknown file reader " + name + ", mapping the file");
+	}
+	return FileReader_Mapped;
+}
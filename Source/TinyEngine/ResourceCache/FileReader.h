@@ -0,0 +1,24 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "../TinyEngineInterface.h"
+
+// Positional reads from one file, the archives read through it. Reentrant, the offset travels
+// with every read instead of living in the file, so any number of threads may read at once.
+class IFileReader
+{
+public:
+	virtual ~IFileReader() {}
+	virtual bool VOpen(const std::wstring& fileName) = 0;
+	virtual uint64_t VGetSize() const = 0;
+	// The whole file read only, nullptr when the reader does not map or mapping failed.
+	// Valid for as long as the reader.
+	virtual const char* VGetMappedData() const = 0;
+	virtual bool VRead(uint64_t offset, void* pBuffer, size_t size) = 0;
+	// Keeps the reads in flight together and returns once all of them are done, false if any failed
+	virtual bool VReadBatch(std::vector<FileReadRequest>& requests) = 0;
+	virtual const char* VGetName() const = 0;
+};
+
+unique_ptr<IFileReader> CreateFileReader(FileReaderType type);
+// "map", "blocking", "threads" or "io_uring", anything else maps
+FileReaderType GetFileReaderType(const std::string& name);
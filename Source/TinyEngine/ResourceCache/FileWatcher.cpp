@@ -0,0 +1,322 @@
+#include "FileWatcher.h"
+#include "boost/filesystem/operations.hpp"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace
+{
+	class InotifyFileWatcher : public IFileWatcher, public boost::noncopyable
+	{
+	public:
+		InotifyFileWatcher() : m_Fd(-1) {}
+		virtual ~InotifyFileWatcher();
+
+		virtual bool VWatch(const std::string& rootDir) override;
+		virtual bool VPoll(std::vector<std::string>& changedNames) override;
+
+	private:
+		// Watches the directory and everything below it, the files found are appended to names
+		void AddWatches(const std::string& relativeDir, std::vector<std::string>* pNames);
+
+		int m_Fd;
+		std::string m_Root;
+		std::unordered_map<int, std::string> m_Directories;		// by watch descriptor, relative and ending in '/'
+	};
+
+	// Created files are reported once they are closed, only new directories matter right away
+	const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+	InotifyFileWatcher::~InotifyFileWatcher()
+	{
+		if (m_Fd >= 0)
+		{
+			close(m_Fd);
+		}
+	}
+
+	bool InotifyFileWatcher::VWatch(const std::string& rootDir)
+	{
+		m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_Fd < 0)
+			return false;
+
+		m_Root = rootDir;
+		std::replace(m_Root.begin(), m_Root.end(), '\\', '/');
+		if (!m_Root.empty() && m_Root.back() != '/')
+		{
+			m_Root += '/';
+		}
+
+		AddWatches("", nullptr);
+		return !m_Directories.empty();
+	}
+
+	void InotifyFileWatcher::AddWatches(const std::string& relativeDir, std::vector<std::string>* pNames)
+	{
+		std::string path = m_Root + relativeDir;
+		int wd = inotify_add_watch(m_Fd, path.c_str(), WATCH_MASK);
+		if (wd < 0)
+			return;
+
+		m_Directories[wd] = relativeDir;
+
+		boost::system::error_code error;
+		for (boost::filesystem::directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+		{
+			std::string name = relativeDir + it->path().filename().string();
+			boost::system::error_code statusError;
+			boost::filesystem::file_status status = it->status(statusError);
+			if (boost::filesystem::is_directory(status))
+			{
+				AddWatches(name + "/", pNames);
+			}
+			else if (pNames != nullptr && boost::filesystem::is_regular_file(status))
+			{
+				pNames->push_back(name);
+			}
+		}
+	}
+
+	bool InotifyFileWatcher::VPoll(std::vector<std::string>& changedNames)
+	{
+		if (m_Fd < 0)
+			return true;
+
+		bool isComplete = true;
+		alignas(struct inotify_event) char buffer[4096];
+		for (;;)
+		{
+			ssize_t length = read(m_Fd, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				// EAGAIN, nothing left to read
+				break;
+			}
+
+			for (char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len)
+			{
+				const struct inotify_event* pEvent = (const struct inotify_event*)p;
+				if (pEvent->mask & IN_Q_OVERFLOW)
+				{
+					isComplete = false;
+					continue;
+				}
+
+				if (pEvent->mask & IN_IGNORED)
+				{
+					m_Directories.erase(pEvent->wd);
+					continue;
+				}
+
+				std::unordered_map<int, std::string>::const_iterator directory = m_Directories.find(pEvent->wd);
+				if (directory == m_Directories.end() || pEvent->len == 0)
+					continue;
+
+				std::string name = directory->second + pEvent->name;
+				if (pEvent->mask & IN_ISDIR)
+				{
+					// Files may have been written before the watch was in place
+					if (pEvent->mask & (IN_CREATE | IN_MOVED_TO))
+					{
+						AddWatches(name + "/", &changedNames);
+					}
+				}
+				else if ((pEvent->mask & IN_CREATE) == 0)
+				{
+					changedNames.push_back(name);
+				}
+			}
+		}
+		return isComplete;
+	}
+}
+
+unique_ptr<IFileWatcher> CreateFileWatcher()
+{
+	return unique_ptr<IFileWatcher>(DEBUG_NEW InotifyFileWatcher());
+}
+
+#elif defined(_WIN32)
+#include <chrono>
+
+namespace
+{
+	class Win32FileWatcher : public IFileWatcher, public boost::noncopyable
+	{
+	public:
+		Win32FileWatcher();
+		virtual ~Win32FileWatcher();
+
+		virtual bool VWatch(const std::string& rootDir) override;
+		virtual bool VPoll(std::vector<std::string>& changedNames) override;
+
+	private:
+		// The directory handle and the first read
+		bool Open();
+		// Cancels the read and closes the directory handle
+		void Close();
+		bool IssueRead();
+		// Closes the watch and tries again after RETRY_INTERVAL, logs the first failure only
+		void Fail();
+
+		std::string m_RootDir;
+		HANDLE m_hDirectory;
+		OVERLAPPED m_Overlapped;
+		std::vector<DWORD> m_Buffer;		// FILE_NOTIFY_INFORMATION needs DWORD alignment
+		bool m_IsReading;
+		bool m_IsFailing;
+		std::chrono::steady_clock::time_point m_RetryAt;
+	};
+
+	const DWORD NOTIFY_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+	const std::chrono::seconds RETRY_INTERVAL(2);
+
+	Win32FileWatcher::Win32FileWatcher()
+		: m_hDirectory(INVALID_HANDLE_VALUE),
+		m_Buffer(16 * 1024),
+		m_IsReading(false),
+		m_IsFailing(false)
+	{
+		ZeroMemory(&m_Overlapped, sizeof(m_Overlapped));
+	}
+
+	Win32FileWatcher::~Win32FileWatcher()
+	{
+		Close();
+		if (m_Overlapped.hEvent != nullptr)
+		{
+			CloseHandle(m_Overlapped.hEvent);
+		}
+	}
+
+	bool Win32FileWatcher::VWatch(const std::string& rootDir)
+	{
+		m_RootDir = rootDir;
+		return Open();
+	}
+
+	bool Win32FileWatcher::Open()
+	{
+		m_hDirectory = CreateFileW(Utility::S2WS(m_RootDir).c_str(), FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (m_hDirectory == INVALID_HANDLE_VALUE)
+			return false;
+
+		if (m_Overlapped.hEvent == nullptr)
+		{
+			m_Overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		}
+		return m_Overlapped.hEvent != nullptr && IssueRead();
+	}
+
+	void Win32FileWatcher::Close()
+	{
+		if (m_hDirectory == INVALID_HANDLE_VALUE)
+			return;
+
+		// The kernel writes into m_Buffer until the read is really gone
+		if (m_IsReading && CancelIoEx(m_hDirectory, &m_Overlapped))
+		{
+			DWORD bytes = 0;
+			GetOverlappedResult(m_hDirectory, &m_Overlapped, &bytes, TRUE);
+		}
+		CloseHandle(m_hDirectory);
+		m_hDirectory = INVALID_HANDLE_VALUE;
+		m_IsReading = false;
+	}
+
+	bool Win32FileWatcher::IssueRead()
+	{
+		ResetEvent(m_Overlapped.hEvent);
+		m_IsReading = ReadDirectoryChangesW(m_hDirectory, m_Buffer.data(), (DWORD)(m_Buffer.size() * sizeof(DWORD)),
+			TRUE, NOTIFY_FILTER, nullptr, &m_Overlapped, nullptr) != FALSE;
+		return m_IsReading;
+	}
+
+	void Win32FileWatcher::Fail()
+	{
+		// The directory was removed or renamed, or the share it is on went away
+		if (!m_IsFailing)
+		{
+			DEBUG_WARNING("Lost the watch on " + m_RootDir + ", changed files are not reloaded until it is back");
+			m_IsFailing = true;
+		}
+		Close();
+		m_RetryAt = std::chrono::steady_clock::now() + RETRY_INTERVAL;
+	}
+
+	bool Win32FileWatcher::VPoll(std::vector<std::string>& changedNames)
+	{
+		if (m_hDirectory == INVALID_HANDLE_VALUE)
+		{
+			// Nothing to report while the watch is down, the cache would wait for changes to settle forever
+			if (std::chrono::steady_clock::now() < m_RetryAt)
+				return true;
+
+			if (!Open())
+			{
+				Fail();
+				return true;
+			}
+
+			// Whatever changed in the meantime was missed
+			DEBUG_INFO("Watching " + m_RootDir + " for changes again");
+			m_IsFailing = false;
+			return false;
+		}
+
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(m_hDirectory, &m_Overlapped, &bytes, FALSE))
+		{
+			if (GetLastError() == ERROR_IO_INCOMPLETE)
+				return true;
+
+			// The read is over, the changes it was waiting for are lost
+			m_IsReading = false;
+			if (!IssueRead())
+			{
+				Fail();
+			}
+			return false;
+		}
+
+		// No bytes means the buffer overflowed and the changes are lost
+		bool isComplete = (bytes != 0);
+		const char* p = (const char*)m_Buffer.data();
+		while (isComplete)
+		{
+			const FILE_NOTIFY_INFORMATION* pInfo = (const FILE_NOTIFY_INFORMATION*)p;
+			std::wstring name(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+			changedNames.push_back(Utility::WS2S(name));
+
+			if (pInfo->NextEntryOffset == 0)
+				break;
+
+			p += pInfo->NextEntryOffset;
+		}
+
+		if (!IssueRead())
+		{
+			Fail();
+		}
+		return isComplete;
+	}
+}
+
+unique_ptr<IFileWatcher> CreateFileWatcher()
+{
+	return unique_ptr<IFileWatcher>(DEBUG_NEW Win32FileWatcher());
+}
+
+#else
+
+unique_ptr<IFileWatcher> CreateFileWatcher()
+{
+	return unique_ptr<IFileWatcher>();
+}
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+#include "../TinyEngineBase.h"
+
+// Reports files that were written, created, removed or renamed below a directory. Names are
+// relative to the watched directory. Polled from the main thread, VPoll never blocks.
+class IFileWatcher
+{
+public:
+	virtual ~IFileWatcher() {}
+	virtual bool VWatch(const std::string& rootDir) = 0;
+	// Appends the names changed since the last call, a name may show up more than once.
+	// Returns false when the platform dropped events, anything below the root may have changed.
+	virtual bool VPoll(std::vector<std::string>& changedNames) = 0;
+};
+
+// inotify on Linux, ReadDirectoryChangesW on Windows, nullptr where neither is available
+unique_ptr<IFileWatcher> CreateFileWatcher();
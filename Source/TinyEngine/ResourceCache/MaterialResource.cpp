@@ -2,10 +2,37 @@
 #include "XmlResource.h"
 #include "../AppFramework/BaseGameApp.h"
 #include <d3dcompiler.h>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	// Bump when the effect byte code kept in the derived data cache changes shape
+	const uint32_t EFFECT_BYTE_CODE_VERSION = 1;
+
+	// The compiler reads included files itself, the key would not change with them. Anything
+	// that looks like an #include counts, one in a comment only costs the cache.
+	bool HasIncludes(const char* pSource, uint32_t size)
+	{
+		const char* pEnd = pSource + size;
+		for (const char* p = std::find(pSource, pEnd, '#'); p != pEnd; p = std::find(p + 1, pEnd, '#'))
+		{
+			const char* pWord = p + 1;
+			while (pWord != pEnd && (*pWord == ' ' || *pWord == '\t'))
+			{
+				++pWord;
+			}
+			if (pEnd - pWord >= 7 && std::strncmp(pWord, "include", 7) == 0)
+				return true;
+		}
+		return false;
+	}
+}
 
 HlslResourceExtraData::HlslResourceExtraData()
 	: m_pD3DX11Effect(nullptr),
-	m_pEffect(nullptr)
+	m_pEffect(nullptr),
+	m_Size(0)
 {
 
 }
@@ -23,7 +50,33 @@ bool FxSourceEffectResourceLoader::VLoadResource(char *rawBuffer, uint32_t rawSi
 	{
 		shared_ptr<HlslResourceExtraData> extra = shared_ptr<HlslResourceExtraData>(DEBUG_NEW HlslResourceExtraData());
 
-		if (g_pApp->GetRendererAPI()->VCompileShaderFromMemory(rawBuffer, rawSize, extra))
+		// Compiling is what takes the time, byte code from an earlier run only needs creating
+		shared_ptr<IRenderer> pRenderer = g_pApp->GetRendererAPI();
+		shared_ptr<DerivedDataCache> pDerivedData = g_pApp->GetResCache()->GetDerivedDataCache();
+		if (pDerivedData != nullptr && !HasIncludes(rawBuffer, rawSize))
+		{
+			uint64_t key = DerivedDataCache::MakeKey(rawBuffer, rawSize, "effect", EFFECT_BYTE_CODE_VERSION, pRenderer->VGetShaderCompileOptions());
+			std::vector<char> byteCode;
+			if (pDerivedData->Get(key, byteCode) && pRenderer->VCreateShaderFromMemory(byteCode.data(), (uint32_t)byteCode.size(), extra))
+			{
+				handle->SetExtraData(extra);
+				return true;
+			}
+
+			// A miss, or byte code the runtime turns down, is compiled again and replaces the blob
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			byteCode.clear();
+			if (pRenderer->VCompileShaderToByteCode(rawBuffer, rawSize, byteCode))
+			{
+				pDerivedData->Put(key, byteCode.data(), byteCode.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+				if (pRenderer->VCreateShaderFromMemory(byteCode.data(), (uint32_t)byteCode.size(), extra))
+				{
+					handle->SetExtraData(extra);
+					return true;
+				}
+			}
+		}
+		else if (pRenderer->VCompileShaderFromMemory(rawBuffer, rawSize, extra))
 		{
 			handle->SetExtraData(extra);
 			return true;
@@ -75,6 +128,33 @@ bool MaterialResourceLoader::VLoadResource(char *rawBuffer, uint32_t rawSize, sh
 	return true;
 }
 
+void MaterialResourceLoader::VGetDependencies(shared_ptr<ResHandle> handle, std::vector<std::string>& dependencies)
+{
+	shared_ptr<XmlResourceExtraData> pExtraData = static_pointer_cast<XmlResourceExtraData>(handle->GetExtraData());
+	const tinyxml2::XMLElement* pRoot = (pExtraData != nullptr) ? pExtraData->GetRoot() : nullptr;
+	if (pRoot == nullptr)
+		return;
+
+	if (pRoot->Attribute("object") != nullptr)
+	{
+		dependencies.push_back(pRoot->Attribute("object"));
+	}
+
+	// Scene nodes look textures up under Textures\ by the variable's resource name
+	const tinyxml2::XMLElement* pVariables = pRoot->FirstChildElement("Variables");
+	if (pVariables == nullptr)
+		return;
+
+	for (const tinyxml2::XMLElement* pNode = pVariables->FirstChildElement(); pNode; pNode = pNode->NextSiblingElement())
+	{
+		const char* resourceName = pNode->Attribute("resourcename");
+		if (resourceName != nullptr)
+		{
+			dependencies.push_back(std::string("Textures\\") + resourceName);
+		}
+	}
+}
+
 tinyxml2::XMLElement* MaterialResourceLoader::LoadAndReturnRootXmlElement(const std::string& resourceString)
 {
 	Resource resource(resourceString);
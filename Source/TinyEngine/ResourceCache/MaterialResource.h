@@ -13,11 +13,13 @@ public:
 	virtual ~HlslResourceExtraData();
 
 	virtual std::string VToString() { return "ShaderResourceExtraData"; }
+	virtual uint64_t VGetSize() { return m_Size; }
 	Effect* GetEffect() const { return m_pEffect; }
 
 private:
 	ID3DX11Effect* m_pD3DX11Effect;
 	Effect* m_pEffect;
+	uint64_t m_Size;		// shader byte code and constant buffers, filled in by the renderer
 };
 
 class ShaderResourceLoader : public IResourceLoader
@@ -27,6 +29,7 @@ public:
 	virtual bool VDiscardRawBufferAfterLoad() override { return true; }
 	virtual uint32_t VGetLoadedResourceSize(char *rawBuffer, uint32_t rawSize) override { return 0; }
 	virtual bool VLoadResource(char *rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle) override { return true; }
+	virtual std::string VGetCategory() override { return "effect"; }
 };
 
 class FxSourceEffectResourceLoader : public ShaderResourceLoader
@@ -50,7 +53,10 @@ public:
 	virtual bool VDiscardRawBufferAfterLoad() override { return true; }
 	virtual uint32_t VGetLoadedResourceSize(char *rawBuffer, uint32_t rawSize) override { return 0; }
 	virtual bool VLoadResource(char *rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle) override;
+	virtual bool VIsThreadSafe() override { return true; }
 	virtual std::string VGetPattern() { return "*.mat"; }
+	virtual std::string VGetCategory() override { return "material"; }
+	virtual void VGetDependencies(shared_ptr<ResHandle> handle, std::vector<std::string>& dependencies) override;
 
 	static tinyxml2::XMLElement* LoadAndReturnRootXmlElement(const std::string& resourceString);
 };
@@ -0,0 +1,635 @@
+#include "PackFile.h"
+#include "ResCache.h"
+#include "../Utilities/ThreadPool.h"
+#include <zlib.h>
+#include <atomic>
+
+ResourcePackFile::ResourcePackFile(const std::wstring& resFileName)
+	: m_ResFileName(resFileName),
+	m_ReaderType(FileReader_Mapped),
+	m_pMappedData(nullptr),
+	m_FileSize(0),
+	m_pDecodeThreads(nullptr)
+{
+	memset(&m_Header, 0, sizeof(m_Header));
+}
+
+ResourcePackFile::~ResourcePackFile()
+{
+	Close();
+}
+
+bool ResourcePackFile::VOpen()
+{
+	Close();
+
+	m_pReader = CreateFileReader(m_ReaderType);
+	if (!m_pReader->VOpen(m_ResFileName) || m_pReader->VGetSize() < sizeof(PackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	// Without a mapping every entry is still a single positional read
+	m_FileSize = m_pReader->VGetSize();
+	m_pMappedData = m_pReader->VGetMappedData();
+
+	if (!ReadAt(0, &m_Header, sizeof(m_Header)) ||
+		m_Header.m_Signature != PackHeader::SIGNATURE ||
+		m_Header.m_Version < PackHeader::OLDEST_VERSION || m_Header.m_Version > PackHeader::VERSION)
+	{
+		DEBUG_ERROR("Not an asset pack: " + Utility::WS2S(m_ResFileName));
+		Close();
+		return false;
+	}
+
+	uint64_t tocSize = (uint64_t)m_Header.m_EntryCount * sizeof(PackTocEntry);
+	if (m_Header.m_TocOffset > m_FileSize || tocSize > m_FileSize - m_Header.m_TocOffset ||
+		m_Header.m_NamesOffset > m_FileSize || m_Header.m_NamesSize > m_FileSize - m_Header.m_NamesOffset)
+	{
+		DEBUG_ERROR("Corrupt asset pack table of contents: " + Utility::WS2S(m_ResFileName));
+		Close();
+		return false;
+	}
+
+	m_Toc.resize(m_Header.m_EntryCount);
+	m_Names.resize((size_t)m_Header.m_NamesSize);
+	if ((m_Header.m_EntryCount > 0 && !ReadAt(m_Header.m_TocOffset, &m_Toc[0], (size_t)tocSize)) ||
+		(m_Header.m_NamesSize > 0 && !ReadAt(m_Header.m_NamesOffset, &m_Names[0], (size_t)m_Header.m_NamesSize)))
+	{
+		Close();
+		return false;
+	}
+
+	m_Lookup.reserve(m_Toc.size());
+	for (uint32_t i = 0; i < m_Toc.size(); ++i)
+	{
+		const PackTocEntry& entry = m_Toc[i];
+		if (entry.m_NameOffset + entry.m_NameLength > m_Names.size() ||
+			entry.m_Offset > m_FileSize || entry.m_PackedSize > m_FileSize - entry.m_Offset ||
+			(entry.m_Codec == PackCodec_Stored && entry.m_PackedSize != entry.m_Size) ||
+			entry.m_Codec > PackCodec_DeflateBlocks)
+		{
+			DEBUG_ERROR("Corrupt asset pack entry: " + Utility::WS2S(m_ResFileName));
+			Close();
+			return false;
+		}
+		m_Lookup[entry.m_Hash] = i;
+	}
+
+	return true;
+}
+
+void ResourcePackFile::Close()
+{
+	m_Lookup.clear();
+	m_Toc.clear();
+	m_Names.clear();
+
+	m_pMappedData = nullptr;
+	m_pReader.reset();
+	m_FileSize = 0;
+}
+
+const PackTocEntry* ResourcePackFile::Find(const ResourceId& id) const
+{
+	const std::string& normalized = id.GetName();
+	std::unordered_map<uint64_t, uint32_t>::const_iterator it = m_Lookup.find(id.GetHash());
+	if (it == m_Lookup.end())
+		return nullptr;
+
+	// The packer refuses colliding names, this only guards against names that are not in the pack
+	const PackTocEntry& entry = m_Toc[it->second];
+	if (entry.m_NameLength != normalized.length() ||
+		memcmp(&m_Names[(size_t)entry.m_NameOffset], normalized.c_str(), entry.m_NameLength) != 0)
+		return nullptr;
+
+	return &entry;
+}
+
+bool ResourcePackFile::ReadAt(uint64_t offset, void* pBuffer, size_t size) const
+{
+	if (offset > m_FileSize || size > m_FileSize - offset)
+		return false;
+
+	if (m_pMappedData != nullptr)
+	{
+		memcpy(pBuffer, m_pMappedData + offset, size);
+		return true;
+	}
+
+	return m_pReader->VRead(offset, pBuffer, size);
+}
+
+bool ResourcePackFile::Inflate(const char* pSource, uint64_t sourceSize, char* pDest, uint64_t destSize)
+{
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return false;
+
+	// zlib counts in 32 bits, feed large entries through in pieces
+	int err = Z_OK;
+	while (err == Z_OK)
+	{
+		if (stream.avail_in == 0 && sourceSize > 0)
+		{
+			stream.next_in = (Bytef*)pSource;
+			stream.avail_in = (uInt)std::min<uint64_t>(sourceSize, UINT_MAX);
+			pSource += stream.avail_in;
+			sourceSize -= stream.avail_in;
+		}
+		if (stream.avail_out == 0 && destSize > 0)
+		{
+			stream.next_out = (Bytef*)pDest;
+			stream.avail_out = (uInt)std::min<uint64_t>(destSize, UINT_MAX);
+			pDest += stream.avail_out;
+			destSize -= stream.avail_out;
+		}
+		err = inflate(&stream, Z_NO_FLUSH);
+	}
+	inflateEnd(&stream);
+
+	return err == Z_STREAM_END && stream.avail_out == 0 && destSize == 0;
+}
+
+bool ResourcePackFile::ReadBlockIndex(const PackTocEntry& entry, const char* pPayload, BlockIndex& index) const
+{
+	PackBlockIndex header;
+	if (entry.m_PackedSize < sizeof(header))
+		return false;
+
+	if (pPayload != nullptr)
+	{
+		memcpy(&header, pPayload, sizeof(header));
+	}
+	else if (!ReadAt(entry.m_Offset, &header, sizeof(header)))
+		return false;
+
+	uint64_t blockCount = (header.m_BlockSize == 0) ? 0 : (entry.m_Size + header.m_BlockSize - 1) / header.m_BlockSize;
+	uint64_t indexSize = sizeof(header) + (blockCount + 1) * sizeof(uint64_t);
+	if (blockCount == 0 || header.m_BlockCount != blockCount || indexSize > entry.m_PackedSize)
+		return false;
+
+	index.m_BlockSize = header.m_BlockSize;
+	index.m_Offsets.resize(header.m_BlockCount + 1);
+	size_t offsetsSize = index.m_Offsets.size() * sizeof(uint64_t);
+	if (pPayload != nullptr)
+	{
+		memcpy(index.m_Offsets.data(), pPayload + sizeof(header), offsetsSize);
+	}
+	else if (!ReadAt(entry.m_Offset + sizeof(header), index.m_Offsets.data(), offsetsSize))
+		return false;
+
+	// A block never packs to more than its size, bad offsets would send the inflate outside the payload
+	if (index.m_Offsets.front() != indexSize || index.m_Offsets.back() != entry.m_PackedSize)
+		return false;
+
+	for (uint32_t i = 0; i < header.m_BlockCount; ++i)
+	{
+		uint64_t blockSize = std::min<uint64_t>(header.m_BlockSize, entry.m_Size - (uint64_t)i * header.m_BlockSize);
+		if (index.m_Offsets[i + 1] < index.m_Offsets[i] || index.m_Offsets[i + 1] - index.m_Offsets[i] > blockSize)
+			return false;
+	}
+	return true;
+}
+
+bool ResourcePackFile::ReadBlocks(const PackTocEntry& entry, uint64_t begin, uint64_t size, char* pDest) const
+{
+	BlockIndex index;
+	const char* pPayload = (m_pMappedData != nullptr) ? (m_pMappedData + entry.m_Offset) : nullptr;
+	if (!ReadBlockIndex(entry, pPayload, index))
+	{
+		DEBUG_ERROR("Corrupt block index in asset pack: " + Utility::WS2S(m_ResFileName));
+		return false;
+	}
+
+	if (pPayload != nullptr)
+		return DecodeBlocks(entry, index, pPayload, 0, begin, size, pDest);
+
+	// Just the blocks the range touches, in one read
+	uint64_t first = begin / index.m_BlockSize;
+	uint64_t last = (begin + size - 1) / index.m_BlockSize;
+	uint64_t packedOffset = index.m_Offsets[(size_t)first];
+	std::vector<char> packed((size_t)(index.m_Offsets[(size_t)last + 1] - packedOffset));
+	return ReadAt(entry.m_Offset + packedOffset, packed.data(), packed.size()) &&
+		DecodeBlocks(entry, index, packed.data(), packedOffset, begin, size, pDest);
+}
+
+bool ResourcePackFile::DecodeBlocks(const PackTocEntry& entry, const BlockIndex& index, const char* pPacked, uint64_t packedOffset,
+	uint64_t begin, uint64_t size, char* pDest) const
+{
+	uint32_t first = (uint32_t)(begin / index.m_BlockSize);
+	uint32_t last = (uint32_t)((begin + size - 1) / index.m_BlockSize);
+	std::atomic<bool> failed(false);
+	auto decodeBlock = [&](uint32_t n)
+	{
+		uint32_t i = first + n;
+		uint64_t blockBegin = (uint64_t)i * index.m_BlockSize;
+		uint64_t blockSize = std::min<uint64_t>(index.m_BlockSize, entry.m_Size - blockBegin);
+		const char* pSource = pPacked + (index.m_Offsets[i] - packedOffset);
+		uint64_t sourceSize = index.m_Offsets[i + 1] - index.m_Offsets[i];
+
+		// Blocks cut by the range decode aside, only the part inside it is copied
+		uint64_t from = std::max(begin, blockBegin);
+		uint64_t to = std::min(begin + size, blockBegin + blockSize);
+		std::vector<char> partial;
+		char* pBlock = nullptr;
+		if (from != blockBegin || to != blockBegin + blockSize)
+		{
+			partial.resize((size_t)blockSize);
+			pBlock = partial.data();
+		}
+		else
+		{
+			pBlock = pDest + (blockBegin - begin);
+		}
+
+		bool success = true;
+		if (sourceSize == blockSize)
+		{
+			memcpy(pBlock, pSource, (size_t)blockSize);
+		}
+		else
+		{
+			success = Inflate(pSource, sourceSize, pBlock, blockSize);
+		}
+
+		if (!success)
+		{
+			failed = true;
+		}
+		else if (!partial.empty())
+		{
+			memcpy(pDest + (from - begin), partial.data() + (from - blockBegin), (size_t)(to - from));
+		}
+	};
+
+	uint32_t count = last - first + 1;
+	if (m_pDecodeThreads != nullptr && count > 1)
+	{
+		m_pDecodeThreads->ParallelFor(count, decodeBlock);
+	}
+	else
+	{
+		for (uint32_t n = 0; n < count; ++n)
+		{
+			decodeBlock(n);
+		}
+	}
+	return !failed;
+}
+
+int64_t ResourcePackFile::VGetRawResourceSize(const Resource &r)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	return (pEntry != nullptr) ? (int64_t)pEntry->m_Size : -1;
+}
+
+int64_t ResourcePackFile::VGetRawResource(const Resource &r, char *buffer)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	if (pEntry == nullptr || pEntry->m_PackedSize > SIZE_MAX)
+		return 0;
+
+	if (pEntry->m_Codec == PackCodec_Stored)
+	{
+		return ReadAt(pEntry->m_Offset, buffer, (size_t)pEntry->m_PackedSize) ? (int64_t)pEntry->m_Size : 0;
+	}
+
+	if (pEntry->m_Codec == PackCodec_DeflateBlocks)
+	{
+		return ReadBlocks(*pEntry, 0, pEntry->m_Size, buffer) ? (int64_t)pEntry->m_Size : 0;
+	}
+
+	bool success = false;
+	if (m_pMappedData != nullptr)
+	{
+		success = Inflate(m_pMappedData + pEntry->m_Offset, pEntry->m_PackedSize, buffer, pEntry->m_Size);
+	}
+	else
+	{
+		std::vector<char> packed((size_t)pEntry->m_PackedSize);
+		success = ReadAt(pEntry->m_Offset, packed.data(), packed.size()) &&
+			Inflate(packed.data(), packed.size(), buffer, pEntry->m_Size);
+	}
+
+	return success ? (int64_t)pEntry->m_Size : 0;
+}
+
+int64_t ResourcePackFile::VGetRawResourceOffset(const Resource &r)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	return (pEntry != nullptr) ? (int64_t)pEntry->m_Offset : -1;
+}
+
+bool ResourcePackFile::VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	if (pEntry == nullptr)
+		return false;
+
+	offset = pEntry->m_Offset;
+	size = pEntry->m_PackedSize;
+	return true;
+}
+
+bool ResourcePackFile::VReadStored(uint64_t offset, char *buffer, size_t size)
+{
+	return ReadAt(offset, buffer, size);
+}
+
+bool ResourcePackFile::VReadStoredBatch(std::vector<FileReadRequest> &requests)
+{
+	if (m_pMappedData == nullptr)
+		return m_pReader->VReadBatch(requests);
+
+	bool success = true;
+	for (auto& request : requests)
+	{
+		request.m_IsDone = ReadAt(request.m_Offset, request.m_pBuffer, request.m_Size);
+		success = success && request.m_IsDone;
+	}
+	return success;
+}
+
+int64_t ResourcePackFile::VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	if (pEntry == nullptr || storedSize != pEntry->m_PackedSize)
+		return 0;
+
+	if (pEntry->m_Codec == PackCodec_Stored)
+	{
+		memcpy(buffer, pStored, (size_t)storedSize);
+		return (int64_t)pEntry->m_Size;
+	}
+
+	if (pEntry->m_Codec == PackCodec_DeflateBlocks)
+	{
+		BlockIndex index;
+		return (ReadBlockIndex(*pEntry, pStored, index) && DecodeBlocks(*pEntry, index, pStored, 0, 0, pEntry->m_Size, buffer)) ?
+			(int64_t)pEntry->m_Size : 0;
+	}
+
+	return Inflate(pStored, storedSize, buffer, pEntry->m_Size) ? (int64_t)pEntry->m_Size : 0;
+}
+
+int64_t ResourcePackFile::VGetRawResourceRange(const Resource &r, uint64_t offset, uint64_t size, char *buffer)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	if (pEntry == nullptr || size == 0 || offset > pEntry->m_Size || size > pEntry->m_Size - offset || size > SIZE_MAX)
+		return 0;
+
+	// A single deflate stream can only be decoded from its start
+	bool success = false;
+	if (pEntry->m_Codec == PackCodec_Stored)
+	{
+		success = ReadAt(pEntry->m_Offset + offset, buffer, (size_t)size);
+	}
+	else if (pEntry->m_Codec == PackCodec_DeflateBlocks)
+	{
+		success = ReadBlocks(*pEntry, offset, size, buffer);
+	}
+	return success ? (int64_t)size : 0;
+}
+
+const char* ResourcePackFile::VGetRawResourceView(const Resource &r)
+{
+	const PackTocEntry* pEntry = Find(r.m_Id);
+	if (pEntry == nullptr || pEntry->m_Codec != PackCodec_Stored || m_pMappedData == nullptr)
+		return nullptr;
+
+	return m_pMappedData + pEntry->m_Offset;
+}
+
+int ResourcePackFile::VGetNumResources() const
+{
+	return (int)m_Toc.size();
+}
+
+std::string ResourcePackFile::VGetResourceName(int num) const
+{
+	std::string resName = "";
+	if (num >= 0 && num < (int)m_Toc.size())
+	{
+		const PackTocEntry& entry = m_Toc[num];
+		resName.assign(&m_Names[(size_t)entry.m_NameOffset], entry.m_NameLength);
+	}
+	return resName;
+}
+
+PackFileWriter::PackFileWriter(uint32_t pageSize, uint32_t blockSize)
+	: m_PageSize(pageSize),
+	m_BlockSize(blockSize)
+{
+	DEBUG_ASSERT(pageSize > 0 && (pageSize & (pageSize - 1)) == 0);
+}
+
+void PackFileWriter::AddFile(const std::string& name, const std::wstring& sourceFile, PackCodec codec)
+{
+	Source source;
+	source.m_Name = ResourceId::Normalize(name);
+	source.m_Hash = ResourceId::Hash(source.m_Name);
+	source.m_SourceFile = sourceFile;
+	source.m_Codec = codec;
+	m_Sources.push_back(source);
+}
+
+bool PackFileWriter::ReadSourceFile(const std::wstring& sourceFile, std::vector<char>& data)
+{
+	FILE* pFile = nullptr;
+	_wfopen_s(&pFile, sourceFile.c_str(), L"rb");
+	if (pFile == nullptr)
+		return false;
+
+	_fseeki64(pFile, 0, SEEK_END);
+	int64_t size = _ftelli64(pFile);
+	_fseeki64(pFile, 0, SEEK_SET);
+
+	data.resize((size_t)size);
+	bool success = (size == 0) || (fread(data.data(), 1, data.size(), pFile) == data.size());
+	fclose(pFile);
+	return success;
+}
+
+bool PackFileWriter::Deflate(const char* pData, size_t size, std::vector<char>& packed)
+{
+	if (size > UINT_MAX)
+		return false;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return false;
+
+	// Anything that does not end up smaller is stored instead, so the output never needs to grow
+	packed.resize(size);
+	stream.next_in = (Bytef*)pData;
+	stream.avail_in = (uInt)size;
+	stream.next_out = (Bytef*)packed.data();
+	stream.avail_out = (uInt)packed.size();
+
+	int err = deflate(&stream, Z_FINISH);
+	packed.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	return err == Z_STREAM_END;
+}
+
+bool PackFileWriter::DeflateBlocks(const std::vector<char>& data, std::vector<char>& packed) const
+{
+	uint64_t blockCount = (data.size() + m_BlockSize - 1) / m_BlockSize;
+	if (blockCount > UINT_MAX)
+		return false;
+
+	PackBlockIndex header;
+	header.m_BlockSize = m_BlockSize;
+	header.m_BlockCount = (uint32_t)blockCount;
+	std::vector<uint64_t> offsets;
+	offsets.reserve((size_t)blockCount + 1);
+
+	packed.resize(sizeof(header) + ((size_t)blockCount + 1) * sizeof(uint64_t));
+	std::vector<char> block;
+	for (size_t begin = 0; begin < data.size(); begin += m_BlockSize)
+	{
+		const char* pBlock = data.data() + begin;
+		size_t blockSize = std::min<size_t>(m_BlockSize, data.size() - begin);
+		offsets.push_back(packed.size());
+		if (Deflate(pBlock, blockSize, block) && block.size() < blockSize)
+		{
+			packed.insert(packed.end(), block.begin(), block.end());
+		}
+		else
+		{
+			packed.insert(packed.end(), pBlock, pBlock + blockSize);
+		}
+	}
+	offsets.push_back(packed.size());
+
+	memcpy(packed.data(), &header, sizeof(header));
+	memcpy(packed.data() + sizeof(header), offsets.data(), offsets.size() * sizeof(uint64_t));
+	return packed.size() < data.size();
+}
+
+bool PackFileWriter::Write(const std::wstring& packFileName)
+{
+	m_LastError.clear();
+	for (const Source& source : m_Sources)
+	{
+		// The table of contents stores name lengths in 16 bits
+		if (source.m_Name.length() > UINT16_MAX)
+		{
+			m_LastError = "Name too long for an asset pack: " + source.m_Name.substr(0, 64) + "...";
+			return false;
+		}
+	}
+
+	// Sorted by hash, neighbouring hashes must differ or lookups would be ambiguous
+	std::sort(m_Sources.begin(), m_Sources.end(),
+		[](const Source& a, const Source& b) { return a.m_Hash < b.m_Hash; });
+	for (size_t i = 1; i < m_Sources.size(); ++i)
+	{
+		if (m_Sources[i].m_Hash == m_Sources[i - 1].m_Hash)
+		{
+			m_LastError = "Name hash collision between " + m_Sources[i - 1].m_Name + " and " + m_Sources[i].m_Name;
+			return false;
+		}
+	}
+
+	PackHeader header;
+	memset(&header, 0, sizeof(header));
+	header.m_Signature = PackHeader::SIGNATURE;
+	header.m_Version = PackHeader::VERSION;
+	header.m_EntryCount = (uint32_t)m_Sources.size();
+	header.m_PageSize = m_PageSize;
+	header.m_TocOffset = sizeof(PackHeader);
+	header.m_NamesOffset = header.m_TocOffset + m_Sources.size() * sizeof(PackTocEntry);
+
+	std::vector<PackTocEntry> toc(m_Sources.size());
+	std::string names;
+	for (size_t i = 0; i < m_Sources.size(); ++i)
+	{
+		memset(&toc[i], 0, sizeof(PackTocEntry));
+		toc[i].m_Hash = m_Sources[i].m_Hash;
+		toc[i].m_NameOffset = names.length();
+		toc[i].m_NameLength = (uint16_t)m_Sources[i].m_Name.length();
+		names += m_Sources[i].m_Name;
+	}
+	header.m_NamesSize = names.length();
+
+	FILE* pFile = nullptr;
+	_wfopen_s(&pFile, packFileName.c_str(), L"wb");
+	if (pFile == nullptr)
+	{
+		m_LastError = "Could not create " + Utility::WS2S(packFileName);
+		return false;
+	}
+
+	// Payloads go first behind the space reserved for the tables, the tables are written last
+	uint64_t offset = header.m_NamesOffset + header.m_NamesSize;
+	std::vector<char> data, packed;
+	bool success = true;
+	for (size_t i = 0; i < m_Sources.size() && success; ++i)
+	{
+		const Source& source = m_Sources[i];
+		if (!ReadSourceFile(source.m_SourceFile, data))
+		{
+			m_LastError = "Could not read " + Utility::WS2S(source.m_SourceFile);
+			success = false;
+			break;
+		}
+
+		const std::vector<char>* pPayload = &data;
+		toc[i].m_Codec = PackCodec_Stored;
+		if (source.m_Codec == PackCodec_Deflate && m_BlockSize > 0 && data.size() > m_BlockSize)
+		{
+			if (DeflateBlocks(data, packed))
+			{
+				pPayload = &packed;
+				toc[i].m_Codec = PackCodec_DeflateBlocks;
+			}
+		}
+		else if (source.m_Codec == PackCodec_Deflate && !data.empty() && Deflate(data.data(), data.size(), packed) && packed.size() < data.size())
+		{
+			pPayload = &packed;
+			toc[i].m_Codec = PackCodec_Deflate;
+		}
+
+		// Empty entries take no page, so the pack never ends in padding
+		if (!pPayload->empty())
+		{
+			offset = (offset + m_PageSize - 1) & ~(uint64_t)(m_PageSize - 1);
+		}
+		toc[i].m_Offset = offset;
+		toc[i].m_PackedSize = pPayload->size();
+		toc[i].m_Size = data.size();
+
+		success = _fseeki64(pFile, offset, SEEK_SET) == 0 &&
+			(pPayload->empty() || fwrite(pPayload->data(), 1, pPayload->size(), pFile) == pPayload->size());
+		if (!success)
+		{
+			m_LastError = "Could not write " + source.m_Name + " to " + Utility::WS2S(packFileName);
+		}
+		offset += pPayload->size();
+	}
+
+	if (success)
+	{
+		success = _fseeki64(pFile, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, pFile) == 1 &&
+			(toc.empty() || fwrite(toc.data(), sizeof(PackTocEntry), toc.size(), pFile) == toc.size()) &&
+			(names.empty() || fwrite(names.c_str(), 1, names.length(), pFile) == names.length());
+		if (!success)
+		{
+			m_LastError = "Could not write " + Utility::WS2S(packFileName);
+		}
+	}
+
+	// Buffered writes may only fail here, on a full disk for one
+	if (fclose(pFile) != 0 && success)
+	{
+		m_LastError = "Could not write " + Utility::WS2S(packFileName);
+		success = false;
+	}
+	return success;
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "../TinyEngineInterface.h"
+#include "ResourceId.h"
+#include "FileReader.h"
+
+// Engine native asset pack, written by the AssetPacker tool.
+//
+//   PackHeader
+//   PackTocEntry[m_EntryCount]		sorted by m_Hash
+//   name table						normalized names, not terminated
+//   payloads						each one starts on a m_PageSize boundary
+//
+// Names are stored normalized and keyed by their ResourceId hash, so a lookup is one table
+// probe and reading an entry is a single read.
+//
+// Large entries are deflated in fixed size blocks, each one on its own, behind a block index.
+// Their blocks inflate in parallel and a range from the middle only decodes the blocks it covers.
+
+enum PackCodec
+{
+	PackCodec_Stored,
+	PackCodec_Deflate,		// raw deflate stream, no zlib header
+	PackCodec_DeflateBlocks,	// PackBlockIndex, then raw deflate blocks
+};
+
+#pragma pack(push, 1)
+struct PackHeader
+{
+	enum
+	{
+		SIGNATURE = 0x4b415054,		// "TPAK"
+		VERSION = 2,
+		OLDEST_VERSION = 1,			// before block compressed entries
+		DEFAULT_PAGE_SIZE = 4096,
+		DEFAULT_BLOCK_SIZE = 1024 * 1024,
+	};
+
+	uint32_t m_Signature;
+	uint32_t m_Version;
+	uint32_t m_EntryCount;
+	uint32_t m_PageSize;
+	uint64_t m_TocOffset;
+	uint64_t m_NamesOffset;
+	uint64_t m_NamesSize;
+};
+
+struct PackTocEntry
+{
+	uint64_t m_Hash;
+	uint64_t m_Offset;			// payload position in the pack
+	uint64_t m_PackedSize;		// bytes stored in the pack
+	uint64_t m_Size;			// bytes after decoding
+	uint64_t m_NameOffset;		// into the name table
+	uint16_t m_NameLength;
+	uint8_t m_Codec;			// PackCodec
+	uint8_t m_Reserved[5];
+};
+
+// Starts a PackCodec_DeflateBlocks payload, followed by m_BlockCount + 1 uint64_t offsets of the
+// blocks from the start of the payload, the last one being the payload size. Every block but the
+// last decodes to m_BlockSize bytes. A block that did not get smaller is stored, its packed
+// size is then its size.
+struct PackBlockIndex
+{
+	uint32_t m_BlockSize;
+	uint32_t m_BlockCount;
+};
+#pragma pack(pop)
+
+class ResourcePackFile : public IResourceFile
+{
+public:
+	ResourcePackFile(const std::wstring& resFileName);
+	virtual ~ResourcePackFile();
+
+	virtual bool VOpen() override;
+	virtual void VRemoveRawResource(const Resource &r) override {}
+	virtual int64_t VGetRawResourceSize(const Resource &r) override;
+	virtual int64_t VGetRawResource(const Resource &r, char *buffer) override;
+	virtual int64_t VGetRawResourceOffset(const Resource &r) override;
+	virtual bool VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size) override;
+	virtual bool VReadStored(uint64_t offset, char *buffer, size_t size) override;
+	virtual bool VReadStoredBatch(std::vector<FileReadRequest> &requests) override;
+	virtual int64_t VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer) override;
+	virtual int64_t VGetRawResourceRange(const Resource &r, uint64_t offset, uint64_t size, char *buffer) override;
+	virtual void VSetDecodeThreads(ThreadPool* pThreads) override { m_pDecodeThreads = pThreads; }
+	virtual void VSetFileReader(FileReaderType type) override { m_ReaderType = type; }
+	virtual const char* VGetRawResourceView(const Resource &r) override;
+	virtual int VGetNumResources() const override;
+	virtual std::string VGetResourceName(int num) const override;
+	virtual bool VIsUsingDevelopmentDirectories(void) const override { return false; }
+
+private:
+	struct BlockIndex
+	{
+		uint32_t m_BlockSize;
+		std::vector<uint64_t> m_Offsets;		// m_BlockCount + 1 of them
+	};
+
+	const PackTocEntry* Find(const ResourceId& id) const;
+	bool ReadAt(uint64_t offset, void* pBuffer, size_t size) const;
+	static bool Inflate(const char* pSource, uint64_t sourceSize, char* pDest, uint64_t destSize);
+	// From pPayload when the payload is at hand, otherwise read from the pack
+	bool ReadBlockIndex(const PackTocEntry& entry, const char* pPayload, BlockIndex& index) const;
+	// Reads the blocks covering [begin, begin + size) of a block compressed entry
+	bool ReadBlocks(const PackTocEntry& entry, uint64_t begin, uint64_t size, char* pDest) const;
+	// pPacked holds the payload from packedOffset on, at least the blocks covering the range
+	bool DecodeBlocks(const PackTocEntry& entry, const BlockIndex& index, const char* pPacked, uint64_t packedOffset,
+		uint64_t begin, uint64_t size, char* pDest) const;
+	void Close();
+
+	std::wstring m_ResFileName;
+	FileReaderType m_ReaderType;
+	unique_ptr<IFileReader> m_pReader;
+	const char* m_pMappedData;		// the whole pack when it is mapped
+	uint64_t m_FileSize;
+	ThreadPool* m_pDecodeThreads;
+
+	PackHeader m_Header;
+	std::vector<PackTocEntry> m_Toc;
+	std::vector<char> m_Names;
+	std::unordered_map<uint64_t, uint32_t> m_Lookup;	// name hash to toc index
+};
+
+// Collects the files of an asset directory and writes them out as a pack
+class PackFileWriter
+{
+public:
+	// Deflated entries larger than blockSize are split into blocks, 0 keeps every entry whole
+	PackFileWriter(uint32_t pageSize = PackHeader::DEFAULT_PAGE_SIZE, uint32_t blockSize = PackHeader::DEFAULT_BLOCK_SIZE);
+
+	// Deflated entries fall back to stored when compression does not pay off
+	void AddFile(const std::string& name, const std::wstring& sourceFile, PackCodec codec);
+	bool Write(const std::wstring& packFileName);
+
+	const std::string& GetLastError() const { return m_LastError; }
+
+private:
+	struct Source
+	{
+		std::string m_Name;
+		uint64_t m_Hash;
+		std::wstring m_SourceFile;
+		PackCodec m_Codec;
+	};
+
+	static bool ReadSourceFile(const std::wstring& sourceFile, std::vector<char>& data);
+	static bool Deflate(const char* pData, size_t size, std::vector<char>& packed);
+	bool DeflateBlocks(const std::vector<char>& data, std::vector<char>& packed) const;
+
+	uint32_t m_PageSize;
+	uint32_t m_BlockSize;
+	std::vector<Source> m_Sources;
+	std::string m_LastError;
+};
@@ -1,16 +1,28 @@
 #include "ResCache.h"
-#include "boost/optional.hpp"
+#include "PackFile.h"
+#include "../Utilities/ThreadPool.h"
+#include "boost/filesystem/fstream.hpp"
 #include <cctype>
 
-Resource::Resource(const std::string &name)
+namespace
 {
-	m_name = name;
-	std::transform(m_name.begin(), m_name.end(), m_name.begin(), (int(*)(int)) std::tolower);
+	// Skipping over this much between two entries is cheaper than another read
+	const uint64_t BATCH_MAX_GAP = 256 * 1024;
+	// Bigger runs, or single entries past it, are not worth holding in memory twice
+	const uint64_t BATCH_MAX_READ = 8 * 1024 * 1024;
+	// At least this many, so a deep I/O queue has something to work on
+	const uint32_t LOADS_IN_FLIGHT = 32;
+
+	double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
 }
 
-ResourceZipFile::ResourceZipFile()
+ResourceZipFile::ResourceZipFile(const std::wstring& resFileName)
 	: m_pZipFile(nullptr),
-	m_ResFileName(L"Assets.zip")
+	m_ResFileName(resFileName),
+	m_ReaderType(FileReader_Mapped)
 {
 
 }
@@ -25,32 +37,76 @@ bool ResourceZipFile::VOpen()
 	m_pZipFile = unique_ptr<ZipFile>(DEBUG_NEW ZipFile);
 	if (m_pZipFile != nullptr)
 	{
-		return m_pZipFile->Init(m_ResFileName.c_str());
+		return m_pZipFile->Init(m_ResFileName.c_str(), m_ReaderType);
 	}
 	return false;
 }
 
-int ResourceZipFile::VGetRawResourceSize(const Resource &r)
+int64_t ResourceZipFile::VGetRawResourceSize(const Resource &r)
 {
-	int resourceNum = m_pZipFile->Find(r.m_name.c_str());
+	int resourceNum = m_pZipFile->Find(r.m_Id);
 	if (resourceNum == -1)
 		return -1;
 
 	return m_pZipFile->GetFileLen(resourceNum);
 }
 
-int ResourceZipFile::VGetRawResource(const Resource &r, char *buffer)
+int64_t ResourceZipFile::VGetRawResource(const Resource &r, char *buffer)
+{
+	int64_t size = 0;
+	int resourceNum = m_pZipFile->Find(r.m_Id);
+	if (resourceNum != -1 && m_pZipFile->ReadFile(resourceNum, buffer))
+	{
+		size = m_pZipFile->GetFileLen(resourceNum);
+	}
+	return size;
+}
+
+int64_t ResourceZipFile::VGetRawResourceOffset(const Resource &r)
+{
+	int resourceNum = m_pZipFile->Find(r.m_Id);
+	if (resourceNum == -1)
+		return -1;
+
+	return (int64_t)m_pZipFile->GetFileOffset(resourceNum);
+}
+
+bool ResourceZipFile::VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size)
+{
+	int resourceNum = m_pZipFile->Find(r.m_Id);
+	return resourceNum != -1 && m_pZipFile->GetFileExtent(resourceNum, offset, size);
+}
+
+bool ResourceZipFile::VReadStored(uint64_t offset, char *buffer, size_t size)
+{
+	return m_pZipFile->ReadRaw(offset, buffer, size);
+}
+
+bool ResourceZipFile::VReadStoredBatch(std::vector<FileReadRequest> &requests)
 {
-	int size = 0;
-	boost::optional<int> resourceNum = m_pZipFile->Find(r.m_name.c_str());
-	if (resourceNum.is_initialized())
+	return m_pZipFile->ReadRawBatch(requests);
+}
+
+int64_t ResourceZipFile::VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer)
+{
+	int64_t size = 0;
+	int resourceNum = m_pZipFile->Find(r.m_Id);
+	if (resourceNum != -1 && m_pZipFile->DecodeFile(resourceNum, pStored, storedSize, buffer))
 	{
-		size = m_pZipFile->GetFileLen(resourceNum.get());
-		m_pZipFile->ReadFile(resourceNum.get(), buffer);
+		size = m_pZipFile->GetFileLen(resourceNum);
 	}
 	return size;
 }
 
+const char* ResourceZipFile::VGetRawResourceView(const Resource &r)
+{
+	int resourceNum = m_pZipFile->Find(r.m_Id);
+	if (resourceNum == -1)
+		return nullptr;
+
+	return m_pZipFile->GetFileView(resourceNum);
+}
+
 int ResourceZipFile::VGetNumResources() const
 {
 	return (m_pZipFile == nullptr) ? 0 : m_pZipFile->GetNumFiles();
@@ -69,28 +125,21 @@ std::string ResourceZipFile::VGetResourceName(int num) const
 DevelopmentResourceZipFile::DevelopmentResourceZipFile(const std::string assetDir, const Mode mode)
 	: ResourceZipFile(),
 	m_Mode(mode),
-	m_AssetsDir(assetDir)
+	m_AssetsDir(assetDir),
+	m_AssetIndex(assetDir)
 {
 
 }
 
 int DevelopmentResourceZipFile::Find(const std::string &name)
 {
-// 	std::string lowerCase = name;
-// 	std::transform(lowerCase.begin(), lowerCase.end(), lowerCase.begin(), (int(*)(int)) std::tolower);
-	ZipContentsMap::const_iterator i = m_DirectoryContentsMap.find(name);
-	if (i == m_DirectoryContentsMap.end())
-	{
-		// In editor mode, allowed to add new resource file
-		if (AddNewResFile(name))
-		{
-			return m_AssetFileInfo.size() - 1;
-		}
-		else
-			return -1;
-	}
+	return Find(ResourceId(name));
+}
 
-	return i->second;
+int DevelopmentResourceZipFile::Find(const ResourceId &id)
+{
+	boost::mutex::scoped_lock lock(m_AssetsMutex);
+	return FindAsset(id);
 }
 
 bool DevelopmentResourceZipFile::VOpen()
@@ -103,179 +152,238 @@ bool DevelopmentResourceZipFile::VOpen()
 	// open the asset directory and read in the non-hidden contents
 	if (m_Mode == Editor)
 	{
-		ReadAssetsDirectory(L"*");
+		boost::mutex::scoped_lock lock(m_AssetsMutex);
+		m_AssetIndex.Scan();
 	}
 	else
 	{
-		// FUTURE WORK - iterate through the ZipFile contents and go grab WIN32_FIND_DATA 
-		//   elements for each one. Then it would be possible to compare the dates/times of the
-		//   asset in the Zip file with the source asset.
+		// FUTURE WORK - iterate through the ZipFile contents and compare the dates/times
+		//   of the asset in the Zip file with the source asset in the index.
 		DEBUG_ASSERT(0 && "Not implemented yet");
 	}
 
 	return true;
 }
 
-
-void DevelopmentResourceZipFile::VRemoveRawResource(const Resource &r)
+bool DevelopmentResourceZipFile::VRefresh()
 {
-	ZipContentsMap::const_iterator i = m_DirectoryContentsMap.find(r.m_name);
-	if (i != m_DirectoryContentsMap.end())
-	{
-		m_AssetFileInfo.erase(m_AssetFileInfo.begin() + i->second - 1);
-	}
-	m_DirectoryContentsMap.erase(r.m_name);
+	if (m_Mode != Editor)
+		return false;
+
+	boost::mutex::scoped_lock lock(m_AssetsMutex);
+	return m_AssetIndex.Rescan() > 0;
 }
 
-bool DevelopmentResourceZipFile::AddNewResFile(const std::string& filePath)
+void DevelopmentResourceZipFile::VRemoveRawResource(const Resource &r)
 {
-	bool success = false;
-	HANDLE fileHandle;
-	WIN32_FIND_DATA findData;
-
-	std::wstring pathSpec = Utility::S2WS(m_AssetsDir + filePath);
-	fileHandle = FindFirstFile(pathSpec.c_str(), &findData);
-	if (fileHandle != INVALID_HANDLE_VALUE)
-	{
-		std::string lower = filePath;
-		std::transform(lower.begin(), lower.end(), lower.begin(), (int(*)(int)) std::tolower);
-		wcscpy_s(&findData.cFileName[0], MAX_PATH, Utility::S2WS(lower).c_str());
-		m_DirectoryContentsMap[lower] = m_AssetFileInfo.size();
-		m_AssetFileInfo.push_back(findData);
-		success = true;
-	}
-
-	FindClose(fileHandle);
-
-	return success;
+	boost::mutex::scoped_lock lock(m_AssetsMutex);
+	m_AssetIndex.Remove(r.m_Id);
 }
 
-int DevelopmentResourceZipFile::VGetRawResourceSize(const Resource &r)
+int64_t DevelopmentResourceZipFile::VGetRawResourceSize(const Resource &r)
 {
-	int size = 0;
-
 	if (m_Mode == Editor)
 	{
-		int num = Find(r.m_name.c_str());
+		boost::mutex::scoped_lock lock(m_AssetsMutex);
+		int num = FindAsset(r.m_Id);
 		if (num == -1)
 			return -1;
 
-		return m_AssetFileInfo[num].nFileSizeLow;
+		return m_AssetIndex.GetAsset(num).m_Size;
 	}
 
 	return ResourceZipFile::VGetRawResourceSize(r);
 }
 
-int DevelopmentResourceZipFile::VGetRawResource(const Resource &r, char *buffer)
+int64_t DevelopmentResourceZipFile::VGetRawResource(const Resource &r, char *buffer)
 {
 	if (m_Mode == Editor)
 	{
-		int num = Find(r.m_name.c_str());
-		if (num == -1)
-			return -1;
+		int64_t fileSize = 0;
+		boost::filesystem::path path;
+		{
+			boost::mutex::scoped_lock lock(m_AssetsMutex);
+			int num = FindAsset(r.m_Id);
+			if (num == -1)
+				return -1;
+
+			fileSize = m_AssetIndex.GetAsset(num).m_Size;
+			path = m_AssetIndex.GetAsset(num).m_Path;
+		}
+
+		// Every call opens its own stream, so loose files can be read from several threads
+		boost::filesystem::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file)
+			return 0;
 
-		std::string fullFileSpec = m_AssetsDir + r.m_name.c_str();
-		FILE *f = nullptr;
-		fopen_s(&f, fullFileSpec.c_str(), "rb");
-		size_t bytes = fread(buffer, 1, m_AssetFileInfo[num].nFileSizeLow, f);
-		fclose(f);
-		return bytes;
+		file.read(buffer, (std::streamsize)fileSize);
+		return (int64_t)file.gcount();
 	}
 
 	return ResourceZipFile::VGetRawResource(r, buffer);
 }
 
-int DevelopmentResourceZipFile::VGetNumResources() const
+int64_t DevelopmentResourceZipFile::VGetRawResourceOffset(const Resource &r)
 {
-	return (m_Mode == Editor) ? m_AssetFileInfo.size() : ResourceZipFile::VGetNumResources();
+	return (m_Mode == Editor) ? -1 : ResourceZipFile::VGetRawResourceOffset(r);
 }
 
-std::string DevelopmentResourceZipFile::VGetResourceName(int num) const
+bool DevelopmentResourceZipFile::VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size)
+{
+	return (m_Mode == Editor) ? false : ResourceZipFile::VGetStoredExtent(r, offset, size);
+}
+
+bool DevelopmentResourceZipFile::VReadStored(uint64_t offset, char *buffer, size_t size)
+{
+	return (m_Mode == Editor) ? false : ResourceZipFile::VReadStored(offset, buffer, size);
+}
+
+bool DevelopmentResourceZipFile::VReadStoredBatch(std::vector<FileReadRequest> &requests)
+{
+	return (m_Mode == Editor) ? false : ResourceZipFile::VReadStoredBatch(requests);
+}
+
+int64_t DevelopmentResourceZipFile::VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer)
+{
+	return (m_Mode == Editor) ? 0 : ResourceZipFile::VDecodeStored(r, pStored, storedSize, buffer);
+}
+
+const char* DevelopmentResourceZipFile::VGetRawResourceView(const Resource &r)
+{
+	return (m_Mode == Editor) ? nullptr : ResourceZipFile::VGetRawResourceView(r);
+}
+
+int DevelopmentResourceZipFile::VGetNumResources() const
 {
 	if (m_Mode == Editor)
 	{
-		std::wstring wideName = m_AssetFileInfo[num].cFileName;
-		return Utility::WS2S(wideName);
+		boost::mutex::scoped_lock lock(m_AssetsMutex);
+		return m_AssetIndex.GetAssetCount();
 	}
 
-	return ResourceZipFile::VGetResourceName(num);
+	return ResourceZipFile::VGetNumResources();
 }
 
-
-void DevelopmentResourceZipFile::ReadAssetsDirectory(std::wstring fileSpec)
+std::string DevelopmentResourceZipFile::VGetResourceName(int num) const
 {
-	HANDLE fileHandle;
-	WIN32_FIND_DATA findData;
-
-	std::wstring pathSpec = Utility::S2WS(m_AssetsDir) + fileSpec;
-	fileHandle = FindFirstFile(pathSpec.c_str(), &findData);
-	if (fileHandle != INVALID_HANDLE_VALUE)
+	if (m_Mode == Editor)
 	{
-		while (FindNextFile(fileHandle, &findData))
-		{
-			if (findData.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN)
-				continue;
+		boost::mutex::scoped_lock lock(m_AssetsMutex);
+		if (num < 0 || num >= m_AssetIndex.GetAssetCount())
+			return "";
 
-			std::wstring fileName = findData.cFileName;
-			if (findData.dwFileAttributes &FILE_ATTRIBUTE_DIRECTORY)
-			{
-				if (fileName != L".." && fileName != L".")
-				{
-					fileName = fileSpec.substr(0, fileSpec.length() - 1) + fileName + L"\\*";
-					ReadAssetsDirectory(fileName);
-				}
-			}
-			else
-			{
-				fileName = fileSpec.substr(0, fileSpec.length() - 1) + fileName;
-				std::wstring lower = fileName;
-				std::transform(lower.begin(), lower.end(), lower.begin(), (int(*)(int)) std::tolower);
-				wcscpy_s(&findData.cFileName[0], MAX_PATH, lower.c_str());
-				m_DirectoryContentsMap[Utility::WS2S(lower)] = m_AssetFileInfo.size();
-				m_AssetFileInfo.push_back(findData);
-			}
-		}
+		return m_AssetIndex.GetAsset(num).m_Name;
 	}
 
-	FindClose(fileHandle);
+	return ResourceZipFile::VGetResourceName(num);
 }
 
-ResHandle::ResHandle(Resource& resource, char* buffer, uint32_t size, ResCache* pResCache)
+ResHandle::ResHandle(const Resource& resource, char* buffer, uint64_t size, ResCache* pResCache, shared_ptr<IResourceAllocator> pAllocator)
 	: m_Resource(resource),
 	m_pBuffer(buffer),
 	m_Size(size),
+	m_IsBufferOwned(true),
 	m_pExtraData(nullptr),
-	m_pResCache(pResCache)
+	m_ExtraSize(0),
+	m_PinCount(0),
+	m_Category(0),
+	m_pLoader(nullptr),
+	m_pResCache(pResCache),
+	m_pAllocator(pAllocator)
 {
 
 }
 
 ResHandle::~ResHandle()
 {
-	SAFE_DELETE_ARRAY(m_pBuffer);
-	m_pResCache->MemoryHasBeenFreed(m_Size);
+	// Views into the resource file are not ours to free and were never charged to the cache
+	if (m_IsBufferOwned)
+	{
+		m_pAllocator->VFree(m_pBuffer);
+	}
+	m_pBuffer = nullptr;
+
+	if (m_pResCache != nullptr)
+	{
+		m_pResCache->MemoryHasBeenFreed(GetMemorySize(), m_Category);
+	}
+}
+
+void ResHandle::Pin()
+{
+	if (++m_PinCount == 1 && m_pResCache != nullptr)
+	{
+		m_pResCache->PinChanged(this);
+	}
+}
+
+void ResHandle::Unpin()
+{
+	DEBUG_ASSERT(m_PinCount > 0);
+	if (--m_PinCount == 0 && m_pResCache != nullptr)
+	{
+		m_pResCache->PinChanged(this);
+	}
 }
 
-ResCache::ResCache(const uint32_t sizeInMb, const std::string& assetDir, bool isZipResource)
-	: m_CacheSize(sizeInMb * 1024 * 1024),
-	m_Allocated(0)
+ResCache::ResCache(const uint32_t sizeInMb, const std::string& assetDir, bool isZipResource, const std::string& resourceFile)
+	: m_pEvictionPolicy(DEBUG_NEW LruEvictionPolicy()),
+	m_LoaderCount(0),
+	m_pAllocator(DEBUG_NEW SlabResourceAllocator()),
+	m_pCompressedCache(DEBUG_NEW CompressedResourceCache()),
+	m_CacheSize((uint64_t)sizeInMb * 1024 * 1024),
+	m_Allocated(0),
+	m_IsBorrowing(false),
+	m_IsTrimming(false),
+	m_LastLoadStatus(ResLoad_Ok),
+	m_IsRecording(false)
 {
-	if (isZipResource)
+	Category shared;
+	shared.m_Budget = m_CacheSize;
+	shared.m_Allocated = 0;
+	m_Categories.push_back(shared);
+
+	std::string extension = resourceFile.substr(std::min(resourceFile.rfind('.'), resourceFile.length()));
+	std::transform(extension.begin(), extension.end(), extension.begin(), (int(*)(int)) std::tolower);
+
+	if (isZipResource && extension == ".pak")
 	{
-		m_pResFile = unique_ptr<IResourceFile>(DEBUG_NEW ResourceZipFile());
+		m_pResFile = unique_ptr<IResourceFile>(DEBUG_NEW ResourcePackFile(Utility::S2WS(resourceFile)));
+	}
+	else if (isZipResource)
+	{
+		m_pResFile = unique_ptr<IResourceFile>(DEBUG_NEW ResourceZipFile(Utility::S2WS(resourceFile)));
 	}
 	else
 	{
 		m_pResFile = unique_ptr<IResourceFile>(DEBUG_NEW DevelopmentResourceZipFile(assetDir + "\\", DevelopmentResourceZipFile::Editor));
+		m_AssetDir = assetDir;
 	}
 }
 
 ResCache::~ResCache()
 {
-	while (!m_ResList.empty())
+	// Workers still reference the cache, let them finish before tearing anything down
+	m_pLoadThreads.reset();
+	m_pResFile->VSetDecodeThreads(nullptr);
+
+	shared_ptr<AsyncLoad> load;
+	while (m_CompletedLoads.try_pop(load))
+	{
+	}
+	m_PendingLoads.clear();
+
+	// Handles still held elsewhere outlive the cache, they must not report back to it. That is
+	// the resident ones and the ones that left the map while held.
+	Flush();
+	for (const auto& detached : m_DetachedHandles)
 	{
-		FreeOneResource();
+		if (shared_ptr<ResHandle> handle = detached.lock())
+		{
+			handle->m_pResCache = nullptr;
+		}
 	}
+	m_DetachedHandles.clear();
 }
 
 bool ResCache::Init()
@@ -283,6 +391,8 @@ bool ResCache::Init()
 	bool retValue = false;
 	if (m_pResFile->VOpen())
 	{
+		m_pLoadThreads = unique_ptr<ThreadPool>(DEBUG_NEW ThreadPool());
+		m_pResFile->VSetDecodeThreads(m_pLoadThreads.get());
 		RegisterLoader(shared_ptr<IResourceLoader>(DEBUG_NEW DefaultResourceLoader()));
 		retValue = true;
 	}
@@ -291,196 +401,1066 @@ bool ResCache::Init()
 
 void ResCache::RegisterLoader(shared_ptr<IResourceLoader> loader)
 {
-	m_ResourceLoaders.push_front(loader);
+	// Resource names are normalized, match patterns the same way
+	LoaderEntry entry;
+	entry.m_Pattern = ResourceId::Normalize(loader->VGetPattern());
+	entry.m_pLoader = loader;
+	entry.m_Order = m_LoaderCount++;
+
+	LoaderCategory& category = m_LoaderCategories[loader.get()];
+	category.m_pLoader = loader;
+	category.m_Name = loader->VGetCategory();
+	category.m_Index = FindCategory(category.m_Name);
+
+	if (entry.m_Pattern == "*")
+	{
+		m_pDefaultLoader = loader;
+	}
+	else if (entry.m_Pattern.compare(0, 2, "*.") == 0 && entry.m_Pattern.find_first_of("*?.\\", 2) == std::string::npos)
+	{
+		entry.m_Pattern.erase(0, 2);
+		m_LoadersByExtension[ResourceId::Hash(entry.m_Pattern)] = entry;
+	}
+	else
+	{
+		m_PatternLoaders.push_front(entry);
+	}
 }
 
 shared_ptr<ResHandle> ResCache::GetHandle(Resource* r)
 {
-	shared_ptr<ResHandle> handle(Find(r));
-	if (handle == nullptr)
+	ResHandleMap::iterator i = m_ResMap.find(r->m_Id);
+	Record(r->m_Id, i != m_ResMap.end());
+	if (i == m_ResMap.end())
 	{
-		handle = Load(r);
-		DEBUG_ASSERT(handle);
+		m_Stats.m_Misses++;
+		shared_ptr<ResHandle> handle = Load(r);
+		if (handle == nullptr && m_LastLoadStatus == ResLoad_BudgetExhausted)
+		{
+			// Not a bug, everything resident is in use. The caller gets to decide what to do without it.
+			DEBUG_WARNING("Resource cache budget exhausted, can't load " + r->GetName());
+		}
+		else
+		{
+			DEBUG_ASSERT(handle);
+		}
+		return handle;
 	}
-	else
+
+	m_Stats.m_Hits++;
+	Update(i->second.get());
+	return i->second;
+}
+
+shared_ptr<ResHandle> ResCache::GetHandle(const ResourceId& id)
+{
+	ResHandleMap::iterator i = m_ResMap.find(id);
+	if (i == m_ResMap.end())
 	{
-		Update(handle);
+		Resource r(id);
+		return GetHandle(&r);
 	}
-	return handle;
+
+	Record(id, true);
+	m_Stats.m_Hits++;
+	Update(i->second.get());
+	return i->second;
 }
 
 void ResCache::RemoveHandle(Resource* r)
 {
-	shared_ptr<ResHandle> handle(Find(r));
-	if (handle != nullptr)
+	ResHandleMap::iterator i = m_ResMap.find(r->m_Id);
+	if (i != m_ResMap.end())
 	{
-		m_ResList.remove(handle);
-		m_ResMap.erase(handle->m_Resource.m_name);
-		m_pResFile->VRemoveRawResource(*r);
+		m_pEvictionPolicy->VOnRemove(i->second.get(), false);
+		Detach(i);
 	}
+
+	// Resident or not, the second tier and the file forget what they knew, a missing name included
+	m_pCompressedCache->Remove(r->m_Id);
+	m_pResFile->VRemoveRawResource(*r);
 }
 
 shared_ptr<ResHandle> ResCache::Load(Resource* r)
 {
-	shared_ptr<IResourceLoader> loader;
+	m_LastLoadStatus = ResLoad_Failed;
+	shared_ptr<IResourceLoader> loader = FindLoader(*r);
+	if (!loader)
+	{
+		DEBUG_ASSERT(loader && _T("Default resource loader not found!"));
+		return shared_ptr<ResHandle>();		// Resource not loaded!
+	}
+
+	// MakeRoom switches the status to ResLoad_BudgetExhausted when nothing can be evicted
+	unique_ptr<ResourceLoadRecord> pProfile = StartProfile(*r, loader.get());
 	shared_ptr<ResHandle> handle;
+	RawResource raw;
+	if (ReadRawResource(*r, loader, false, raw, pProfile.get()))
+	{
+		handle = DecodeResource(*r, loader, raw, false, pProfile.get());
+	}
 
-	for (ResourceLoaders::iterator it = m_ResourceLoaders.begin(); it != m_ResourceLoaders.end(); ++it)
+	if (handle)
 	{
-		shared_ptr<IResourceLoader> testLoader = *it;
+		Insert(handle);
+		m_LastLoadStatus = ResLoad_Ok;
+	}
+
+	FinishProfile(pProfile.get(), handle);
+	return handle;
+}
 
-		if (Utility::WildcardMatch(testLoader->VGetPattern().c_str(), r->m_name.c_str()))
+const char* ResCache::GetExtension(const std::string& name)
+{
+	size_t dot = name.rfind('.');
+	if (dot == std::string::npos || name.find('\\', dot) != std::string::npos)
+		return nullptr;
+
+	return name.c_str() + dot + 1;
+}
+
+shared_ptr<IResourceLoader> ResCache::FindLoader(const Resource& r)
+{
+	const std::string& name = r.GetName();
+	const LoaderEntry* pExtensionLoader = nullptr;
+	const char* extension = GetExtension(name);
+	if (extension != nullptr)
+	{
+		LoaderMap::const_iterator it = m_LoadersByExtension.find(ResourceId::Hash(extension));
+		if (it != m_LoadersByExtension.end() && it->second.m_Pattern == extension)
 		{
-			loader = testLoader;
-			break;
+			pExtensionLoader = &it->second;
 		}
 	}
 
-	if (!loader)
+	// Only patterns registered after the extension loader can override it
+	for (LoaderList::const_iterator it = m_PatternLoaders.begin(); it != m_PatternLoaders.end(); ++it)
 	{
-		DEBUG_ASSERT(loader && _T("Default resource loader not found!"));
-		return handle;		// Resource not loaded!
+		if (pExtensionLoader != nullptr && it->m_Order < pExtensionLoader->m_Order)
+			break;
+
+		if (Utility::WildcardMatch(it->m_Pattern.c_str(), name.c_str()))
+			return it->m_pLoader;
 	}
 
-	int rawSize = m_pResFile->VGetRawResourceSize(*r);
+	if (pExtensionLoader != nullptr)
+		return pExtensionLoader->m_pLoader;
+
+	return m_pDefaultLoader;
+}
+
+bool ResCache::ReadRawResource(const Resource& r, shared_ptr<IResourceLoader> loader, bool isDetached, RawResource& raw, ResourceLoadRecord* pProfile)
+{
+	// Detached buffers are not charged to the cache until the handle is adopted on the main thread.
+	// Resource files are reentrant, workers read in parallel without a lock.
+	int64_t rawSize = m_pResFile->VGetRawResourceSize(r);
 	if (rawSize < 0)
 	{
-		DEBUG_ASSERT(rawSize > 0 && "Resource size returned -1 - Resource not found");
-		return shared_ptr<ResHandle>();
+		// Runs on workers too, the caller gets a null handle rather than an assert dialog
+		DEBUG_WARNING("Resource not found: " + r.GetName());
+		return false;
 	}
 
-	int allocSize = rawSize + ((loader->VAddNullZero()) ? (1) : (0));
-	char *rawBuffer = loader->VUseRawFile() ? Allocate(allocSize) : DEBUG_NEW char[allocSize];
-	memset(rawBuffer, 0, allocSize);
+	if (pProfile != nullptr)
+	{
+		pProfile->m_RawBytes = rawSize;
+	}
 
-	if (rawBuffer == nullptr || m_pResFile->VGetRawResource(*r, rawBuffer) == 0)
+	// Stored data can be used in place unless the loader wants a terminating zero
+	if (!loader->VAddNullZero())
 	{
-		// resource cache out of memory
-		return shared_ptr<ResHandle>();
+		const char* pView = m_pResFile->VGetRawResourceView(r);
+		if (pView != nullptr)
+		{
+			raw.m_pBuffer = const_cast<char*>(pView);
+			raw.m_Size = rawSize;
+			raw.m_IsView = true;
+			return true;
+		}
 	}
 
-	char *buffer = nullptr;
-	uint32_t size = 0;
+	// Evicted not long ago, the second tier has the bytes without going to the file. Take turns
+	// down entries from before a Reload or RemoveHandle, the size is only a last sanity check.
+	shared_ptr<const CompressedResourceCache::Entry> pCompressed = m_pCompressedCache->Take(r.m_Id);
+	if (pCompressed != nullptr && pCompressed->m_RawSize != (uint64_t)rawSize)
+	{
+		pCompressed.reset();
+	}
 
-	if (loader->VUseRawFile())
+	uint64_t allocSize = rawSize + ((loader->VAddNullZero()) ? (1) : (0));
+	if (allocSize > SIZE_MAX)
 	{
-		buffer = rawBuffer;
-		handle = shared_ptr<ResHandle>(DEBUG_NEW ResHandle(*r, buffer, rawSize, this));
+		DEBUG_ERROR("Resource is too large for this address space: " + r.GetName());
+		return false;
 	}
-	else
+
+	// Only raw handles are charged here, decoded resources charge their own buffer
+	bool isCharged = loader->VUseRawFile() && !isDetached;
+	uint32_t category = isCharged ? GetCategory(loader.get()) : 0;
+	char *rawBuffer = isCharged ? Allocate(allocSize, category) : m_pAllocator->VAllocate((size_t)allocSize);
+	if (rawBuffer == nullptr)
+	{
+		// resource cache out of memory
+		return false;
+	}
+
+	// The read fills the whole buffer, only the terminator needs writing
+	int64_t bytesRead = 0;
+	if (pCompressed != nullptr)
 	{
-		size = loader->VGetLoadedResourceSize(rawBuffer, rawSize);
-		buffer = Allocate(size);
-		if (rawBuffer == nullptr || buffer == nullptr)
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bytesRead = CompressedResourceCache::Inflate(*pCompressed, rawBuffer) ? rawSize : 0;
+		if (pProfile != nullptr)
 		{
-			// resource cache out of memory
-			return shared_ptr<ResHandle>();
+			pProfile->m_InflateSeconds += SecondsSince(start);
 		}
-		handle = shared_ptr<ResHandle>(DEBUG_NEW ResHandle(*r, buffer, size, this));
-		bool success = loader->VLoadResource(rawBuffer, rawSize, handle);
-
-		if (loader->VDiscardRawBufferAfterLoad())
+	}
+	else if (pProfile != nullptr)
+	{
+		bytesRead = ReadProfiled(r, rawSize, rawBuffer, *pProfile);
+	}
+	else
+	{
+		bytesRead = m_pResFile->VGetRawResource(r, rawBuffer);
+	}
+	if (bytesRead <= 0 || bytesRead < rawSize)
+	{
+		if (isCharged)
 		{
-			SAFE_DELETE_ARRAY(rawBuffer);
+			Release(rawBuffer, allocSize, category);
 		}
-
-		if (!success)
+		else
 		{
-			return shared_ptr<ResHandle>();
+			m_pAllocator->VFree(rawBuffer);
 		}
+		return false;
 	}
 
-	if (handle)
+	if (loader->VAddNullZero())
 	{
-		m_ResList.push_front(handle);
-		m_ResMap[r->m_name] = handle;
+		rawBuffer[rawSize] = 0;
 	}
 
-	DEBUG_ASSERT(loader && _T("Default resource loader not found!"));
-	return handle;		// ResCache is out of memory!
+	raw.m_pAllocator = m_pAllocator;
+	raw.m_pBuffer = rawBuffer;
+	raw.m_Size = rawSize;
+	raw.m_IsView = false;
+	return true;
 }
 
-shared_ptr<ResHandle> ResCache::Find(Resource * r)
+int64_t ResCache::ReadProfiled(const Resource& r, int64_t rawSize, char* rawBuffer, ResourceLoadRecord& profile)
 {
-	ResHandleMap::iterator i = m_ResMap.find(r->m_name);
-	if (i == m_ResMap.end())
-		return shared_ptr<ResHandle>();
+	// Compressed entries are read first and inflated after, as in a batch, so both can be timed
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t offset = 0;
+	uint64_t storedSize = 0;
+	if (m_pResFile->VGetStoredExtent(r, offset, storedSize) && storedSize != (uint64_t)rawSize && storedSize <= SIZE_MAX)
+	{
+		unique_ptr<char[]> pStored(DEBUG_NEW char[(size_t)storedSize]);
+		if (m_pResFile->VReadStored(offset, pStored.get(), (size_t)storedSize))
+		{
+			profile.m_StoredBytes += storedSize;
+			profile.m_ReadSeconds += SecondsSince(start);
 
-	return i->second;
-}
+			start = std::chrono::steady_clock::now();
+			int64_t bytesRead = m_pResFile->VDecodeStored(r, pStored.get(), storedSize, rawBuffer);
+			profile.m_InflateSeconds += SecondsSince(start);
+			return bytesRead;
+		}
+	}
 
-void ResCache::Update(shared_ptr<ResHandle> handle)
-{
-	// Move most recently used resource to the front, let least used resource clear first
-	m_ResList.remove(handle);
-	m_ResList.push_front(handle);
+	// Stored as is, or the file can't read it apart
+	int64_t bytesRead = m_pResFile->VGetRawResource(r, rawBuffer);
+	profile.m_StoredBytes += std::max<int64_t>(bytesRead, 0);
+	profile.m_ReadSeconds += SecondsSince(start);
+	return bytesRead;
 }
 
-char *ResCache::Allocate(uint32_t size)
+shared_ptr<ResHandle> ResCache::DecodeResource(
+	const Resource& r, shared_ptr<IResourceLoader> loader, RawResource& raw, bool isDetached, ResourceLoadRecord* pProfile)
 {
-	if (!MakeRoom(size))
-		return nullptr;
+	// Takes ownership of the raw buffer, it either ends up in the handle or is released here
+	ResCache* pOwner = isDetached ? nullptr : this;
+	uint32_t category = isDetached ? 0 : GetCategory(loader.get());
+	char* rawBuffer = raw.m_pBuffer;
+	uint64_t rawSize = raw.m_Size;
+	bool isView = raw.m_IsView;
+	shared_ptr<IResourceAllocator> pRawAllocator = raw.m_pAllocator;
+	raw.m_pBuffer = nullptr;
 
-	char *mem = DEBUG_NEW char[size];
-	if (mem)
+	if (loader->VUseRawFile())
 	{
-		m_Allocated += size;
+		shared_ptr<ResHandle> handle(DEBUG_NEW ResHandle(r, rawBuffer, rawSize, pOwner, pRawAllocator));
+		handle->m_IsBufferOwned = !isView;
+		handle->m_pLoader = loader.get();
+		handle->m_Category = category;
+		return handle;
 	}
 
-	return mem;
-}
-
-void ResCache::FreeOneResource()
-{
-	ResHandleList::iterator gonner = m_ResList.end();
-	gonner--;
+	// Loaders still take 32 bit sizes, only raw resources may be larger
+	if (rawSize > UINT32_MAX)
+	{
+		DEBUG_ERROR("Resource is too large for its loader: " + r.GetName());
+		if (!isView)
+		{
+			pRawAllocator->VFree(rawBuffer);
+		}
+		return shared_ptr<ResHandle>();
+	}
 
-	shared_ptr<ResHandle> handle = *gonner;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint32_t size = loader->VGetLoadedResourceSize(rawBuffer, (uint32_t)rawSize);
+	char *buffer = isDetached ? m_pAllocator->VAllocate(size) : Allocate(size, category);
+	if (buffer == nullptr)
+	{
+		// resource cache out of memory
+		if (!isView)
+		{
+			pRawAllocator->VFree(rawBuffer);
+		}
+		return shared_ptr<ResHandle>();
+	}
 
-	m_ResList.pop_back();
-	m_ResMap.erase(handle->m_Resource.m_name);
-}
+	shared_ptr<ResHandle> handle(DEBUG_NEW ResHandle(r, buffer, size, pOwner, m_pAllocator));
+	handle->m_pLoader = loader.get();
+	handle->m_Category = category;
 
-void ResCache::Flush()
-{
-	while (!m_ResList.empty())
+	// Whatever the loader asks the cache for is asked for by this resource
+	bool isCallSite = (pProfile != nullptr && !isDetached);
+	if (isCallSite)
 	{
-		shared_ptr<ResHandle> handle = *(m_ResList.begin());
-		Free(handle);
-		m_ResList.pop_front();
+		PushCallSite(r.GetName());
+	}
+	bool success = loader->VLoadResource(rawBuffer, (uint32_t)rawSize, handle);
+	if (isCallSite)
+	{
+		PopCallSite();
+	}
+	if (pProfile != nullptr)
+	{
+		pProfile->m_DecodeSeconds += SecondsSince(start);
 	}
-}
 
-bool ResCache::MakeRoom(uint32_t size)
-{
-	if (size > m_CacheSize)
+	if (loader->VDiscardRawBufferAfterLoad() && !isView)
 	{
-		return false;
+		pRawAllocator->VFree(rawBuffer);
 	}
 
-	while (size > (m_CacheSize - m_Allocated))
+	if (!success)
 	{
-		if (m_ResList.empty())
-			return false;
+		return shared_ptr<ResHandle>();
+	}
 
-		FreeOneResource();
+	if (!isDetached)
+	{
+		ChargeExtraData(handle);
 	}
 
-	return true;
+	return handle;
 }
 
-void ResCache::Free(shared_ptr<ResHandle> gonner)
+void ResCache::ChargeExtraData(shared_ptr<ResHandle> handle)
 {
-	m_ResList.remove(gonner);
-	m_ResMap.erase(gonner->m_Resource.m_name);
+	if (handle->m_pExtraData == nullptr)
+		return;
+
+	// The decoded data exists already, it stays charged even when nothing can be evicted for it
+	handle->m_ExtraSize = handle->m_pExtraData->VGetSize();
+	if (!MakeRoom(handle->m_ExtraSize, handle->m_Category))
+	{
+		DEBUG_WARNING("Resource cache is over budget after decoding " + handle->GetName());
+	}
+	Charge(handle->m_ExtraSize, handle->m_Category);
 }
 
-void ResCache::MemoryHasBeenFreed(uint32_t size)
+void ResCache::Insert(shared_ptr<ResHandle> handle)
 {
-	m_Allocated -= size;
+	m_ResMap[handle->m_Resource.m_Id] = handle;
+	handle->m_pResident = handle;
+	m_pEvictionPolicy->VOnInsert(handle.get());
+
+	if (handle->m_pLoader != nullptr)
+	{
+		std::vector<std::string> dependencies;
+		handle->m_pLoader->VGetDependencies(handle, dependencies);
+		for (const auto& dependency : dependencies)
+		{
+			m_Dependencies.AddDependency(handle->GetId(), ResourceId(dependency));
+		}
+	}
 }
 
-std::vector<std::string> ResCache::Match(const std::string pattern)
+int64_t ResCache::ReadRawRange(const Resource& r, uint64_t offset, uint64_t size, char* buffer)
+{
+	return m_pResFile->VGetRawResourceRange(r, offset, size, buffer);
+}
+
+void ResCache::GetHandleAsync(Resource* r, const ResLoadCallback& callback)
+{
+	ResHandleMap::iterator i = m_ResMap.find(r->m_Id);
+	Record(r->m_Id, i != m_ResMap.end());
+	if (i != m_ResMap.end())
+	{
+		m_Stats.m_Hits++;
+		Update(i->second.get());
+		if (callback)
+		{
+			callback(i->second);
+		}
+		return;
+	}
+
+	m_Stats.m_Misses++;
+
+	// Somebody already asked for this resource, just wait for the same load
+	AsyncLoadMap::iterator pending = m_PendingLoads.find(r->m_Id);
+	if (pending != m_PendingLoads.end())
+	{
+		if (callback)
+		{
+			pending->second->m_Callbacks.push_back(callback);
+		}
+		return;
+	}
+
+	shared_ptr<IResourceLoader> loader = FindLoader(*r);
+	if (!loader || m_pLoadThreads == nullptr)
+	{
+		DEBUG_ASSERT(loader && _T("Default resource loader not found!"));
+		if (callback)
+		{
+			callback(shared_ptr<ResHandle>());
+		}
+		return;
+	}
+
+	shared_ptr<AsyncLoad> load(DEBUG_NEW AsyncLoad(*r, loader));
+	load->m_pProfile = StartProfile(*r, loader.get());
+	if (callback)
+	{
+		load->m_Callbacks.push_back(callback);
+	}
+	m_PendingLoads[r->m_Id] = load;
+	m_pLoadThreads->Submit(boost::bind(&ResCache::LoadAsync, this, load));
+}
+
+void ResCache::LoadAsync(shared_ptr<AsyncLoad> load)
+{
+	// Runs on a worker thread, only touches the resource file and the load itself
+	if (ReadRawResource(load->m_Resource, load->m_pLoader, true, load->m_Raw, load->m_pProfile.get()))
+	{
+		DecodeAsync(load);
+	}
+
+	m_CompletedLoads.push(load);
+}
+
+void ResCache::ReadBatches(std::vector<shared_ptr<BatchRead> > batches)
+{
+	// One read for each run, then each resource in it is decoded on a worker of its own
+	std::vector<FileReadRequest> requests(batches.size());
+	for (size_t i = 0; i < batches.size(); ++i)
+	{
+		BatchRead* pBatch = batches[i].get();
+		pBatch->m_pData.reset(DEBUG_NEW char[(size_t)pBatch->m_Size]);
+		requests[i].m_Offset = pBatch->m_Offset;
+		requests[i].m_pBuffer = pBatch->m_pData.get();
+		requests[i].m_Size = (size_t)pBatch->m_Size;
+		requests[i].m_IsDone = false;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_pResFile->VReadStoredBatch(requests);
+	double readSeconds = SecondsSince(start);
+
+	uint64_t totalSize = 0;
+	for (const auto& batch : batches)
+	{
+		totalSize += batch->m_Size;
+	}
+
+	for (size_t i = 0; i < batches.size(); ++i)
+	{
+		shared_ptr<BatchRead> batch = batches[i];
+		if (!requests[i].m_IsDone)
+		{
+			batch->m_pData.reset();
+		}
+		else
+		{
+			// The reads were in flight together, each load is charged its share by size
+			for (auto& load : batch->m_Loads)
+			{
+				if (load->m_pProfile != nullptr)
+				{
+					load->m_pProfile->m_StoredBytes += load->m_StoredSize;
+					load->m_pProfile->m_ReadSeconds += readSeconds * load->m_StoredSize / std::max<uint64_t>(totalSize, 1);
+				}
+			}
+		}
+
+		for (auto& load : batch->m_Loads)
+		{
+			if (batch->m_pData != nullptr)
+			{
+				m_pLoadThreads->Submit(boost::bind(&ResCache::DecodeStored, this, batch, load));
+			}
+			else
+			{
+				m_pLoadThreads->Submit(boost::bind(&ResCache::LoadAsync, this, load));
+			}
+		}
+	}
+}
+
+void ResCache::DecodeStored(shared_ptr<BatchRead> batch, shared_ptr<AsyncLoad> load)
+{
+	// Runs on a worker thread, the batch stays alive until its last resource is decoded
+	const Resource& r = load->m_Resource;
+	int64_t rawSize = m_pResFile->VGetRawResourceSize(r);
+	bool addNullZero = load->m_pLoader->VAddNullZero();
+	uint64_t allocSize = rawSize + ((addNullZero) ? (1) : (0));
+	char* rawBuffer = (rawSize < 0 || allocSize > SIZE_MAX) ? nullptr : m_pAllocator->VAllocate((size_t)allocSize);
+	if (rawBuffer != nullptr)
+	{
+		const char* pStored = batch->m_pData.get() + (load->m_StoredOffset - batch->m_Offset);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		int64_t bytesDecoded = m_pResFile->VDecodeStored(r, pStored, load->m_StoredSize, rawBuffer);
+		if (load->m_pProfile != nullptr)
+		{
+			load->m_pProfile->m_RawBytes = rawSize;
+			load->m_pProfile->m_InflateSeconds += SecondsSince(start);
+		}
+
+		if (bytesDecoded == rawSize)
+		{
+			if (addNullZero)
+			{
+				rawBuffer[rawSize] = 0;
+			}
+
+			load->m_Raw.m_pAllocator = m_pAllocator;
+			load->m_Raw.m_pBuffer = rawBuffer;
+			load->m_Raw.m_Size = rawSize;
+			load->m_Raw.m_IsView = false;
+			DecodeAsync(load);
+		}
+		else
+		{
+			// The batch was read but this entry did not inflate, it is read again on its own
+			// before the load fails, as when the batch read itself fails
+			m_pAllocator->VFree(rawBuffer);
+			m_pLoadThreads->Submit(boost::bind(&ResCache::LoadAsync, this, load));
+			return;
+		}
+	}
+
+	m_CompletedLoads.push(load);
+}
+
+void ResCache::DecodeAsync(shared_ptr<AsyncLoad> load)
+{
+	// Loaders that are not thread safe decode on the main thread when the load is finished
+	if (load->m_pLoader->VUseRawFile() || load->m_pLoader->VIsThreadSafe())
+	{
+		load->m_pHandle = DecodeResource(load->m_Resource, load->m_pLoader, load->m_Raw, true, load->m_pProfile.get());
+	}
+}
+
+void ResCache::OnUpdate()
+{
+	shared_ptr<AsyncLoad> load;
+	while (m_CompletedLoads.try_pop(load))
+	{
+		FinishAsyncLoad(load);
+	}
+
+	if (m_pFileWatcher != nullptr)
+	{
+		CheckForChangedFiles();
+	}
+}
+
+void ResCache::FinishAsyncLoad(shared_ptr<AsyncLoad> load)
+{
+	// A synchronous GetHandle may have loaded the same resource in the meantime
+	shared_ptr<ResHandle> handle = Find(&load->m_Resource);
+	if (handle == nullptr && load->m_IsStale)
+	{
+		// What the worker read may be from before the change, read it again
+		handle = Load(&load->m_Resource);
+	}
+	else if (handle == nullptr)
+	{
+		m_LastLoadStatus = ResLoad_Failed;
+		if (load->m_pHandle != nullptr)
+		{
+			handle = Adopt(load->m_pHandle);
+			load->m_pHandle.reset();
+		}
+		else if (load->m_Raw.m_pBuffer != nullptr)
+		{
+			handle = DecodeResource(load->m_Resource, load->m_pLoader, load->m_Raw, false, load->m_pProfile.get());
+		}
+
+		if (handle)
+		{
+			Insert(handle);
+			m_LastLoadStatus = ResLoad_Ok;
+		}
+		FinishProfile(load->m_pProfile.get(), handle);
+	}
+
+	m_PendingLoads.erase(load->m_Resource.m_Id);
+
+	for (auto& callback : load->m_Callbacks)
+	{
+		callback(handle);
+	}
+}
+
+shared_ptr<ResHandle> ResCache::Adopt(shared_ptr<ResHandle> handle)
+{
+	// Charge a handle built on a worker thread to the cache budget
+	handle->m_Category = GetCategory(handle->m_pLoader);
+	if (handle->m_IsBufferOwned)
+	{
+		if (!MakeRoom(handle->m_Size, handle->m_Category))
+			return shared_ptr<ResHandle>();
+
+		Charge(handle->m_Size, handle->m_Category);
+	}
+
+	handle->m_pResCache = this;
+	ChargeExtraData(handle);
+	return handle;
+}
+
+shared_ptr<ResHandle> ResCache::Find(Resource * r)
+{
+	ResHandleMap::iterator i = m_ResMap.find(r->m_Id);
+	if (i == m_ResMap.end())
+		return shared_ptr<ResHandle>();
+
+	return i->second;
+}
+
+void ResCache::Update(ResHandle* pHandle)
+{
+	m_pEvictionPolicy->VOnAccess(pHandle);
+}
+
+char *ResCache::Allocate(uint64_t size, uint32_t category)
+{
+	if (size > SIZE_MAX || !MakeRoom(size, category))
+		return nullptr;
+
+	char *mem = m_pAllocator->VAllocate((size_t)size);
+	if (mem)
+	{
+		Charge(size, category);
+	}
+
+	return mem;
+}
+
+void ResCache::Release(char* buffer, uint64_t size, uint32_t category)
+{
+	m_pAllocator->VFree(buffer);
+	MemoryHasBeenFreed(size, category);
+}
+
+bool ResCache::FreeOneResource()
+{
+	IResourceEvictionPolicy::CategoryList categories(m_Categories.size());
+	for (uint32_t i = 0; i < categories.size(); ++i)
+	{
+		categories[i] = i;
+	}
+	return EvictOne(categories);
+}
+
+bool ResCache::FreeOneResource(uint32_t category)
+{
+	return EvictOne(IResourceEvictionPolicy::CategoryList(1, category));
+}
+
+bool ResCache::FreeOneBorrowedResource()
+{
+	IResourceEvictionPolicy::CategoryList categories;
+	for (uint32_t i = 0; i < m_Categories.size(); ++i)
+	{
+		if (m_Categories[i].m_Allocated > m_Categories[i].m_Budget)
+		{
+			categories.push_back(i);
+		}
+	}
+	return !categories.empty() && EvictOne(categories);
+}
+
+bool ResCache::EvictOne(const IResourceEvictionPolicy::CategoryList& categories)
+{
+	ResHandle* pVictim = m_pEvictionPolicy->VSelectVictim(categories, &ResCache::CanEvict);
+	if (pVictim == nullptr)
+		return false;
+
+	m_Stats.m_Evictions++;
+	m_Stats.m_BytesEvicted += pVictim->GetMemorySize();
+	KeepEvictedBuffer(pVictim);
+	m_pEvictionPolicy->VOnRemove(pVictim, true);
+	Detach(m_ResMap.find(pVictim->m_Resource.m_Id));
+	return true;
+}
+
+bool ResCache::CanEvict(ResHandle* pHandle)
+{
+	// Dropping a handle somebody still holds gives no memory back and only makes it load twice.
+	// The policies keep pinned handles out of their victim lists already.
+	return !pHandle->IsPinned() && pHandle->m_pResident.use_count() == 1;
+}
+
+void ResCache::KeepEvictedBuffer(ResHandle* pVictim)
+{
+	// Only a buffer that is the raw resource can stand in for reading the file again
+	if (m_IsTrimming || m_pLoadThreads == nullptr || m_pCompressedCache->GetBudget() == 0 ||
+		!pVictim->m_IsBufferOwned || pVictim->m_pLoader == nullptr || !pVictim->m_pLoader->VUseRawFile())
+		return;
+
+	// The buffer moves to a worker that compresses it, it stops counting against the cache now
+	char* pBuffer = pVictim->m_pBuffer;
+	uint64_t size = pVictim->m_Size;
+	shared_ptr<IResourceAllocator> pAllocator = pVictim->m_pAllocator;
+	MemoryHasBeenFreed(size, pVictim->m_Category);
+	pVictim->m_IsBufferOwned = false;
+
+	// A Reload or RemoveHandle before the worker gets to it moves the generation on
+	CompressedResourceCache* pCompressedCache = m_pCompressedCache.get();
+	ResourceId id = pVictim->GetId();
+	uint32_t generation = m_pCompressedCache->BeginInsert(id);
+	m_pLoadThreads->Submit([pCompressedCache, id, generation, pBuffer, size, pAllocator]()
+	{
+		pCompressedCache->Insert(id, generation, pBuffer, size);
+		pAllocator->VFree(pBuffer);
+	});
+}
+
+void ResCache::Reload(const std::vector<ResourceId>& changed)
+{
+	if (changed.empty())
+		return;
+
+	// Worked out before the changed resources forget what they depend on, they record it again when loaded
+	std::vector<ResourceId> affected = m_Dependencies.GetAffected(changed);
+	for (const auto& id : changed)
+	{
+		ResHandleMap::iterator i = m_ResMap.find(id);
+		if (i != m_ResMap.end())
+		{
+			m_pEvictionPolicy->VOnRemove(i->second.get(), false);
+			Detach(i);
+		}
+
+		AsyncLoadMap::iterator pending = m_PendingLoads.find(id);
+		if (pending != m_PendingLoads.end())
+		{
+			pending->second->m_IsStale = true;
+		}
+
+		m_pCompressedCache->Remove(id);
+		m_pResFile->VRemoveRawResource(Resource(id));
+		m_Dependencies.RemoveDependencies(id);
+	}
+
+	if (m_ResourceChangedCallback)
+	{
+		m_ResourceChangedCallback(changed, affected);
+	}
+}
+
+bool ResCache::WatchAssetDirectory()
+{
+	if (m_AssetDir.empty())
+		return false;
+
+	m_pFileWatcher = CreateFileWatcher();
+	if (m_pFileWatcher == nullptr || !m_pFileWatcher->VWatch(m_AssetDir))
+	{
+		DEBUG_WARNING("Can't watch the asset directory for changes: " + m_AssetDir);
+		m_pFileWatcher.reset();
+		return false;
+	}
+	return true;
+}
+
+void ResCache::CheckForChangedFiles()
+{
+	// Editors save in several steps, a file is reloaded once nothing happened to it for a moment
+	const std::chrono::milliseconds settleTime(200);
+
+	std::vector<std::string> names;
+	bool isComplete = m_pFileWatcher->VPoll(names);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!names.empty() || !isComplete)
+	{
+		m_LastFileChange = now;
+	}
+
+	for (const auto& name : names)
+	{
+		m_ChangedFiles.insert(ResourceId(name));
+	}
+
+	// Events were lost, whatever is resident may be out of date
+	if (!isComplete)
+	{
+		for (const auto& resident : m_ResMap)
+		{
+			m_ChangedFiles.insert(resident.first);
+		}
+	}
+
+	if (m_ChangedFiles.empty() || now - m_LastFileChange < settleTime)
+		return;
+
+	// Added and removed files show up in the directory listing
+	m_pResFile->VRefresh();
+
+	std::vector<ResourceId> changed(m_ChangedFiles.begin(), m_ChangedFiles.end());
+	m_ChangedFiles.clear();
+	Reload(changed);
+}
+
+void ResCache::Flush()
+{
+	m_pEvictionPolicy->VClear();
+	while (!m_ResMap.empty())
+	{
+		Detach(m_ResMap.begin());
+	}
+	m_pCompressedCache->Clear();
+}
+
+void ResCache::SetEvictionPolicy(shared_ptr<IResourceEvictionPolicy> policy)
+{
+	DEBUG_ASSERT(policy);
+	m_pEvictionPolicy = policy;
+	m_pEvictionPolicy->VClear();
+	for (auto& resident : m_ResMap)
+	{
+		m_pEvictionPolicy->VOnInsert(resident.second.get());
+	}
+	ResetStats();
+}
+
+bool ResCache::MakeRoom(uint64_t size, uint32_t category)
+{
+	const Category& target = m_Categories[category];
+	if (size > (m_IsBorrowing ? m_CacheSize : target.m_Budget))
+	{
+		m_LastLoadStatus = ResLoad_BudgetExhausted;
+		return false;
+	}
+
+	while (target.m_Allocated + size > target.m_Budget || m_Allocated + size > m_CacheSize)
+	{
+		bool isWithinBudget = (target.m_Allocated + size <= target.m_Budget);
+		if (!isWithinBudget && m_IsBorrowing && m_Allocated + size <= m_CacheSize)
+			break;
+
+		// A category past its budget gives up its own handles first. What is left to free
+		// was borrowed by categories past their budget, possibly this one.
+		if (!isWithinBudget && FreeOneResource(category))
+			continue;
+
+		if ((isWithinBudget || m_IsBorrowing) && FreeOneBorrowedResource())
+			continue;
+
+		m_LastLoadStatus = ResLoad_BudgetExhausted;
+		return false;
+	}
+
+	return true;
+}
+
+void ResCache::Free(shared_ptr<ResHandle> gonner)
+{
+	ResHandleMap::iterator i = m_ResMap.find(gonner->m_Resource.m_Id);
+	if (i != m_ResMap.end())
+	{
+		m_pEvictionPolicy->VOnRemove(i->second.get(), false);
+		Detach(i);
+	}
+	m_pCompressedCache->Remove(gonner->m_Resource.m_Id);
+}
+
+void ResCache::PinChanged(ResHandle* pHandle)
+{
+	if (pHandle->IsPinned())
+	{
+		m_pEvictionPolicy->VOnPin(pHandle);
+	}
+	else
+	{
+		m_pEvictionPolicy->VOnUnpin(pHandle);
+	}
+}
+
+void ResCache::Detach(ResHandleMap::iterator i)
+{
+	if (i->second.use_count() > 1)
+	{
+		// Released handles drop out here, so the list stays about as long as the held ones
+		if (m_DetachedHandles.size() == m_DetachedHandles.capacity())
+		{
+			m_DetachedHandles.erase(std::remove_if(m_DetachedHandles.begin(), m_DetachedHandles.end(),
+				[](const weak_ptr<ResHandle>& detached) { return detached.expired(); }), m_DetachedHandles.end());
+		}
+		m_DetachedHandles.push_back(i->second);
+	}
+	m_ResMap.erase(i);
+}
+
+void ResCache::Charge(uint64_t size, uint32_t category)
+{
+	m_Allocated += size;
+	m_Categories[category].m_Allocated += size;
+}
+
+void ResCache::MemoryHasBeenFreed(uint64_t size, uint32_t category)
+{
+	m_Allocated -= size;
+	m_Categories[category].m_Allocated -= size;
+}
+
+uint32_t ResCache::GetCategory(IResourceLoader* pLoader) const
+{
+	if (pLoader == nullptr)
+		return 0;
+
+	// Registered loaders are resolved already, loads don't build the name or compare it
+	LoaderCategoryMap::const_iterator it = m_LoaderCategories.find(pLoader);
+	return (it != m_LoaderCategories.end()) ? it->second.m_Index : FindCategory(pLoader->VGetCategory());
+}
+
+uint32_t ResCache::FindCategory(const std::string& name) const
+{
+	// Only a handful of categories, a linear search beats hashing the name
+	for (uint32_t i = 1; i < m_Categories.size(); ++i)
+	{
+		if (m_Categories[i].m_Name == name)
+			return i;
+	}
+	return 0;
+}
+
+void ResCache::SetCategoryBudget(const std::string& category, uint64_t bytes)
+{
+	DEBUG_ASSERT(!category.empty());
+
+	// Handles keep their category index, categories are never removed
+	uint32_t index = FindCategory(category);
+	if (index == 0)
+	{
+		Category added;
+		added.m_Name = category;
+		added.m_Allocated = 0;
+		index = (uint32_t)m_Categories.size();
+		m_Categories.push_back(added);
+
+		for (auto& loader : m_LoaderCategories)
+		{
+			if (loader.second.m_Name == category)
+			{
+				loader.second.m_Index = index;
+			}
+		}
+	}
+	m_Categories[index].m_Budget = bytes;
+	UpdateSharedBudget();
+}
+
+void ResCache::SetBudget(uint64_t bytes)
+{
+	m_CacheSize = bytes;
+	UpdateSharedBudget();
+	EvictDownTo(m_CacheSize);
+}
+
+uint64_t ResCache::Trim(double targetFraction)
+{
+	uint64_t before = m_Allocated;
+	m_IsTrimming = true;
+	EvictDownTo((uint64_t)(m_Allocated * std::min(std::max(targetFraction, 0.0), 1.0)));
+	m_IsTrimming = false;
+	m_pCompressedCache->Trim(targetFraction);
+	return before - m_Allocated;
+}
+
+void ResCache::EvictDownTo(uint64_t bytes)
+{
+	// Memory borrowed past category budgets goes first, then whatever the policy picks
+	while (m_Allocated > bytes)
+	{
+		if (!FreeOneBorrowedResource() && !FreeOneResource())
+			break;
+	}
+}
+
+void ResCache::UpdateSharedBudget()
+{
+	uint64_t reserved = 0;
+	for (uint32_t i = 1; i < m_Categories.size(); ++i)
+	{
+		reserved += m_Categories[i].m_Budget;
+	}
+	if (reserved > m_CacheSize)
+	{
+		DEBUG_WARNING("Resource category budgets add up to more than the cache size");
+	}
+	m_Categories[0].m_Budget = (reserved < m_CacheSize) ? m_CacheSize - reserved : 0;
+}
+
+std::vector<ResourceCategoryReport> ResCache::GetCategoryReport() const
+{
+	std::vector<ResourceCategoryReport> reports;
+	for (const auto& category : m_Categories)
+	{
+		ResourceCategoryReport report;
+		report.m_Name = category.m_Name;
+		report.m_Budget = category.m_Budget;
+		report.m_Allocated = category.m_Allocated;
+		reports.push_back(report);
+	}
+	return reports;
+}
+
+std::vector<ResourceMemoryReport> ResCache::GetMemoryReport() const
+{
+	std::vector<ResourceMemoryReport> reports;
+	std::unordered_map<IResourceLoader*, size_t> reportIndices;
+	for (auto& resident : m_ResMap)
+	{
+		const ResHandle& handle = *resident.second;
+		std::unordered_map<IResourceLoader*, size_t>::iterator index = reportIndices.find(handle.m_pLoader);
+		if (index == reportIndices.end())
+		{
+			ResourceMemoryReport report;
+			report.m_Loader = (handle.m_pLoader != nullptr) ? handle.m_pLoader->VGetPattern() : "";
+			report.m_HandleCount = 0;
+			report.m_RawBytes = 0;
+			report.m_DecodedBytes = 0;
+			index = reportIndices.insert(std::make_pair(handle.m_pLoader, reports.size())).first;
+			reports.push_back(report);
+		}
+
+		ResourceMemoryReport& report = reports[index->second];
+		report.m_HandleCount++;
+		report.m_RawBytes += handle.IsBufferOwned() ? handle.Size() : 0;
+		report.m_DecodedBytes += handle.m_ExtraSize;
+	}
+	return reports;
+}
+
+std::vector<std::string> ResCache::Match(const std::string pattern)
 {
 	std::vector<std::string> matchingNames;
 	if (m_pResFile == nullptr)
@@ -500,27 +1480,308 @@ std::vector<std::string> ResCache::Match(const std::string pattern)
 }
 
 int ResCache::Preload(const std::string pattern, void(*progressCallback)(int, bool &))
+{
+	std::vector<std::string> patterns;
+	patterns.push_back(pattern);
+	return Preload(patterns, progressCallback);
+}
+
+int ResCache::Preload(const std::vector<std::string>& patterns, void(*progressCallback)(int, bool &))
 {
 	if (m_pResFile == nullptr)
 		return 0;
 
-	int numFiles = m_pResFile->VGetNumResources();
+	// Walk the table of contents once for all patterns
+	std::vector<std::string> matchingNames;
+	{
+		int numFiles = m_pResFile->VGetNumResources();
+		for (int i = 0; i < numFiles; ++i)
+		{
+			std::string name = m_pResFile->VGetResourceName(i);
+			std::transform(name.begin(), name.end(), name.begin(), (int(*)(int)) std::tolower);
+			for (const auto& pattern : patterns)
+			{
+				if (Utility::WildcardMatch(pattern.c_str(), name.c_str()))
+				{
+					matchingNames.push_back(name);
+					break;
+				}
+			}
+		}
+	}
+
+	std::vector<Resource> resources(matchingNames.begin(), matchingNames.end());
+	return LoadInParallel(resources, progressCallback);
+}
+
+int ResCache::Prefetch(const std::vector<ResourceId>& ids, void(*progressCallback)(int, bool &))
+{
+	if (m_pResFile == nullptr)
+		return 0;
+
+	struct Request
+	{
+		int64_t m_Offset;
+		Resource m_Resource;
+	};
+	std::vector<Request> requests;
+	std::unordered_set<ResourceId> seen;
+	for (const auto& id : ids)
+	{
+		if (m_ResMap.find(id) != m_ResMap.end() || !seen.insert(id).second)
+			continue;
+
+		Resource resource(id);
+		if (m_pResFile->VGetRawResourceSize(resource) < 0)
+			continue;
+
+		Request request = { m_pResFile->VGetRawResourceOffset(resource), resource };
+		requests.push_back(request);
+	}
+
+	// Files without an order, loose files, are read by name so directories stay together
+	std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b)
+	{
+		if (a.m_Offset != b.m_Offset)
+			return (uint64_t)a.m_Offset < (uint64_t)b.m_Offset;
+		return a.m_Resource.GetName() < b.m_Resource.GetName();
+	});
+
+	std::vector<Resource> resources;
+	resources.reserve(requests.size());
+	for (const auto& request : requests)
+	{
+		resources.push_back(request.m_Resource);
+		m_Prefetched.insert(request.m_Resource.m_Id);
+	}
+
+	// Prefetching is not asking for the resources, keep it out of a recording
+	bool isRecording = m_IsRecording;
+	m_IsRecording = false;
+	int loaded = LoadInParallel(resources, progressCallback);
+	m_IsRecording = isRecording;
+	return loaded;
+}
+
+int ResCache::LoadInParallel(const std::vector<Resource>& resources, void(*progressCallback)(int, bool &))
+{
+	if (resources.empty())
+		return 0;
+
+	std::vector<shared_ptr<BatchRead> > batches = MakeBatches(resources);
+
+	// Keep a bounded number of loads in flight so cancelling stops the remaining work quickly
+	const uint32_t maxInFlight = (m_pLoadThreads != nullptr) ? std::max(m_pLoadThreads->GetThreadCount() * 2, LOADS_IN_FLIGHT) : 1;
+	uint32_t total = resources.size();
+	uint32_t issued = 0;
+	uint32_t completed = 0;
 	int loaded = 0;
 	bool cancel = false;
-	for (int i = 0; i < numFiles; ++i)
-	{
-		Resource resource(m_pResFile->VGetResourceName(i));
+	size_t next = 0;
+	std::vector<shared_ptr<BatchRead> > reads;
 
-		if (Utility::WildcardMatch(pattern.c_str(), resource.m_name.c_str()))
+	ResLoadCallback callback = [&completed, &loaded](shared_ptr<ResHandle> handle)
+	{
+		++completed;
+		if (handle != nullptr)
 		{
-			shared_ptr<ResHandle> handle = GetHandle(&resource);
 			++loaded;
 		}
+	};
+
+	while (completed < issued || (next < batches.size() && !cancel))
+	{
+		// A whole batch goes at once, it is one read however many resources it holds
+		while (next < batches.size() && !cancel && issued - completed < maxInFlight)
+		{
+			shared_ptr<BatchRead> batch = batches[next++];
+			issued += batch->m_Loads.size();
+			if (IssueBatch(batch, callback))
+			{
+				reads.push_back(batch);
+			}
+		}
+
+		if (!reads.empty())
+		{
+			m_pLoadThreads->Submit(boost::bind(&ResCache::ReadBatches, this, reads));
+			reads.clear();
+		}
+
+		if (completed < issued)
+		{
+			WaitForCompletedLoad();
+		}
 
 		if (progressCallback != nullptr)
 		{
-			progressCallback(i * 100 / numFiles, cancel);
+			progressCallback(completed * 100 / total, cancel);
 		}
 	}
+
 	return loaded;
 }
+
+std::vector<shared_ptr<ResCache::BatchRead> > ResCache::MakeBatches(const std::vector<Resource>& resources)
+{
+	std::vector<shared_ptr<BatchRead> > batches;
+	std::vector<shared_ptr<AsyncLoad> > stored;
+	for (const auto& resource : resources)
+	{
+		shared_ptr<IResourceLoader> loader = FindLoader(resource);
+		shared_ptr<AsyncLoad> load(DEBUG_NEW AsyncLoad(resource, loader));
+
+		// Resources used in place need no read at all. They keep the usual path, as does
+		// anything the file can't place.
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		bool isView = loader && !loader->VAddNullZero() && m_pResFile->VGetRawResourceView(resource) != nullptr;
+		if (loader && !isView && m_pResFile->VGetStoredExtent(resource, offset, size) && size <= BATCH_MAX_READ)
+		{
+			load->m_StoredOffset = offset;
+			load->m_StoredSize = size;
+			stored.push_back(load);
+		}
+		else
+		{
+			shared_ptr<BatchRead> single(DEBUG_NEW BatchRead());
+			single->m_Loads.push_back(load);
+			batches.push_back(single);
+		}
+	}
+
+	std::sort(stored.begin(), stored.end(), [](const shared_ptr<AsyncLoad>& a, const shared_ptr<AsyncLoad>& b)
+	{
+		return a->m_StoredOffset < b->m_StoredOffset;
+	});
+
+	// Batches go first in file order, the head only ever moves forward
+	std::vector<shared_ptr<BatchRead> > runs;
+	for (const auto& load : stored)
+	{
+		uint64_t end = load->m_StoredOffset + load->m_StoredSize;
+		BatchRead* pRun = runs.empty() ? nullptr : runs.back().get();
+		if (pRun != nullptr && load->m_StoredOffset <= pRun->m_Offset + pRun->m_Size + BATCH_MAX_GAP &&
+			end - pRun->m_Offset <= BATCH_MAX_READ)
+		{
+			pRun->m_Size = std::max(pRun->m_Size, end - pRun->m_Offset);
+		}
+		else
+		{
+			runs.push_back(shared_ptr<BatchRead>(DEBUG_NEW BatchRead()));
+			pRun = runs.back().get();
+			pRun->m_Offset = load->m_StoredOffset;
+			pRun->m_Size = load->m_StoredSize;
+		}
+		pRun->m_Loads.push_back(load);
+	}
+
+	batches.insert(batches.begin(), runs.begin(), runs.end());
+	return batches;
+}
+
+bool ResCache::IssueBatch(shared_ptr<BatchRead> batch, const ResLoadCallback& callback)
+{
+	// Resident or already loading resources leave the batch, they are answered like any other request
+	std::vector<shared_ptr<AsyncLoad> > loads;
+	for (const auto& load : batch->m_Loads)
+	{
+		const ResourceId& id = load->m_Resource.m_Id;
+		if (batch->m_Size == 0 || m_pLoadThreads == nullptr ||
+			m_ResMap.find(id) != m_ResMap.end() || m_PendingLoads.find(id) != m_PendingLoads.end())
+		{
+			GetHandleAsync(&load->m_Resource, callback);
+			continue;
+		}
+
+		Record(id, false);
+		m_Stats.m_Misses++;
+		load->m_pProfile = StartProfile(load->m_Resource, load->m_pLoader.get());
+		load->m_Callbacks.push_back(callback);
+		m_PendingLoads[id] = load;
+		loads.push_back(load);
+	}
+
+	batch->m_Loads.swap(loads);
+	return !batch->m_Loads.empty();
+}
+
+void ResCache::StartRecording()
+{
+	m_IsRecording = true;
+	m_Recorded.clear();
+	m_RecordedIds.clear();
+	m_RecordingStats = ResRecordingStats();
+}
+
+std::vector<ResourceId> ResCache::StopRecording()
+{
+	m_IsRecording = false;
+	m_RecordedIds.clear();
+	m_Prefetched.clear();
+
+	std::vector<ResourceId> recorded;
+	recorded.swap(m_Recorded);
+	return recorded;
+}
+
+void ResCache::RecordRequest(const ResourceId& id, bool isHit)
+{
+	if (!m_RecordedIds.insert(id).second)
+		return;
+
+	m_Recorded.push_back(id);
+	m_RecordingStats.m_Requested++;
+	if (!isHit)
+	{
+		m_RecordingStats.m_Misses++;
+	}
+	else if (m_Prefetched.erase(id) > 0)
+	{
+		m_RecordingStats.m_PrefetchHits++;
+	}
+}
+
+void ResCache::SetLoadProfiling(bool isProfiling)
+{
+	if (!isProfiling)
+	{
+		m_pLoadProfiler.reset();
+	}
+	else if (m_pLoadProfiler == nullptr)
+	{
+		m_pLoadProfiler = unique_ptr<ResourceLoadProfiler>(DEBUG_NEW ResourceLoadProfiler());
+	}
+}
+
+unique_ptr<ResourceLoadRecord> ResCache::StartProfile(const Resource& r, IResourceLoader* pLoader) const
+{
+	if (m_pLoadProfiler == nullptr)
+		return unique_ptr<ResourceLoadRecord>();
+
+	unique_ptr<ResourceLoadRecord> pProfile(DEBUG_NEW ResourceLoadRecord());
+	pProfile->m_Name = r.GetName();
+	pProfile->m_Loader = (pLoader != nullptr) ? pLoader->VGetPattern() : "";
+	pProfile->m_CallSite = m_CallSites.empty() ? "" : m_CallSites.back();
+	pProfile->m_Requested = std::chrono::steady_clock::now();
+	return pProfile;
+}
+
+void ResCache::FinishProfile(ResourceLoadRecord* pProfile, shared_ptr<ResHandle> handle)
+{
+	// Profiling may have been turned off while the load was on a worker
+	if (pProfile == nullptr || m_pLoadProfiler == nullptr)
+		return;
+
+	pProfile->m_IsLoaded = (handle != nullptr);
+	pProfile->m_DecodedBytes = (handle != nullptr) ? handle->m_Size + handle->m_ExtraSize : 0;
+	pProfile->m_TotalSeconds = SecondsSince(pProfile->m_Requested);
+	m_pLoadProfiler->Add(*pProfile);
+}
+
+void ResCache::WaitForCompletedLoad()
+{
+	shared_ptr<AsyncLoad> load;
+	m_CompletedLoads.wait_and_pop(load);
+	FinishAsyncLoad(load);
+}
@@ -2,33 +2,60 @@
 #include "../TinyEngineBase.h"
 #include "../TinyEngineInterface.h"
 #include "ZipFile.h"
+#include "ResourceId.h"
+#include "ResourceAllocator.h"
+#include "EvictionPolicy.h"
+#include "CompressedResourceCache.h"
+#include "AssetDirectoryIndex.h"
+#include "ResourceDependencyGraph.h"
+#include "FileWatcher.h"
+#include "DerivedDataCache.h"
+#include "ResourceLoadProfiler.h"
+#include "../Utilities/ConcurrentQueue.h"
+#include "boost/thread/mutex.hpp"
+#include <chrono>
 
 class ResHandle;
 class ResCache;
+class ThreadPool;
 
 class IResourceExtraData
 {
 public:
 	virtual std::string VToString() = 0;
+	// Memory held by the decoded resource, counted against the cache budget with the raw buffer
+	virtual uint64_t VGetSize() = 0;
 };
 
 class Resource
 {
 public:
-	Resource(const std::string &name);
-	std::string m_name;
+	Resource(const std::string &name) : m_Id(name) {}
+	Resource(const char *name) : m_Id(name) {}
+	Resource(const ResourceId &id) : m_Id(id) {}
+
+	const std::string& GetName() const { return m_Id.GetName(); }
+
+	ResourceId m_Id;
 };
 
 class ResourceZipFile : public IResourceFile
 {
 public:
-	ResourceZipFile();
+	ResourceZipFile(const std::wstring& resFileName = L"Assets.zip");
 	virtual ~ResourceZipFile();
 
 	virtual bool VOpen() override;
 	virtual void VRemoveRawResource(const Resource &r) override {}
-	virtual int VGetRawResourceSize(const Resource &r) override;
-	virtual int VGetRawResource(const Resource &r, char *buffer) override;
+	virtual int64_t VGetRawResourceSize(const Resource &r) override;
+	virtual int64_t VGetRawResource(const Resource &r, char *buffer) override;
+	virtual int64_t VGetRawResourceOffset(const Resource &r) override;
+	virtual bool VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size) override;
+	virtual bool VReadStored(uint64_t offset, char *buffer, size_t size) override;
+	virtual bool VReadStoredBatch(std::vector<FileReadRequest> &requests) override;
+	virtual int64_t VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer) override;
+	virtual void VSetFileReader(FileReaderType type) override { m_ReaderType = type; }
+	virtual const char* VGetRawResourceView(const Resource &r) override;
 	virtual int VGetNumResources() const override;
 	virtual std::string VGetResourceName(int num) const override;
 	virtual bool VIsUsingDevelopmentDirectories(void) const  override { return false; }
@@ -36,6 +63,7 @@ public:
 private:
 	unique_ptr<ZipFile> m_pZipFile;
 	std::wstring m_ResFileName;
+	FileReaderType m_ReaderType;
 };
 
 class DevelopmentResourceZipFile : public ResourceZipFile
@@ -51,24 +79,30 @@ public:
 
 	virtual bool VOpen();
 	virtual void VRemoveRawResource(const Resource &r) override;
-	virtual int VGetRawResourceSize(const Resource &r) override;
-	virtual int VGetRawResource(const Resource &r, char *buffer) override;
+	virtual int64_t VGetRawResourceSize(const Resource &r) override;
+	virtual int64_t VGetRawResource(const Resource &r, char *buffer) override;
+	virtual int64_t VGetRawResourceOffset(const Resource &r) override;
+	virtual bool VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size) override;
+	virtual bool VReadStored(uint64_t offset, char *buffer, size_t size) override;
+	virtual bool VReadStoredBatch(std::vector<FileReadRequest> &requests) override;
+	virtual int64_t VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer) override;
+	virtual const char* VGetRawResourceView(const Resource &r) override;
 	virtual int VGetNumResources() const override;
 	virtual std::string VGetResourceName(int num) const override;
 	virtual bool VIsUsingDevelopmentDirectories(void) const override { return true; }
+	virtual bool VRefresh() override;
 
 	int Find(const std::string &path);
+	int Find(const ResourceId &id);
 
 	Mode m_Mode;
 	std::string m_AssetsDir;
-	std::vector<WIN32_FIND_DATA> m_AssetFileInfo;
-	ZipContentsMap m_DirectoryContentsMap;
-
-protected:
-	void ReadAssetsDirectory(std::wstring fileSpec);
 
 private:
-	bool AddNewResFile(const std::string& filePath);
+	int FindAsset(const ResourceId &id) { return m_AssetIndex.Find(id, m_Mode == Editor); }
+
+	AssetDirectoryIndex m_AssetIndex;
+	mutable boost::mutex m_AssetsMutex;		// guards the index, Find can add new files from any thread
 };
 
 class ResHandle
@@ -76,14 +110,25 @@ class ResHandle
 	friend class ResCache;
 
 public:
-	ResHandle(Resource& resource, char* buffer, uint32_t size, ResCache* pResCache);
+	ResHandle(const Resource& resource, char* buffer, uint64_t size, ResCache* pResCache, shared_ptr<IResourceAllocator> pAllocator);
 
 	virtual ~ResHandle();
 
-	const std::string GetName() { return m_Resource.m_name; }
-	uint32_t Size() const { return m_Size; }
+	const std::string& GetName() const { return m_Resource.GetName(); }
+	const ResourceId& GetId() const { return m_Resource.m_Id; }
+	uint64_t Size() const { return m_Size; }
 	char* Buffer() const { return m_pBuffer; }
-	char* WritableBuffer() { return m_pBuffer; }
+	char* WritableBuffer() { DEBUG_ASSERT(m_IsBufferOwned); return m_pBuffer; }
+	bool IsBufferOwned() const { return m_IsBufferOwned; }
+	// What the handle is charged to the cache: its own buffer plus the decoded extra data
+	uint64_t GetMemorySize() const { return (m_IsBufferOwned ? m_Size : 0) + m_ExtraSize; }
+
+	uint32_t GetCategory() const { return m_Category; }
+
+	// Pinned handles stay resident even when nobody holds them, pins nest. Main thread only.
+	void Pin();
+	void Unpin();
+	bool IsPinned() const { return m_PinCount > 0; }
 
 	shared_ptr<IResourceExtraData> GetExtraData() { return m_pExtraData; }
 	void SetExtraData(shared_ptr<IResourceExtraData> extra) { m_pExtraData = extra; }
@@ -91,9 +136,29 @@ public:
 protected:
 	Resource m_Resource;
 	char* m_pBuffer;
-	uint32_t m_Size;
+	uint64_t m_Size;
+	bool m_IsBufferOwned;		// false when m_pBuffer is a view into the resource file
 	shared_ptr<IResourceExtraData> m_pExtraData;
+	uint64_t m_ExtraSize;		// m_pExtraData->VGetSize() once the loader is done
+	uint32_t m_PinCount;
+	uint32_t m_Category;		// index into the cache's budget categories
+	IResourceLoader* m_pLoader;
 	ResCache* m_pResCache;
+	weak_ptr<ResHandle> m_pResident;		// the cache's own reference, counts the holders without a lookup
+	shared_ptr<IResourceAllocator> m_pAllocator;		// owns m_pBuffer, may outlive the cache
+};
+
+// Keeps a handle pinned for the lifetime of the guard
+class ScopedResPin : public boost::noncopyable
+{
+public:
+	explicit ScopedResPin(shared_ptr<ResHandle> handle) : m_pHandle(handle) { if (m_pHandle) m_pHandle->Pin(); }
+	~ScopedResPin() { if (m_pHandle) m_pHandle->Unpin(); }
+
+	const shared_ptr<ResHandle>& Get() const { return m_pHandle; }
+
+private:
+	shared_ptr<ResHandle> m_pHandle;
 };
 
 class DefaultResourceLoader : public IResourceLoader
@@ -103,58 +168,369 @@ public:
 	virtual bool VDiscardRawBufferAfterLoad() { return true; }
 	virtual uint32_t VGetLoadedResourceSize(char* rawBuffer, uint32_t rawSize) { return rawSize; }
 	virtual bool VLoadResource(char* rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle) { return true; }
+	virtual bool VIsThreadSafe() { return true; }
 	virtual std::string VGetPattern() { return "*"; }
 
 };
 
-typedef std::list< shared_ptr <ResHandle > > ResHandleList;
-typedef std::map<std::string, shared_ptr < ResHandle  > > ResHandleMap;
-typedef std::list< shared_ptr < IResourceLoader > > ResourceLoaders;
+// Owns the resident handles, the order they are evicted in is up to the eviction policy
+typedef std::unordered_map<ResourceId, shared_ptr<ResHandle> > ResHandleMap;
+typedef std::function<void(shared_ptr<ResHandle>)> ResLoadCallback;
+// changed are the resources whose files changed, affected adds everything that depends on them
+typedef std::function<void(const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected)> ResChangedCallback;
+
+enum ResLoadStatus
+{
+	ResLoad_Ok,
+	ResLoad_Failed,				// missing resource, no loader, or a read or decode error
+	ResLoad_BudgetExhausted,	// every resident handle is pinned or still held, nothing could be evicted
+};
+
+struct ResourceMemoryReport
+{
+	std::string m_Loader;		// the loader's pattern
+	uint32_t m_HandleCount;
+	uint64_t m_RawBytes;
+	uint64_t m_DecodedBytes;
+};
+
+struct ResourceCategoryReport
+{
+	std::string m_Name;			// empty for the shared part of the cache
+	uint64_t m_Budget;
+	uint64_t m_Allocated;		// more than the budget while borrowing
+};
+
+// Counted since the eviction policy was set or the stats were last reset
+struct ResCacheStats
+{
+	ResCacheStats() : m_Hits(0), m_Misses(0), m_Evictions(0), m_BytesEvicted(0) {}
+
+	double GetHitRatio() const { return (m_Hits + m_Misses == 0) ? 0.0 : (double)m_Hits / (m_Hits + m_Misses); }
+
+	uint64_t m_Hits;
+	uint64_t m_Misses;			// requests that had to load, joining a pending async load included
+	uint64_t m_Evictions;		// handles dropped to make room, explicit removals and flushes are not counted
+	uint64_t m_BytesEvicted;
+};
+
+// Resources asked for while recording, counted on the first request for each
+struct ResRecordingStats
+{
+	ResRecordingStats() : m_Requested(0), m_Misses(0), m_PrefetchHits(0) {}
+
+	uint32_t m_Requested;
+	uint32_t m_Misses;			// had to be loaded when they were asked for
+	uint32_t m_PrefetchHits;	// were resident only because Prefetch had loaded them
+};
 
 class ResCache
 {
 	friend class ResHandle;
 
 public:
-	ResCache(const uint32_t sizeInMb, const std::string& assetDir, bool isZipResource);
+	// A packaged resource file ending in .pak is opened as an asset pack, anything else as a zip
+	ResCache(const uint32_t sizeInMb, const std::string& assetDir, bool isZipResource, const std::string& resourceFile = "Assets.zip");
 	virtual ~ResCache();
 
 	bool Init();
+	// Before Init, the archive is opened with it
+	void SetFileReader(FileReaderType type) { m_pResFile->VSetFileReader(type); }
 
+	// Plain "*.ext" patterns are indexed by extension, "*" is the catch-all used when nothing
+	// else matches and any other pattern is wildcard matched. Later loaders win, as before.
 	void RegisterLoader(shared_ptr<IResourceLoader> loader);
 
 	shared_ptr<ResHandle> GetHandle(Resource* r);
+	// Cache hits are a single hash probe, keep the id around for resources used every frame
+	shared_ptr<ResHandle> GetHandle(const ResourceId& id);
+	// Also makes the resource file look for it again, whether it was resident or not
 	void RemoveHandle(Resource* r);
+	// Part of a raw resource straight from the resource file, the cache is not involved. Returns
+	// the bytes read, 0 when the file can't read part of that resource.
+	int64_t ReadRawRange(const Resource& r, uint64_t offset, uint64_t size, char* buffer);
+
+	// Reads and inflates the resource on a worker thread. The callback always runs on the
+	// main thread, either right away on a cache hit or from OnUpdate once the load is done.
+	// Loaders that are not thread safe get their VLoadResource call on the main thread.
+	void GetHandleAsync(Resource* r, const ResLoadCallback& callback);
+	// Why the last load on the main thread, sync or finished async, did or did not produce a handle
+	ResLoadStatus GetLastLoadStatus() const { return m_LastLoadStatus; }
+	bool HasPendingLoads() const { return !m_PendingLoads.empty(); }
+	void OnUpdate();
 
 	int Preload(const std::string pattern, void(*progressCallback)(int, bool &) = nullptr);
+	// Matches every pattern in one pass over the resource file and loads the matches in parallel
+	int Preload(const std::vector<std::string>& patterns, void(*progressCallback)(int, bool &) = nullptr);
 	std::vector<std::string> Match(const std::string pattern);
+	// Loads the resources in the order they are stored in the resource file, so a list recorded
+	// on an earlier run is read front to back instead of seeking back and forth. Resources that
+	// are resident or not in the file are skipped. Returns how many were loaded.
+	int Prefetch(const std::vector<ResourceId>& ids, void(*progressCallback)(int, bool &) = nullptr);
+
+	// Remembers every resource asked for, resident or not, in the order of the first request
+	void StartRecording();
+	std::vector<ResourceId> StopRecording();
+	bool IsRecording() const { return m_IsRecording; }
+	const ResRecordingStats& GetRecordingStats() const { return m_RecordingStats; }
 
 	void Flush(void);
 
 	bool IsUsingDevelopmentDirectories(void) const { DEBUG_ASSERT(m_pResFile); return m_pResFile->VIsUsingDevelopmentDirectories(); }
+	// Lets the resource file look for assets added or removed on disk, resident handles are left alone
+	bool RefreshResourceFile() { DEBUG_ASSERT(m_pResFile); return m_pResFile->VRefresh(); }
+
+	// Dependencies are recorded as resources load, loaders declare their own through
+	// IResourceLoader::VGetDependencies. Users add what only they know, like a model and
+	// the materials it is drawn with.
+	void AddDependency(const ResourceId& dependent, const ResourceId& dependency) { m_Dependencies.AddDependency(dependent, dependency); }
+	const ResourceDependencyGraph& GetDependencies() const { return m_Dependencies; }
+	// Drops the cached copies of the changed resources, the next GetHandle reads them again, and
+	// reports them with everything depending on them to the resource changed callback. Handles
+	// held elsewhere stay valid, their holders are expected to let go when told.
+	void Reload(const std::vector<ResourceId>& changed);
+	void SetResourceChangedCallback(const ResChangedCallback& callback) { m_ResourceChangedCallback = callback; }
+	// Development directories only. Files changed on disk are reloaded from OnUpdate.
+	bool WatchAssetDirectory();
+
+	// Buffers already handed out go back to the allocator they came from, so this can be
+	// swapped at any time. Defaults to a SlabResourceAllocator.
+	void SetAllocator(shared_ptr<IResourceAllocator> allocator) { DEBUG_ASSERT(allocator); m_pAllocator = allocator; }
+	ResourceAllocatorStats GetAllocatorStats() const { return m_pAllocator->VGetStats(); }
+
+	uint64_t GetBudget() const { return m_CacheSize; }
+	// Evicts down to the new size right away. Handles that are pinned or still held elsewhere
+	// stay, so the cache can remain over budget until they are released.
+	void SetBudget(uint64_t bytes);
+	// For hosts under memory pressure: evicts until at most targetFraction of what the cache
+	// holds now is left, the compressed tier included. Evicted buffers are not compressed
+	// while trimming. The budget is unchanged, returns the bytes given back by the first tier.
+	uint64_t Trim(double targetFraction);
+	uint64_t GetAllocated() const { return m_Allocated; }
+	// Resident handles grouped by the loader that decoded them
+	std::vector<ResourceMemoryReport> GetMemoryReport() const;
+
+	// Resident handles are handed over to the new policy in no particular order, the stats
+	// start over so they always describe a single policy. Defaults to LRU.
+	void SetEvictionPolicy(shared_ptr<IResourceEvictionPolicy> policy);
+	const IResourceEvictionPolicy& GetEvictionPolicy() const { return *m_pEvictionPolicy; }
+	const ResCacheStats& GetStats() const { return m_Stats; }
+	void ResetStats() { m_Stats = ResCacheStats(); m_pCompressedCache->ResetStats(); }
+
+	// Evicted raw resources are kept compressed within this budget, on top of the cache size,
+	// and loading them again skips the resource file. 0, the default, turns the tier off.
+	// Decoded resources are not kept, their raw bytes are gone once the loader is done.
+	void SetCompressedCacheBudget(uint64_t bytes) { m_pCompressedCache->SetBudget(bytes); }
+	CompressedCacheStats GetCompressedCacheStats() const { return m_pCompressedCache->GetStats(); }
+
+	// Handles are charged to the category their loader declares. A category with a budget only
+	// evicts its own handles to stay within it, so a big model import cannot push compiled
+	// effects out. Loaders without a budgeted category share what the budgets leave of the cache.
+	// Lowering a budget takes effect on the next load in that category.
+	void SetCategoryBudget(const std::string& category, uint64_t bytes);
+	// When borrowing, a category past its budget may use cache memory nobody else is using.
+	// Borrowed memory is evicted first when another category needs its own budget back.
+	void SetBorrowAcrossCategories(bool isBorrowing) { m_IsBorrowing = isBorrowing; }
+	std::vector<ResourceCategoryReport> GetCategoryReport() const;
+
+	// Loaders keep what they build from resources here between runs, nullptr when there is none
+	void SetDerivedDataCache(shared_ptr<DerivedDataCache> cache) { m_pDerivedDataCache = cache; }
+	shared_ptr<DerivedDataCache> GetDerivedDataCache() const { return m_pDerivedDataCache; }
+
+	// Times the read, inflate and decode of every load from here on. Entries that are compressed
+	// are read and inflated in two steps while profiling, as batched loads are, so the phases can
+	// be told apart. Off by default, turning it off drops what was recorded.
+	void SetLoadProfiling(bool isProfiling);
+	// nullptr while not profiling
+	const ResourceLoadProfiler* GetLoadProfiler() const { return m_pLoadProfiler.get(); }
+	bool WriteLoadProfile(const std::string& fileName) const { return m_pLoadProfiler != nullptr && m_pLoadProfiler->WriteReport(fileName); }
+	// Loads requested until the matching pop are reported as asked for by callSite, see
+	// ScopedResCallSite. Loaders asking for more resources are the call site of those themselves.
+	void PushCallSite(const std::string& callSite) { m_CallSites.push_back(callSite); }
+	void PopCallSite() { DEBUG_ASSERT(!m_CallSites.empty()); m_CallSites.pop_back(); }
 
 protected:
 
-	bool MakeRoom(uint32_t size);
-	char *Allocate(uint32_t size);
+	bool MakeRoom(uint64_t size, uint32_t category);
+	char *Allocate(uint64_t size, uint32_t category);
+	void Release(char* buffer, uint64_t size, uint32_t category);
 	void Free(shared_ptr<ResHandle> gonner);
+	void PinChanged(ResHandle* pHandle);
+	// Takes a handle out of the map, remembering it when somebody still holds it
+	void Detach(ResHandleMap::iterator i);
 
 	shared_ptr<ResHandle> Load(Resource* r);
 	shared_ptr<ResHandle> Find(Resource* r);
-	void Update(shared_ptr<ResHandle> handle);
+	void Update(ResHandle* pHandle);
+	void Insert(shared_ptr<ResHandle> handle);
+
+	struct RawResource
+	{
+		RawResource() : m_pBuffer(nullptr), m_Size(-1), m_IsView(false) {}
+		void Release() { if (!m_IsView && m_pBuffer != nullptr) { m_pAllocator->VFree(m_pBuffer); } m_pBuffer = nullptr; }
+
+		char* m_pBuffer;
+		int64_t m_Size;
+		bool m_IsView;		// m_pBuffer points into the resource file and is not ours to free
+		shared_ptr<IResourceAllocator> m_pAllocator;
+	};
 
-	void FreeOneResource();
-	void MemoryHasBeenFreed(uint32_t size);
+	shared_ptr<IResourceLoader> FindLoader(const Resource& r);
+	// pProfile is nullptr while not profiling
+	bool ReadRawResource(const Resource& r, shared_ptr<IResourceLoader> loader, bool isDetached, RawResource& raw, ResourceLoadRecord* pProfile);
+	int64_t ReadProfiled(const Resource& r, int64_t rawSize, char* rawBuffer, ResourceLoadRecord& profile);
+	shared_ptr<ResHandle> DecodeResource(
+		const Resource& r, shared_ptr<IResourceLoader> loader, RawResource& raw, bool isDetached, ResourceLoadRecord* pProfile);
+
+	// Evicts the policy's pick among the handles nobody else holds, false if there is none
+	bool FreeOneResource();
+	bool FreeOneResource(uint32_t category);
+	// Evicts from whichever category is over its budget
+	bool FreeOneBorrowedResource();
+	void EvictDownTo(uint64_t bytes);
+	static bool CanEvict(ResHandle* pHandle);
+	void ChargeExtraData(shared_ptr<ResHandle> handle);
+	void Charge(uint64_t size, uint32_t category);
+	void MemoryHasBeenFreed(uint64_t size, uint32_t category);
 
 private:
-	ResHandleList m_ResList;
+	struct AsyncLoad
+	{
+		AsyncLoad(const Resource& resource, shared_ptr<IResourceLoader> loader)
+			: m_Resource(resource), m_pLoader(loader), m_StoredOffset(0), m_StoredSize(0), m_IsStale(false) {}
+		~AsyncLoad() { m_Raw.Release(); }
+
+		Resource m_Resource;
+		shared_ptr<IResourceLoader> m_pLoader;
+		RawResource m_Raw;
+		shared_ptr<ResHandle> m_pHandle;
+		std::vector<ResLoadCallback> m_Callbacks;
+		uint64_t m_StoredOffset;		// where the stored bytes are in the file, for batched reads
+		uint64_t m_StoredSize;
+		bool m_IsStale;			// the file changed while it was being read, main thread only
+		unique_ptr<ResourceLoadRecord> m_pProfile;		// filled in by whichever thread works on the load
+	};
+	typedef std::unordered_map<ResourceId, shared_ptr<AsyncLoad> > AsyncLoadMap;
+
+	// Loads whose stored bytes lie close together in the file, read with one read and decoded apart.
+	// A batch with no size holds a single load read the usual way.
+	struct BatchRead
+	{
+		BatchRead() : m_Offset(0), m_Size(0) {}
+
+		uint64_t m_Offset;
+		uint64_t m_Size;
+		std::vector<shared_ptr<AsyncLoad> > m_Loads;
+		unique_ptr<char[]> m_pData;
+	};
+
+	struct LoaderEntry
+	{
+		std::string m_Pattern;		// just the extension for indexed loaders
+		shared_ptr<IResourceLoader> m_pLoader;
+		uint32_t m_Order;			// registration order
+	};
+	typedef std::list<LoaderEntry> LoaderList;
+	typedef std::unordered_map<uint64_t, LoaderEntry> LoaderMap;		// keyed by ResourceId::Hash of the extension
+
+	struct Category
+	{
+		std::string m_Name;
+		uint64_t m_Budget;
+		uint64_t m_Allocated;
+	};
+
+	// What VGetCategory returned at registration, resolved to an index again when categories are added
+	struct LoaderCategory
+	{
+		shared_ptr<IResourceLoader> m_pLoader;		// keeps the key valid
+		std::string m_Name;
+		uint32_t m_Index;
+	};
+	typedef std::unordered_map<IResourceLoader*, LoaderCategory> LoaderCategoryMap;
+
+	static const char* GetExtension(const std::string& name);
+	// Main thread only, workers never look at categories
+	uint32_t GetCategory(IResourceLoader* pLoader) const;
+	// 0, the shared part, for names without a budget of their own
+	uint32_t FindCategory(const std::string& name) const;
+	bool EvictOne(const IResourceEvictionPolicy::CategoryList& categories);
+	void KeepEvictedBuffer(ResHandle* pVictim);
+	void UpdateSharedBudget();
+
+	// Keeps a bounded number of async loads in flight, returns how many produced a handle
+	int LoadInParallel(const std::vector<Resource>& resources, void(*progressCallback)(int, bool &));
+	// Groups the resources by where they are stored, nearby ones share a read
+	std::vector<shared_ptr<BatchRead> > MakeBatches(const std::vector<Resource>& resources);
+	// True when the batch still needs its read, resident and pending resources are answered right away
+	bool IssueBatch(shared_ptr<BatchRead> batch, const ResLoadCallback& callback);
+	void Record(const ResourceId& id, bool isHit) { if (m_IsRecording) RecordRequest(id, isHit); }
+	void RecordRequest(const ResourceId& id, bool isHit);
+	unique_ptr<ResourceLoadRecord> StartProfile(const Resource& r, IResourceLoader* pLoader) const;
+	void FinishProfile(ResourceLoadRecord* pProfile, shared_ptr<ResHandle> handle);
+
+	void LoadAsync(shared_ptr<AsyncLoad> load);
+	// All the batches' reads in flight together as far as the resource file allows
+	void ReadBatches(std::vector<shared_ptr<BatchRead> > batches);
+	void DecodeStored(shared_ptr<BatchRead> batch, shared_ptr<AsyncLoad> load);
+	void DecodeAsync(shared_ptr<AsyncLoad> load);
+	void FinishAsyncLoad(shared_ptr<AsyncLoad> load);
+	void WaitForCompletedLoad();
+	shared_ptr<ResHandle> Adopt(shared_ptr<ResHandle> handle);
+	void CheckForChangedFiles();
+
 	ResHandleMap m_ResMap;
-	ResourceLoaders m_ResourceLoaders;
+	std::vector<weak_ptr<ResHandle> > m_DetachedHandles;	// out of the map but still held, still charged to the cache
+	shared_ptr<IResourceEvictionPolicy> m_pEvictionPolicy;
+	ResCacheStats m_Stats;
+	LoaderMap m_LoadersByExtension;
+	LoaderList m_PatternLoaders;		// newest first
+	shared_ptr<IResourceLoader> m_pDefaultLoader;
+	uint32_t m_LoaderCount;
 
 	unique_ptr<IResourceFile> m_pResFile;
+	shared_ptr<IResourceAllocator> m_pAllocator;
+	unique_ptr<CompressedResourceCache> m_pCompressedCache;
+	shared_ptr<DerivedDataCache> m_pDerivedDataCache;
+
+	unique_ptr<ThreadPool> m_pLoadThreads;
+	AsyncLoadMap m_PendingLoads;
+	concurrent_queue<shared_ptr<AsyncLoad> > m_CompletedLoads;
+
+	uint64_t m_CacheSize;
+	uint64_t m_Allocated;
+	std::vector<Category> m_Categories;		// the shared part of the cache first
+	LoaderCategoryMap m_LoaderCategories;
+	bool m_IsBorrowing;
+	bool m_IsTrimming;
+	ResLoadStatus m_LastLoadStatus;
+
+	ResourceDependencyGraph m_Dependencies;
+	ResChangedCallback m_ResourceChangedCallback;
+	std::string m_AssetDir;			// empty for packaged resources
+	unique_ptr<IFileWatcher> m_pFileWatcher;
+	std::unordered_set<ResourceId> m_ChangedFiles;		// waiting for the writes to settle
+	std::chrono::steady_clock::time_point m_LastFileChange;
+
+	bool m_IsRecording;
+	std::vector<ResourceId> m_Recorded;
+	std::unordered_set<ResourceId> m_RecordedIds;
+	std::unordered_set<ResourceId> m_Prefetched;		// loaded by Prefetch and not asked for since
+	ResRecordingStats m_RecordingStats;
+
+	unique_ptr<ResourceLoadProfiler> m_pLoadProfiler;
+	std::vector<std::string> m_CallSites;		// innermost last
+};
 
-	uint32_t m_CacheSize;
-	uint32_t m_Allocated;
+// Names what the loads requested during the lifetime of the guard are for in the load profile
+class ScopedResCallSite : public boost::noncopyable
+{
+public:
+	ScopedResCallSite(ResCache* pResCache, const std::string& callSite) : m_pResCache(pResCache) { if (m_pResCache) m_pResCache->PushCallSite(callSite); }
+	~ScopedResCallSite() { if (m_pResCache) m_pResCache->PopCallSite(); }
+
+private:
+	ResCache* m_pResCache;
 };
 
 shared_ptr<IResourceLoader> CreateDdsResourceLoader();
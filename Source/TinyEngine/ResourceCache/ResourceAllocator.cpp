@@ -0,0 +1,309 @@
+#include "ResourceAllocator.h"
+
+namespace
+{
+	// Roughly 1.5x apart, so rounding a buffer up to its slot wastes a third at most
+	const size_t s_SizeClasses[] =
+	{
+		16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048,
+		3072, 4096, 6144, 8192, 12288, 16384, 24576, 32768, 49152, 65536,
+	};
+	const uint32_t s_SizeClassCount = sizeof(s_SizeClasses) / sizeof(s_SizeClasses[0]);
+
+	template <class Map>
+	typename Map::iterator FindOwner(Map& owners, const char* pBuffer, size_t ownerSize)
+	{
+		typename Map::iterator it = owners.upper_bound(pBuffer);
+		if (it == owners.begin())
+			return owners.end();
+
+		--it;
+		return (pBuffer < it->first + ownerSize) ? it : owners.end();
+	}
+}
+
+char* HeapResourceAllocator::VAllocate(size_t size)
+{
+	char* pMemory = DEBUG_NEW char[size + HEADER_SIZE];
+	*reinterpret_cast<size_t*>(pMemory) = size;
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Stats.m_BytesInUse += size;
+	m_Stats.m_BytesReserved += size;
+	m_Stats.m_PeakBytesInUse = std::max(m_Stats.m_PeakBytesInUse, m_Stats.m_BytesInUse);
+	m_Stats.m_PeakBytesReserved = std::max(m_Stats.m_PeakBytesReserved, m_Stats.m_BytesReserved);
+	m_Stats.m_LiveAllocations++;
+	m_Stats.m_TotalAllocations++;
+	return pMemory + HEADER_SIZE;
+}
+
+void HeapResourceAllocator::VFree(char* pBuffer)
+{
+	if (pBuffer == nullptr)
+		return;
+
+	char* pMemory = pBuffer - HEADER_SIZE;
+	size_t size = *reinterpret_cast<size_t*>(pMemory);
+	SAFE_DELETE_ARRAY(pMemory);
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	m_Stats.m_BytesInUse -= size;
+	m_Stats.m_BytesReserved -= size;
+	m_Stats.m_LiveAllocations--;
+}
+
+ResourceAllocatorStats HeapResourceAllocator::VGetStats() const
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return m_Stats;
+}
+
+SlabResourceAllocator::SlabResourceAllocator()
+	: m_PartialSlabs(s_SizeClassCount)
+{
+
+}
+
+SlabResourceAllocator::~SlabResourceAllocator()
+{
+	DEBUG_ASSERT(m_Stats.m_LiveAllocations == 0);
+
+	for (auto& slab : m_Slabs)
+	{
+		SAFE_DELETE_ARRAY(slab.second.m_pMemory);
+	}
+	for (auto& block : m_ArenaBlocks)
+	{
+		SAFE_DELETE_ARRAY(block.second.m_pMemory);
+	}
+}
+
+uint32_t SlabResourceAllocator::GetSizeClass(size_t size)
+{
+	return (uint32_t)(std::lower_bound(s_SizeClasses, s_SizeClasses + s_SizeClassCount, size) - s_SizeClasses);
+}
+
+size_t SlabResourceAllocator::GetSlotSize(uint32_t sizeClass)
+{
+	return s_SizeClasses[sizeClass];
+}
+
+char* SlabResourceAllocator::VAllocate(size_t size)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return (size <= MAX_SLAB_ALLOCATION) ? AllocateSlot(std::max(size, (size_t)1)) : AllocateRange(size);
+}
+
+void SlabResourceAllocator::VFree(char* pBuffer)
+{
+	if (pBuffer == nullptr)
+		return;
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	std::map<const char*, Slab>::iterator slab = FindOwner(m_Slabs, pBuffer, SLAB_SIZE);
+	if (slab != m_Slabs.end())
+	{
+		FreeSlot(slab->second, pBuffer);
+		return;
+	}
+
+	std::map<const char*, ArenaBlock>::iterator block = m_ArenaBlocks.upper_bound(pBuffer);
+	if (block != m_ArenaBlocks.begin())
+	{
+		--block;
+		if (pBuffer < block->second.m_pMemory + block->second.m_Size)
+		{
+			FreeRange(block->second, pBuffer);
+			return;
+		}
+	}
+
+	DEBUG_ERROR("Freeing a buffer that was not allocated by this allocator");
+}
+
+ResourceAllocatorStats SlabResourceAllocator::VGetStats() const
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+	return m_Stats;
+}
+
+char* SlabResourceAllocator::AllocateSlot(size_t size)
+{
+	uint32_t sizeClass = GetSizeClass(size);
+	size_t slotSize = GetSlotSize(sizeClass);
+	std::vector<Slab*>& partialSlabs = m_PartialSlabs[sizeClass];
+
+	if (partialSlabs.empty())
+	{
+		Slab slab;
+		slab.m_pMemory = DEBUG_NEW char[SLAB_SIZE];
+		slab.m_SizeClass = sizeClass;
+		slab.m_UsedSlots = 0;
+		slab.m_UntouchedSlot = 0;
+		slab.m_pFreeList = nullptr;
+		partialSlabs.push_back(&m_Slabs.insert(std::make_pair(slab.m_pMemory, slab)).first->second);
+		OnReserved(SLAB_SIZE);
+	}
+
+	Slab& slab = *partialSlabs.back();
+	char* pSlot = slab.m_pFreeList;
+	if (pSlot != nullptr)
+	{
+		slab.m_pFreeList = *reinterpret_cast<char**>(pSlot);
+	}
+	else
+	{
+		pSlot = slab.m_pMemory + slab.m_UntouchedSlot * slotSize;
+		slab.m_UntouchedSlot++;
+	}
+
+	if (++slab.m_UsedSlots == GetSlotCount(sizeClass))
+	{
+		partialSlabs.pop_back();
+	}
+
+	OnAllocated(slotSize);
+	return pSlot;
+}
+
+void SlabResourceAllocator::FreeSlot(Slab& slab, char* pBuffer)
+{
+	std::vector<Slab*>& partialSlabs = m_PartialSlabs[slab.m_SizeClass];
+	size_t slotSize = GetSlotSize(slab.m_SizeClass);
+	DEBUG_ASSERT((pBuffer - slab.m_pMemory) % slotSize == 0);
+
+	if (slab.m_UsedSlots == GetSlotCount(slab.m_SizeClass))
+	{
+		partialSlabs.push_back(&slab);
+	}
+
+	*reinterpret_cast<char**>(pBuffer) = slab.m_pFreeList;
+	slab.m_pFreeList = pBuffer;
+	slab.m_UsedSlots--;
+
+	m_Stats.m_BytesInUse -= slotSize;
+	m_Stats.m_LiveAllocations--;
+
+	// Keep one slab per size class around so a load/evict cycle does not hit the heap each time
+	if (slab.m_UsedSlots == 0 && partialSlabs.size() > 1)
+	{
+		partialSlabs.erase(std::find(partialSlabs.begin(), partialSlabs.end(), &slab));
+		char* pMemory = slab.m_pMemory;
+		m_Slabs.erase(pMemory);
+		SAFE_DELETE_ARRAY(pMemory);
+		m_Stats.m_BytesReserved -= SLAB_SIZE;
+	}
+}
+
+char* SlabResourceAllocator::AllocateRange(size_t size)
+{
+	size_t rangeSize = (size + ARENA_GRANULARITY - 1) & ~(size_t)(ARENA_GRANULARITY - 1);
+
+	// Best fit over every hole, there are only a handful of blocks
+	ArenaBlock* pBestBlock = nullptr;
+	std::map<size_t, size_t>::iterator bestRange;
+	for (auto& block : m_ArenaBlocks)
+	{
+		for (std::map<size_t, size_t>::iterator it = block.second.m_FreeRanges.begin(); it != block.second.m_FreeRanges.end(); ++it)
+		{
+			if (it->second >= rangeSize && (pBestBlock == nullptr || it->second < bestRange->second))
+			{
+				pBestBlock = &block.second;
+				bestRange = it;
+			}
+		}
+	}
+
+	if (pBestBlock == nullptr)
+	{
+		ArenaBlock block;
+		block.m_Size = std::max(rangeSize, (size_t)ARENA_BLOCK_SIZE);
+		block.m_pMemory = DEBUG_NEW char[block.m_Size];
+		pBestBlock = &m_ArenaBlocks.insert(std::make_pair(block.m_pMemory, block)).first->second;
+		bestRange = pBestBlock->m_FreeRanges.insert(std::make_pair((size_t)0, pBestBlock->m_Size)).first;
+		OnReserved(pBestBlock->m_Size);
+	}
+
+	size_t offset = bestRange->first;
+	size_t remaining = bestRange->second - rangeSize;
+	pBestBlock->m_FreeRanges.erase(bestRange);
+	if (remaining > 0)
+	{
+		pBestBlock->m_FreeRanges[offset + rangeSize] = remaining;
+	}
+	pBestBlock->m_UsedRanges[offset] = rangeSize;
+
+	OnAllocated(rangeSize);
+	return pBestBlock->m_pMemory + offset;
+}
+
+void SlabResourceAllocator::FreeRange(ArenaBlock& block, char* pBuffer)
+{
+	size_t offset = pBuffer - block.m_pMemory;
+	std::unordered_map<size_t, size_t>::iterator used = block.m_UsedRanges.find(offset);
+	if (used == block.m_UsedRanges.end())
+	{
+		DEBUG_ERROR("Freeing a buffer that was not allocated by this allocator");
+		return;
+	}
+
+	size_t size = used->second;
+	block.m_UsedRanges.erase(used);
+	m_Stats.m_BytesInUse -= size;
+	m_Stats.m_LiveAllocations--;
+
+	// Merge with the holes on either side
+	std::map<size_t, size_t>::iterator next = block.m_FreeRanges.lower_bound(offset);
+	if (next != block.m_FreeRanges.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = block.m_FreeRanges.erase(next);
+	}
+	if (next != block.m_FreeRanges.begin())
+	{
+		std::map<size_t, size_t>::iterator prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			block.m_FreeRanges.erase(prev);
+		}
+	}
+	block.m_FreeRanges[offset] = size;
+
+	if (!block.m_UsedRanges.empty())
+		return;
+
+	// Oversized blocks go right away, a regular one stays as long as it is the only spare
+	bool keepBlock = (block.m_Size == ARENA_BLOCK_SIZE);
+	for (auto& other : m_ArenaBlocks)
+	{
+		if (&other.second != &block && other.second.m_Size == ARENA_BLOCK_SIZE && other.second.m_UsedRanges.empty())
+		{
+			keepBlock = false;
+			break;
+		}
+	}
+
+	if (!keepBlock)
+	{
+		char* pMemory = block.m_pMemory;
+		m_Stats.m_BytesReserved -= block.m_Size;
+		m_ArenaBlocks.erase(pMemory);
+		SAFE_DELETE_ARRAY(pMemory);
+	}
+}
+
+void SlabResourceAllocator::OnAllocated(size_t size)
+{
+	m_Stats.m_BytesInUse += size;
+	m_Stats.m_PeakBytesInUse = std::max(m_Stats.m_PeakBytesInUse, m_Stats.m_BytesInUse);
+	m_Stats.m_LiveAllocations++;
+	m_Stats.m_TotalAllocations++;
+}
+
+void SlabResourceAllocator::OnReserved(size_t size)
+{
+	m_Stats.m_BytesReserved += size;
+	m_Stats.m_PeakBytesReserved = std::max(m_Stats.m_PeakBytesReserved, m_Stats.m_BytesReserved);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "boost/thread/mutex.hpp"
+
+struct ResourceAllocatorStats
+{
+	ResourceAllocatorStats()
+		: m_BytesInUse(0), m_BytesReserved(0), m_PeakBytesInUse(0), m_PeakBytesReserved(0),
+		m_LiveAllocations(0), m_TotalAllocations(0) {}
+
+	// Share of the reserved memory that is not handed out, size class rounding included
+	double GetFragmentation() const { return (m_BytesReserved == 0) ? 0.0 : 1.0 - (double)m_BytesInUse / m_BytesReserved; }
+
+	uint64_t m_BytesInUse;			// bytes handed out, rounded to the allocator's granularity
+	uint64_t m_BytesReserved;		// bytes taken from the heap
+	uint64_t m_PeakBytesInUse;
+	uint64_t m_PeakBytesReserved;	// high-water mark
+	uint64_t m_LiveAllocations;
+	uint64_t m_TotalAllocations;
+};
+
+// Backing memory of resource buffers. Buffers are allocated on the resource worker threads and
+// freed wherever the last handle goes away, implementations must be thread safe.
+class IResourceAllocator
+{
+public:
+	virtual ~IResourceAllocator() {}
+	virtual char* VAllocate(size_t size) = 0;
+	virtual void VFree(char* pBuffer) = 0;
+	virtual ResourceAllocatorStats VGetStats() const = 0;
+};
+
+// Plain new/delete, mostly useful as a baseline when comparing allocators
+class HeapResourceAllocator : public IResourceAllocator
+{
+public:
+	virtual char* VAllocate(size_t size) override;
+	virtual void VFree(char* pBuffer) override;
+	virtual ResourceAllocatorStats VGetStats() const override;
+
+private:
+	static const size_t HEADER_SIZE = 16;		// keeps the size in front of the buffer, 16 byte aligned
+
+	mutable boost::mutex m_Mutex;
+	ResourceAllocatorStats m_Stats;
+};
+
+// Small buffers come from slabs of fixed size slots, one slab per size class, so the many
+// small .mat, .xml and .fx buffers never fragment the heap. Larger buffers are carved out of
+// big arena blocks with best fit and coalescing on free. Empty slabs and blocks beyond one
+// spare are given back.
+class SlabResourceAllocator : public IResourceAllocator
+{
+public:
+	enum
+	{
+		SLAB_SIZE = 256 * 1024,
+		MAX_SLAB_ALLOCATION = 64 * 1024,
+		ARENA_BLOCK_SIZE = 16 * 1024 * 1024,
+		ARENA_GRANULARITY = 4096,
+	};
+
+	SlabResourceAllocator();
+	virtual ~SlabResourceAllocator();
+
+	virtual char* VAllocate(size_t size) override;
+	virtual void VFree(char* pBuffer) override;
+	virtual ResourceAllocatorStats VGetStats() const override;
+
+private:
+	struct Slab
+	{
+		char* m_pMemory;
+		uint32_t m_SizeClass;
+		uint32_t m_UsedSlots;
+		uint32_t m_UntouchedSlot;		// slots from here on were never handed out
+		char* m_pFreeList;				// freed slots, linked through their first bytes
+	};
+
+	struct ArenaBlock
+	{
+		char* m_pMemory;
+		size_t m_Size;
+		std::map<size_t, size_t> m_FreeRanges;				// offset to size, always coalesced
+		std::unordered_map<size_t, size_t> m_UsedRanges;	// offset to size
+	};
+
+	static uint32_t GetSizeClass(size_t size);
+	static size_t GetSlotSize(uint32_t sizeClass);
+	static uint32_t GetSlotCount(uint32_t sizeClass) { return (uint32_t)(SLAB_SIZE / GetSlotSize(sizeClass)); }
+
+	char* AllocateSlot(size_t size);
+	void FreeSlot(Slab& slab, char* pBuffer);
+	char* AllocateRange(size_t size);
+	void FreeRange(ArenaBlock& block, char* pBuffer);
+
+	void OnAllocated(size_t size);
+	void OnReserved(size_t size);
+
+	mutable boost::mutex m_Mutex;
+	std::map<const char*, Slab> m_Slabs;					// by address, to find the owner on free
+	std::vector<std::vector<Slab*> > m_PartialSlabs;		// per size class, slabs with free slots
+	std::map<const char*, ArenaBlock> m_ArenaBlocks;
+	ResourceAllocatorStats m_Stats;
+};
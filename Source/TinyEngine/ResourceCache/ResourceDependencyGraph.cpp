@@ -0,0 +1,73 @@
+#include "ResourceDependencyGraph.h"
+
+void ResourceDependencyGraph::AddDependency(const ResourceId& dependent, const ResourceId& dependency)
+{
+	if (dependent == dependency || dependent.IsEmpty() || dependency.IsEmpty())
+		return;
+
+	m_Dependencies[dependent].insert(dependency);
+	m_Dependents[dependency].insert(dependent);
+}
+
+void ResourceDependencyGraph::RemoveDependencies(const ResourceId& dependent)
+{
+	EdgeMap::iterator it = m_Dependencies.find(dependent);
+	if (it == m_Dependencies.end())
+		return;
+
+	for (const auto& dependency : it->second)
+	{
+		EdgeMap::iterator dependents = m_Dependents.find(dependency);
+		if (dependents != m_Dependents.end())
+		{
+			dependents->second.erase(dependent);
+			if (dependents->second.empty())
+			{
+				m_Dependents.erase(dependents);
+			}
+		}
+	}
+	m_Dependencies.erase(it);
+}
+
+void ResourceDependencyGraph::Clear()
+{
+	m_Dependencies.clear();
+	m_Dependents.clear();
+}
+
+std::vector<ResourceId> ResourceDependencyGraph::GetAffected(const std::vector<ResourceId>& changed) const
+{
+	// Breadth first, the visited set keeps cycles from looping
+	std::vector<ResourceId> affected;
+	std::unordered_set<ResourceId> visited;
+	for (const auto& id : changed)
+	{
+		if (visited.insert(id).second)
+		{
+			affected.push_back(id);
+		}
+	}
+
+	for (size_t i = 0; i < affected.size(); i++)
+	{
+		EdgeMap::const_iterator dependents = m_Dependents.find(affected[i]);
+		if (dependents == m_Dependents.end())
+			continue;
+
+		for (const auto& dependent : dependents->second)
+		{
+			if (visited.insert(dependent).second)
+			{
+				affected.push_back(dependent);
+			}
+		}
+	}
+	return affected;
+}
+
+const std::unordered_set<ResourceId>* ResourceDependencyGraph::GetDependencies(const ResourceId& dependent) const
+{
+	EdgeMap::const_iterator it = m_Dependencies.find(dependent);
+	return (it == m_Dependencies.end()) ? nullptr : &it->second;
+}
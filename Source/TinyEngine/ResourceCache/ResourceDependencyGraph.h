@@ -0,0 +1,27 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "ResourceId.h"
+#include <unordered_set>
+
+// Which resources were built from which. Edges are recorded as resources load (a material on
+// its effect and textures, a model on its materials) and walked backwards when a file changes,
+// so only what was built from the changed file has to be refreshed. Main thread only.
+class ResourceDependencyGraph : public boost::noncopyable
+{
+public:
+	void AddDependency(const ResourceId& dependent, const ResourceId& dependency);
+	// Drops what the resource depends on, what depends on it is kept. Called when the resource
+	// is loaded again, it records its dependencies anew.
+	void RemoveDependencies(const ResourceId& dependent);
+	void Clear();
+
+	// The changed resources followed by everything that depends on them, directly or not
+	std::vector<ResourceId> GetAffected(const std::vector<ResourceId>& changed) const;
+	const std::unordered_set<ResourceId>* GetDependencies(const ResourceId& dependent) const;
+
+private:
+	typedef std::unordered_map<ResourceId, std::unordered_set<ResourceId> > EdgeMap;
+
+	EdgeMap m_Dependencies;		// dependent -> what it was built from
+	EdgeMap m_Dependents;		// the same edges the other way around
+};
@@ -0,0 +1,136 @@
+#include "ResourceId.h"
+#include "boost/thread/shared_mutex.hpp"
+#include "boost/thread/locks.hpp"
+#include <cctype>
+
+namespace
+{
+	inline char NormalizeChar(char c)
+	{
+		return (c == '/') ? '\\' : (char)std::tolower((unsigned char)c);
+	}
+
+	// Compares an interned name against directory + name normalized on the fly
+	bool MatchesName(const std::string& interned, const char* directory, const char* name)
+	{
+		std::string::const_iterator it = interned.begin();
+		for (const char* part : { directory, name })
+		{
+			for (const char* c = part; *c != 0; ++c, ++it)
+			{
+				if (it == interned.end() || *it != NormalizeChar(*c))
+					return false;
+			}
+		}
+		return it == interned.end();
+	}
+
+	// Names are kept for the lifetime of the process, ids only ever point into this table.
+	// Both are function statics so ids can be built during static initialization.
+	struct InternTable
+	{
+		boost::shared_mutex m_Mutex;
+		std::unordered_multimap<uint64_t, unique_ptr<std::string> > m_Names;
+	};
+
+	InternTable& GetInternTable()
+	{
+		static InternTable s_Table;
+		return s_Table;
+	}
+
+	const std::string& GetEmptyName()
+	{
+		static const std::string s_EmptyName;
+		return s_EmptyName;
+	}
+}
+
+ResourceId::ResourceId()
+	: m_pName(&GetEmptyName()),
+	m_Hash(HASH_SEED)
+{
+
+}
+
+ResourceId::ResourceId(const std::string& name)
+{
+	Intern("", name.c_str());
+}
+
+ResourceId::ResourceId(const char* name)
+{
+	Intern("", name);
+}
+
+ResourceId::ResourceId(const char* directory, const char* name)
+{
+	Intern(directory, name);
+}
+
+std::string ResourceId::Normalize(const std::string& name)
+{
+	std::string normalized = name;
+	for (std::string::iterator it = normalized.begin(); it != normalized.end(); ++it)
+	{
+		*it = NormalizeChar(*it);
+	}
+	return normalized;
+}
+
+uint64_t ResourceId::Hash(const char* name, uint64_t seed)
+{
+	// FNV-1a, matches Utility::HashString64 over the normalized name
+	uint64_t hash = seed;
+	for (const char* c = name; *c != 0; ++c)
+	{
+		hash ^= (uint8_t)NormalizeChar(*c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void ResourceId::Intern(const char* directory, const char* name)
+{
+	m_Hash = Hash(name, Hash(directory));
+	if (*directory == 0 && *name == 0)
+	{
+		m_pName = &GetEmptyName();
+		return;
+	}
+
+	InternTable& table = GetInternTable();
+	{
+		boost::shared_lock<boost::shared_mutex> lock(table.m_Mutex);
+		auto range = table.m_Names.equal_range(m_Hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (MatchesName(*it->second, directory, name))
+			{
+				m_pName = it->second.get();
+				return;
+			}
+		}
+	}
+
+	// First time this name is seen. Another thread may have added it since the lookup above.
+	boost::unique_lock<boost::shared_mutex> lock(table.m_Mutex);
+	auto range = table.m_Names.equal_range(m_Hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (MatchesName(*it->second, directory, name))
+		{
+			m_pName = it->second.get();
+			return;
+		}
+	}
+
+	if (range.first != range.second)
+	{
+		DEBUG_WARNING("Resource name hash collision: " + std::string(directory) + name);
+	}
+
+	unique_ptr<std::string> pName(DEBUG_NEW std::string(Normalize(std::string(directory) + name)));
+	m_pName = pName.get();
+	table.m_Names.insert(std::make_pair(m_Hash, std::move(pName)));
+}
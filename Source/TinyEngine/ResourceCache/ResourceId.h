@@ -0,0 +1,48 @@
+#pragma once
+#include "../TinyEngineBase.h"
+
+// Interned resource name. The name is normalized (lower case, '\' separators) and hashed once,
+// every copy after that is a pointer and a hash, so comparing ids and probing hash maps with
+// them never touches the string. Ids of names that were seen before are built without allocating.
+//
+// The hash is the 64 bit FNV-1a of the normalized name, the same value the asset packs store.
+class ResourceId
+{
+public:
+	ResourceId();
+	ResourceId(const std::string& name);
+	ResourceId(const char* name);
+	// Same as ResourceId(directory + name) without building the joined string
+	ResourceId(const char* directory, const char* name);
+
+	const std::string& GetName() const { return *m_pName; }
+	uint64_t GetHash() const { return m_Hash; }
+	bool IsEmpty() const { return m_pName->empty(); }
+
+	// Interned names are unique, so equal ids share the same string
+	bool operator==(const ResourceId& other) const { return m_pName == other.m_pName; }
+	bool operator!=(const ResourceId& other) const { return m_pName != other.m_pName; }
+
+	static std::string Normalize(const std::string& name);
+	// Hash of the normalized name, computed on the fly. Pass the result of a previous call
+	// as seed to continue hashing where it left off.
+	static uint64_t Hash(const char* name, uint64_t seed = HASH_SEED);
+	static uint64_t Hash(const std::string& name) { return Hash(name.c_str()); }
+
+	static const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+private:
+	void Intern(const char* directory, const char* name);
+
+	const std::string* m_pName;
+	uint64_t m_Hash;
+};
+
+namespace std
+{
+	template <>
+	struct hash<ResourceId>
+	{
+		size_t operator()(const ResourceId& id) const { return (size_t)id.GetHash(); }
+	};
+}
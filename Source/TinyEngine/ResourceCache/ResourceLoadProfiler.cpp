@@ -0,0 +1,205 @@
+#include "ResourceLoadProfiler.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+	const char* GROUPING_NAMES[] = { "loader", "file", "callSite" };
+
+	std::string EscapeCsv(const std::string& text)
+	{
+		if (text.find_first_of(",\"\n") == std::string::npos)
+			return text;
+
+		std::string escaped = "\"";
+		for (char c : text)
+		{
+			escaped += c;
+			if (c == '"')
+			{
+				escaped += '"';
+			}
+		}
+		return escaped + "\"";
+	}
+
+	std::string EscapeJson(const std::string& text)
+	{
+		// Resource names are full of backslashes
+		std::string escaped = "\"";
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+				escaped += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				char code[8];
+				std::snprintf(code, sizeof(code), "\\u%04x", (unsigned)c);
+				escaped += code;
+			}
+			else
+			{
+				escaped += c;
+			}
+		}
+		return escaped + "\"";
+	}
+
+	double Milliseconds(double seconds)
+	{
+		return seconds * 1000.0;
+	}
+}
+
+void ResourceLoadProfiler::Add(const ResourceLoadRecord& record)
+{
+	m_LoadCount++;
+	Accumulate(m_ByLoader, record.m_Loader, record);
+	Accumulate(m_ByFile, record.m_Name, record);
+	Accumulate(m_ByCallSite, record.m_CallSite, record);
+}
+
+void ResourceLoadProfiler::Clear()
+{
+	m_ByLoader.clear();
+	m_ByFile.clear();
+	m_ByCallSite.clear();
+	m_LoadCount = 0;
+}
+
+void ResourceLoadProfiler::Accumulate(TotalsMap& totals, const std::string& key, const ResourceLoadRecord& record)
+{
+	ResourceLoadTotals& total = totals[key];
+	if (total.m_Loads == 0)
+	{
+		total.m_Key = key;
+		total.m_Loader = record.m_Loader;
+		total.m_CallSite = record.m_CallSite;
+	}
+
+	total.m_Loads++;
+	total.m_Failures += record.m_IsLoaded ? 0 : 1;
+	total.m_StoredBytes += record.m_StoredBytes;
+	total.m_RawBytes += record.m_RawBytes;
+	total.m_DecodedBytes += record.m_DecodedBytes;
+	total.m_ReadSeconds += record.m_ReadSeconds;
+	total.m_InflateSeconds += record.m_InflateSeconds;
+	total.m_DecodeSeconds += record.m_DecodeSeconds;
+	total.m_TotalSeconds += record.m_TotalSeconds;
+	total.m_MaxSeconds = std::max(total.m_MaxSeconds, record.m_TotalSeconds);
+}
+
+std::vector<ResourceLoadTotals> ResourceLoadProfiler::GetTotals(ResourceLoadGrouping grouping) const
+{
+	const TotalsMap& totals = (grouping == ResourceLoads_ByLoader) ? m_ByLoader : (grouping == ResourceLoads_ByFile) ? m_ByFile : m_ByCallSite;
+	std::vector<ResourceLoadTotals> sorted;
+	sorted.reserve(totals.size());
+	for (const auto& total : totals)
+	{
+		sorted.push_back(total.second);
+	}
+
+	std::sort(sorted.begin(), sorted.end(), [](const ResourceLoadTotals& a, const ResourceLoadTotals& b)
+	{
+		return (a.m_TotalSeconds != b.m_TotalSeconds) ? a.m_TotalSeconds > b.m_TotalSeconds : a.m_Key < b.m_Key;
+	});
+	return sorted;
+}
+
+std::string ResourceLoadProfiler::GetReport(bool isJson) const
+{
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(3);
+	if (isJson)
+	{
+		report << "{\n\t\"loads\": " << m_LoadCount;
+	}
+	else
+	{
+		report << "grouping,key,loader,callSite,loads,failures,storedBytes,rawBytes,decodedBytes,readMs,inflateMs,decodeMs,totalMs,maxMs\n";
+	}
+
+	const ResourceLoadGrouping groupings[] = { ResourceLoads_ByLoader, ResourceLoads_ByFile, ResourceLoads_ByCallSite };
+	for (ResourceLoadGrouping grouping : groupings)
+	{
+		std::vector<ResourceLoadTotals> totals = GetTotals(grouping);
+		if (isJson)
+		{
+			report << ",\n\t\"" << GROUPING_NAMES[grouping] << "\": [";
+		}
+
+		for (size_t i = 0; i < totals.size(); ++i)
+		{
+			const ResourceLoadTotals& total = totals[i];
+			if (isJson)
+			{
+				report << ((i == 0) ? "\n" : ",\n") << "\t\t{ \"key\": " << EscapeJson(total.m_Key);
+				if (grouping == ResourceLoads_ByFile)
+				{
+					report << ", \"loader\": " << EscapeJson(total.m_Loader) << ", \"callSite\": " << EscapeJson(total.m_CallSite);
+				}
+				report << ", \"loads\": " << total.m_Loads << ", \"failures\": " << total.m_Failures
+					<< ", \"storedBytes\": " << total.m_StoredBytes << ", \"rawBytes\": " << total.m_RawBytes << ", \"decodedBytes\": " << total.m_DecodedBytes
+					<< ", \"readMs\": " << Milliseconds(total.m_ReadSeconds) << ", \"inflateMs\": " << Milliseconds(total.m_InflateSeconds)
+					<< ", \"decodeMs\": " << Milliseconds(total.m_DecodeSeconds) << ", \"totalMs\": " << Milliseconds(total.m_TotalSeconds)
+					<< ", \"maxMs\": " << Milliseconds(total.m_MaxSeconds) << " }";
+			}
+			else
+			{
+				bool isFile = (grouping == ResourceLoads_ByFile);
+				report << GROUPING_NAMES[grouping] << "," << EscapeCsv(total.m_Key) << ","
+					<< (isFile ? EscapeCsv(total.m_Loader) : "") << "," << (isFile ? EscapeCsv(total.m_CallSite) : "") << ","
+					<< total.m_Loads << "," << total.m_Failures << ","
+					<< total.m_StoredBytes << "," << total.m_RawBytes << "," << total.m_DecodedBytes << ","
+					<< Milliseconds(total.m_ReadSeconds) << "," << Milliseconds(total.m_InflateSeconds) << ","
+					<< Milliseconds(total.m_DecodeSeconds) << "," << Milliseconds(total.m_TotalSeconds) << ","
+					<< Milliseconds(total.m_MaxSeconds) << "\n";
+			}
+		}
+
+		if (isJson)
+		{
+			report << (totals.empty() ? "]" : "\n\t]");
+		}
+	}
+
+	if (isJson)
+	{
+		report << "\n}\n";
+	}
+	return report.str();
+}
+
+bool ResourceLoadProfiler::WriteReport(const std::string& fileName) const
+{
+	std::string extension = fileName.substr(std::min(fileName.rfind('.'), fileName.length()));
+	std::transform(extension.begin(), extension.end(), extension.begin(), (int(*)(int)) std::tolower);
+
+	std::ofstream file(fileName.c_str(), std::ios::out | std::ios::trunc);
+	file << GetReport(extension == ".json");
+	file.close();
+	if (file.fail())
+	{
+		DEBUG_WARNING("Can't write the resource load profile: " + fileName);
+		return false;
+	}
+	return true;
+}
+
+std::string ResourceLoadProfiler::GetSummary() const
+{
+	std::ostringstream summary;
+	summary << std::fixed << std::setprecision(1) << "Resource loads: " << m_LoadCount;
+	for (const auto& total : GetTotals(ResourceLoads_ByLoader))
+	{
+		summary << "\n  " << total.m_Key << ": " << total.m_Loads << " loads, " << total.m_Failures << " failed, "
+			<< total.m_StoredBytes / 1024 << " KB read, " << total.m_DecodedBytes / 1024 << " KB decoded, "
+			<< Milliseconds(total.m_ReadSeconds) << " ms reading, " << Milliseconds(total.m_InflateSeconds) << " ms inflating, "
+			<< Milliseconds(total.m_DecodeSeconds) << " ms decoding, " << Milliseconds(total.m_TotalSeconds) << " ms in all";
+	}
+	return summary.str();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include <chrono>
+
+// One load as it went through the cache. The decode time of a resource includes the loads its
+// loader starts, a material's textures for one, those are recorded on their own as well.
+struct ResourceLoadRecord
+{
+	ResourceLoadRecord()
+		: m_StoredBytes(0), m_RawBytes(0), m_DecodedBytes(0),
+		m_ReadSeconds(0.0), m_InflateSeconds(0.0), m_DecodeSeconds(0.0), m_TotalSeconds(0.0), m_IsLoaded(false) {}
+
+	std::string m_Name;
+	std::string m_Loader;		// the loader's pattern
+	std::string m_CallSite;		// what asked for it, empty when nobody said
+	std::chrono::steady_clock::time_point m_Requested;
+	uint64_t m_StoredBytes;		// read from the resource file, compressed when the entry is
+	uint64_t m_RawBytes;		// handed to the loader
+	uint64_t m_DecodedBytes;	// what the loader built, its buffer and extra data together
+	double m_ReadSeconds;
+	double m_InflateSeconds;	// the resource file's or the compressed tier's
+	double m_DecodeSeconds;		// the loader's VGetLoadedResourceSize and VLoadResource
+	double m_TotalSeconds;		// from the request to the handle, waiting for a worker included
+	bool m_IsLoaded;
+};
+
+// The loads of one loader, file or call site added up
+struct ResourceLoadTotals
+{
+	ResourceLoadTotals()
+		: m_Loads(0), m_Failures(0), m_StoredBytes(0), m_RawBytes(0), m_DecodedBytes(0),
+		m_ReadSeconds(0.0), m_InflateSeconds(0.0), m_DecodeSeconds(0.0), m_TotalSeconds(0.0), m_MaxSeconds(0.0) {}
+
+	std::string m_Key;
+	std::string m_Loader;		// the loader and call site of the first load, when grouped by file
+	std::string m_CallSite;
+	uint32_t m_Loads;
+	uint32_t m_Failures;
+	uint64_t m_StoredBytes;
+	uint64_t m_RawBytes;
+	uint64_t m_DecodedBytes;
+	double m_ReadSeconds;
+	double m_InflateSeconds;
+	double m_DecodeSeconds;
+	double m_TotalSeconds;
+	double m_MaxSeconds;		// of the slowest single load
+};
+
+enum ResourceLoadGrouping
+{
+	ResourceLoads_ByLoader,
+	ResourceLoads_ByFile,
+	ResourceLoads_ByCallSite,
+};
+
+// Where the time spent loading resources goes, per loader, per file and per call site, to find
+// the assets and loaders worth optimizing. Main thread only, the cache adds finished loads.
+class ResourceLoadProfiler : public boost::noncopyable
+{
+public:
+	ResourceLoadProfiler() : m_LoadCount(0) {}
+
+	void Add(const ResourceLoadRecord& record);
+	void Clear();
+	uint32_t GetLoadCount() const { return m_LoadCount; }
+
+	// Slowest first, by the loads' total time
+	std::vector<ResourceLoadTotals> GetTotals(ResourceLoadGrouping grouping) const;
+	// All three groupings, as JSON or as CSV with a column naming the grouping
+	std::string GetReport(bool isJson) const;
+	// JSON when the name ends in .json, CSV otherwise
+	bool WriteReport(const std::string& fileName) const;
+	// One line per loader, for the log
+	std::string GetSummary() const;
+
+private:
+	typedef std::unordered_map<std::string, ResourceLoadTotals> TotalsMap;
+
+	static void Accumulate(TotalsMap& totals, const std::string& key, const ResourceLoadRecord& record);
+
+	TotalsMap m_ByLoader;
+	TotalsMap m_ByFile;
+	TotalsMap m_ByCallSite;
+	uint32_t m_LoadCount;
+};
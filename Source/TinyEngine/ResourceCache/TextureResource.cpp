@@ -2,7 +2,8 @@
 #include "../AppFramework/BaseGameApp.h"
 
 D3D11TextureResourceExtraData::D3D11TextureResourceExtraData()
-	: m_pTexture(nullptr)
+	: m_pTexture(nullptr),
+	m_Size(0)
 {
 }
 
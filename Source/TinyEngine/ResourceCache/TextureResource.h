@@ -10,10 +10,12 @@ public:
 	virtual ~D3D11TextureResourceExtraData();
 
 	virtual std::string VToString() { return "D3D11TextureResourceExtraData"; }
+	virtual uint64_t VGetSize() { return m_Size; }
 	ID3D11ShaderResourceView* GetTexture() const { return m_pTexture; }
 
 protected:
 	ID3D11ShaderResourceView *m_pTexture;
+	uint64_t m_Size;		// every mip of every array slice, filled in by the renderer
 };
 
 class TextureResourceLoader : public IResourceLoader
@@ -23,6 +25,7 @@ public:
 	virtual bool VDiscardRawBufferAfterLoad() override { return true; }
 	virtual uint32_t VGetLoadedResourceSize(char *rawBuffer, uint32_t rawSize) override { return 0; }
 	virtual bool VLoadResource(char *rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle) override { return true; }
+	virtual std::string VGetCategory() override { return "texture"; }
 };
 
 class DdsResourceLoader : public TextureResourceLoader
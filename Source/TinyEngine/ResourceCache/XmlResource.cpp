@@ -4,9 +4,40 @@
 bool XmlResourceExtraData::ParseXml(const char* pRawBuffer, uint32_t rawSize)
 {
 	tinyxml2::XMLError error = m_xmlDocument.Parse(pRawBuffer, rawSize);
+
+	// The document keeps its own copy of the text, the nodes point into it
+	m_Size = sizeof(tinyxml2::XMLDocument) + rawSize + 1;
+	for (const tinyxml2::XMLNode* pNode = m_xmlDocument.FirstChild(); pNode; pNode = pNode->NextSibling())
+	{
+		m_Size += GetNodeSize(pNode);
+	}
+
 	return error == tinyxml2::XML_SUCCESS;
 }
 
+uint64_t XmlResourceExtraData::GetNodeSize(const tinyxml2::XMLNode* pNode)
+{
+	uint64_t size = sizeof(tinyxml2::XMLComment);
+	if (const tinyxml2::XMLElement* pElement = pNode->ToElement())
+	{
+		size = sizeof(tinyxml2::XMLElement);
+		for (const tinyxml2::XMLAttribute* pAttribute = pElement->FirstAttribute(); pAttribute; pAttribute = pAttribute->Next())
+		{
+			size += sizeof(tinyxml2::XMLAttribute);
+		}
+	}
+	else if (pNode->ToText() != nullptr)
+	{
+		size = sizeof(tinyxml2::XMLText);
+	}
+
+	for (const tinyxml2::XMLNode* pChild = pNode->FirstChild(); pChild; pChild = pChild->NextSibling())
+	{
+		size += GetNodeSize(pChild);
+	}
+	return size;
+}
+
 bool XmlResourceLoader::VLoadResource(char *rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle)
 {
 	if (rawBuffer == nullptr || rawSize == 0)
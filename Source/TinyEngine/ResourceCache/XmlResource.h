@@ -4,12 +4,18 @@
 class XmlResourceExtraData : public IResourceExtraData
 {
 public:
+	XmlResourceExtraData() : m_Size(0) {}
+
 	virtual std::string VToString() { return "XmlResourceExtraData"; }
+	virtual uint64_t VGetSize() { return m_Size; }
 	bool ParseXml(const char* pRawBuffer, uint32_t rawSize);
 	tinyxml2::XMLElement* GetRoot(void) { return m_xmlDocument.RootElement(); }
 
 private:
+	static uint64_t GetNodeSize(const tinyxml2::XMLNode* pNode);
+
 	tinyxml2::XMLDocument m_xmlDocument;
+	uint64_t m_Size;
 };
 
 
@@ -20,7 +26,9 @@ public:
 	virtual bool VDiscardRawBufferAfterLoad() { return true; }
 	virtual uint32_t VGetLoadedResourceSize(char *rawBuffer, uint32_t rawSize) { return rawSize; }
 	virtual bool VLoadResource(char *rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle);
+	virtual bool VIsThreadSafe() { return true; }
 	virtual std::string VGetPattern() { return "*.xml"; }
+	virtual std::string VGetCategory() { return "xml"; }
 
 	static tinyxml2::XMLElement* LoadAndReturnRootXmlElement(const char* resourceString);
 };
@@ -6,9 +6,10 @@
 // --------------------------------------------------------------------------
 // Basic types.
 // --------------------------------------------------------------------------
-typedef unsigned long dword;
-typedef unsigned short word;
-typedef unsigned char byte;
+typedef uint32_t dword;
+typedef uint16_t word;
+typedef uint8_t byte;
+typedef uint64_t qword;
 
 // --------------------------------------------------------------------------
 // ZIP file structures. Note these have to be packed.
@@ -56,6 +57,42 @@ struct ZipFile::TZipDirHeader
   word    cmntLen;
 };
 
+// --------------------------------------------------------------------------
+// struct ZipFile::TZip64DirLocator				- APPNOTE 4.3.15
+// --------------------------------------------------------------------------
+struct ZipFile::TZip64DirLocator
+{
+  enum
+  {
+	SIGNATURE = 0x07064b50
+  };
+  dword   sig;
+  dword   nStartDisk;
+  qword   dirHeaderOffset;  // Where the TZip64DirHeader starts.
+  dword   totalDisks;
+};
+
+// --------------------------------------------------------------------------
+// struct ZipFile::TZip64DirHeader				- APPNOTE 4.3.14
+// --------------------------------------------------------------------------
+struct ZipFile::TZip64DirHeader
+{
+  enum
+  {
+	SIGNATURE = 0x06064b50
+  };
+  dword   sig;
+  qword   recordSize;
+  word    verMade;
+  word    verNeeded;
+  dword   nDisk;
+  dword   nStartDisk;
+  qword   nDirEntries;
+  qword   totalDirEntries;
+  qword   dirSize;
+  qword   dirOffset;
+};
+
 // --------------------------------------------------------------------------
 // struct ZipFile::TZipDirFileHeader					- Chapter 8, page 215
 // --------------------------------------------------------------------------
@@ -90,59 +127,99 @@ struct ZipFile::TZipDirFileHeader
 
 #pragma pack()
 
+ZipFile::ZipFile()
+  : m_pMappedData(NULL),
+  m_FileSize(0),
+  m_pDirData(NULL),
+  m_nEntries(0)
+{
+}
+
 // --------------------------------------------------------------------------
 // Function:      Init
 // Purpose:       Initialize the object and read the zip file directory.
-// Parameters:    A stdio FILE* used for reading.
+// Parameters:    The archive file name and how to read it.
 // --------------------------------------------------------------------------
-bool ZipFile::Init(const std::wstring &resFileName)
+bool ZipFile::Init(const std::wstring &resFileName, FileReaderType readerType)
 {
   End();
 
-  _wfopen_s(&m_pFile, resFileName.c_str(), _T("rb"));
-  if (!m_pFile)
+  // Map the whole archive if we can, otherwise fall back to positional reads.
+  if (!OpenArchive(resFileName, readerType))
 	return false;
 
-  // Assuming no extra comment at the end, read the whole end record.
+  // The end record sits in front of a comment of up to 64k.
+  uint64_t dhOffset = 0;
   TZipDirHeader dh;
+  if (!FindDirHeader(dhOffset, dh))
+	return false;
 
-  fseek(m_pFile, -(int)sizeof(dh), SEEK_END);
-  long dhOffset = ftell(m_pFile);
-  memset(&dh, 0, sizeof(dh));
-  fread(&dh, sizeof(dh), 1, m_pFile);
+  uint64_t nDirEntries = dh.nDirEntries;
+  uint64_t dirSize = dh.dirSize;
+  uint64_t dirEnd = dhOffset;
+
+  // Archives past 4 GB or 65535 files keep the real values in the ZIP64 end record,
+  // its locator sits right in front of the classic one.
+  TZip64DirLocator locator;
+  memset(&locator, 0, sizeof(locator));
+  if (dhOffset >= sizeof(locator) &&
+	ReadAt(dhOffset - sizeof(locator), &locator, sizeof(locator)) &&
+	locator.sig == TZip64DirLocator::SIGNATURE)
+  {
+	TZip64DirHeader dh64;
+	memset(&dh64, 0, sizeof(dh64));
+	if (locator.dirHeaderOffset >= dhOffset ||
+	  !ReadAt(locator.dirHeaderOffset, &dh64, sizeof(dh64)) ||
+	  dh64.sig != TZip64DirHeader::SIGNATURE)
+	  return false;
+
+	nDirEntries = dh64.nDirEntries;
+	dirSize = dh64.dirSize;
+	dirEnd = locator.dirHeaderOffset;
+  }
 
   // Check
-  if (dh.sig != TZipDirHeader::SIGNATURE)
+  if (dirSize > dirEnd || dirSize > SIZE_MAX || nDirEntries > INT_MAX ||
+	nDirEntries * sizeof(TZipDirFileHeader) > dirSize)
 	return false;
 
-  // Go to the beginning of the directory.
-  fseek(m_pFile, dhOffset - dh.dirSize, SEEK_SET);
-
   // Allocate the data buffer, and read the whole thing.
-  m_pDirData = DEBUG_NEW char[dh.dirSize + dh.nDirEntries*sizeof(*m_papDir)];
+  m_pDirData = DEBUG_NEW char[(size_t)dirSize];
   if (!m_pDirData)
 	return false;
-  memset(m_pDirData, 0, dh.dirSize + dh.nDirEntries*sizeof(*m_papDir));
-  fread(m_pDirData, dh.dirSize, 1, m_pFile);
+  if (!ReadAt(dirEnd - dirSize, m_pDirData, (size_t)dirSize))
+  {
+	SAFE_DELETE_ARRAY(m_pDirData);
+	return false;
+  }
 
   // Now process each entry.
   char *pfh = m_pDirData;
-  m_papDir = (const TZipDirFileHeader **)(m_pDirData + dh.dirSize);
+  const char *pDirEnd = m_pDirData + dirSize;
+  m_Entries.resize((size_t)nDirEntries);
 
   bool success = true;
 
-  for (int i = 0; i < dh.nDirEntries && success; i++)
+  for (int i = 0; i < (int)nDirEntries && success; i++)
   {
 	TZipDirFileHeader &fh = *(TZipDirFileHeader*)pfh;
 
-	// Store the address of nth file for quicker access.
-	m_papDir[i] = &fh;
-
 	// Check the directory entry integrity.
-	if (fh.sig != TZipDirFileHeader::SIGNATURE)
+	if (pfh + sizeof(fh) > pDirEnd || fh.sig != TZipDirFileHeader::SIGNATURE ||
+	  pfh + sizeof(fh) + fh.fnameLen + fh.xtraLen + fh.cmntLen > pDirEnd ||
+	  fh.fnameLen >= _MAX_PATH)
 	  success = false;
 	else
 	{
+	  // Store the address of nth file for quicker access.
+	  TZipEntry &entry = m_Entries[i];
+	  entry.pHeader = &fh;
+	  entry.cSize = fh.cSize;
+	  entry.ucSize = fh.ucSize;
+	  entry.hdrOffset = fh.hdrOffset;
+	  entry.extentSize = 0;
+	  ReadZip64Extra(fh, entry);
+
 	  pfh += sizeof(fh);
 
 	  // Convert UNIX slashes to DOS backlashes.
@@ -153,9 +230,15 @@ bool ZipFile::Init(const std::wstring &resFileName)
 	  char fileName[_MAX_PATH];
 	  memcpy(fileName, pfh, fh.fnameLen);
 	  fileName[fh.fnameLen]=0;
-	  _strlwr_s(fileName, _MAX_PATH);
-	  std::string spath = fileName;
-	  m_ZipContentsMap[spath] = i;
+	  std::pair<ZipContentsMap::iterator, bool> inserted = m_ZipContentsMap.insert(std::make_pair(ResourceId::Hash(fileName), i));
+	  if (!inserted.second)
+	  {
+		// The same name stored twice, the later copy wins. Two names with one hash, the first one stays.
+		if (IsEntryNamed(inserted.first->second, ResourceId::Normalize(fileName)))
+		  inserted.first->second = i;
+		else
+		  DEBUG_WARNING(std::string("Name hash collision in zip, can't find ") + fileName);
+	  }
 
 	  // Skip name, extra and comment fields.
 	  pfh += fh.fnameLen + fh.xtraLen + fh.cmntLen;
@@ -163,27 +246,140 @@ bool ZipFile::Init(const std::wstring &resFileName)
   }
   if (!success)
   {
+	m_ZipContentsMap.clear();
+	m_Entries.clear();
 	SAFE_DELETE_ARRAY(m_pDirData);
   }
   else
   {
-	m_nEntries = dh.nDirEntries;
+	m_nEntries = (int)nDirEntries;
+
+	// Entries are stored back to back, each one ends where the next one starts.
+	std::vector<int> order(m_nEntries);
+	for (int i = 0; i < m_nEntries; i++)
+	  order[i] = i;
+	std::sort(order.begin(), order.end(), [this](int a, int b) { return m_Entries[a].hdrOffset < m_Entries[b].hdrOffset; });
+
+	uint64_t dirStart = dirEnd - dirSize;
+	for (size_t k = 0; k < order.size(); k++)
+	{
+	  TZipEntry &entry = m_Entries[order[k]];
+	  uint64_t extentEnd = (k + 1 < order.size()) ? m_Entries[order[k + 1]].hdrOffset : dirStart;
+	  entry.extentSize = (extentEnd > entry.hdrOffset) ? extentEnd - entry.hdrOffset : 0;
+	}
   }
 
   return success;
 }
 
+// --------------------------------------------------------------------------
+// Function:      FindDirHeader
+// Purpose:       Scan backwards from the end of the archive for the end record
+// Parameters:    The resulting offset and record
+// --------------------------------------------------------------------------
+bool ZipFile::FindDirHeader(uint64_t &dhOffset, TZipDirHeader &dh) const
+{
+  if (m_FileSize < sizeof(dh))
+	return false;
+
+  // Only the tail can hold the record, read it in one go.
+  size_t tailSize = (size_t)std::min<uint64_t>(m_FileSize, sizeof(dh) + 0xffff);
+  uint64_t tailOffset = m_FileSize - tailSize;
+  std::vector<char> tail(tailSize);
+  if (!ReadAt(tailOffset, &tail[0], tailSize))
+	return false;
+
+  // The comment can contain the signature too, so also require it to end at the end of the file.
+  for (size_t pos = tailSize - sizeof(dh) + 1; pos-- > 0; )
+  {
+	memcpy(&dh, &tail[pos], sizeof(dh));
+	if (dh.sig == TZipDirHeader::SIGNATURE && pos + sizeof(dh) + dh.cmntLen == tailSize)
+	{
+	  dhOffset = tailOffset + pos;
+	  return true;
+	}
+  }
+
+  return false;
+}
+
+// --------------------------------------------------------------------------
+// Function:      ReadZip64Extra
+// Purpose:       Pick up the 64 bit sizes and offset of a ZIP64 directory entry
+// Parameters:    The directory entry and the entry to update
+// --------------------------------------------------------------------------
+void ZipFile::ReadZip64Extra(const TZipDirFileHeader &fh, TZipEntry &entry) const
+{
+  const char *pExtra = fh.GetExtra();
+  const char *pExtraEnd = pExtra + fh.xtraLen;
+
+  while (pExtra + 2 * sizeof(word) <= pExtraEnd)
+  {
+	word headerId, dataSize;
+	memcpy(&headerId, pExtra, sizeof(word));
+	memcpy(&dataSize, pExtra + sizeof(word), sizeof(word));
+	const char *pData = pExtra + 2 * sizeof(word);
+	if (pData + dataSize > pExtraEnd)
+	  return;
+
+	if (headerId == 0x0001)
+	{
+	  // Only the fields saturated in the fixed header are present, in this order.
+	  const char *pField = pData;
+	  const char *pFieldEnd = pData + dataSize;
+	  uint64_t *fields[] = { &entry.ucSize, &entry.cSize, &entry.hdrOffset };
+	  dword fixed[] = { fh.ucSize, fh.cSize, fh.hdrOffset };
+	  for (int f = 0; f < 3; ++f)
+	  {
+		if (fixed[f] != 0xffffffff)
+		  continue;
+		if (pField + sizeof(qword) > pFieldEnd)
+		  return;
+		memcpy(fields[f], pField, sizeof(qword));
+		pField += sizeof(qword);
+	  }
+	  return;
+	}
+
+	pExtra = pData + dataSize;
+  }
+}
+
 int ZipFile::Find(const std::string &path) const
 {
-	std::string lowerCase = path;
-	std::transform(lowerCase.begin(), lowerCase.end(), lowerCase.begin(), (int(*)(int)) std::tolower);
-	ZipContentsMap::const_iterator i = m_ZipContentsMap.find(lowerCase);
-	if (i==m_ZipContentsMap.end())
+	return Find(ResourceId::Hash(path), ResourceId::Normalize(path));
+}
+
+int ZipFile::Find(const ResourceId &id) const
+{
+	return Find(id.GetHash(), id.GetName());
+}
+
+int ZipFile::Find(uint64_t resourceHash, const std::string &normalizedPath) const
+{
+	ZipContentsMap::const_iterator i = m_ZipContentsMap.find(resourceHash);
+	if (i==m_ZipContentsMap.end() || !IsEntryNamed(i->second, normalizedPath))
 		return -1;
 
 	return i->second;
 }
 
+bool ZipFile::IsEntryNamed(int i, const std::string &normalizedPath) const
+{
+	// Init turned the separators around already, only the case is left to normalize
+	const TZipDirFileHeader &fh = *m_Entries[i].pHeader;
+	if (fh.fnameLen != normalizedPath.length())
+		return false;
+
+	const char *pName = fh.GetName();
+	for (int j = 0; j < fh.fnameLen; j++)
+	{
+		if ((char)std::tolower((unsigned char)pName[j]) != normalizedPath[j])
+			return false;
+	}
+	return true;
+}
+
 
 
 // --------------------------------------------------------------------------
@@ -194,8 +390,111 @@ int ZipFile::Find(const std::string &path) const
 void ZipFile::End()
 {
 	m_ZipContentsMap.clear();
+	m_Entries.clear();
 	SAFE_DELETE_ARRAY(m_pDirData);
 	m_nEntries = 0;
+
+	m_pMappedData = NULL;
+	m_pReader.reset();
+	m_FileSize = 0;
+}
+
+// --------------------------------------------------------------------------
+// Function:      OpenArchive
+// Purpose:       Open the archive and, unless told otherwise, map it read
+//                only into the address space
+// Parameters:    The archive file name and how to read it
+// --------------------------------------------------------------------------
+bool ZipFile::OpenArchive(const std::wstring &resFileName, FileReaderType readerType)
+{
+	m_pReader = CreateFileReader(readerType);
+	if (!m_pReader->VOpen(resFileName) || m_pReader->VGetSize() == 0)
+	{
+		End();
+		return false;
+	}
+
+	// Mapping can fail for very large archives in a 32 bit process, the reader still works then.
+	m_FileSize = m_pReader->VGetSize();
+	m_pMappedData = m_pReader->VGetMappedData();
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Function:      ReadAt
+// Purpose:       Copy bytes from an absolute archive offset. Never touches a
+//                shared file position, so any number of threads may call it.
+// Parameters:    The offset, the destination buffer and the byte count
+// --------------------------------------------------------------------------
+bool ZipFile::ReadAt(uint64_t offset, void *pBuf, size_t size) const
+{
+	if (offset > m_FileSize || size > m_FileSize - offset)
+		return false;
+
+	if (m_pMappedData)
+	{
+		memcpy(pBuf, m_pMappedData + offset, size);
+		return true;
+	}
+
+	return m_pReader->VRead(offset, pBuf, size);
+}
+
+// --------------------------------------------------------------------------
+// Function:      ReadRawBatch
+// Purpose:       Read several ranges of the archive with all of them in
+//                flight at once, as far as the reader allows
+// Parameters:    The reads, each one is marked done when it succeeded
+// --------------------------------------------------------------------------
+bool ZipFile::ReadRawBatch(std::vector<FileReadRequest> &requests) const
+{
+	if (m_pMappedData)
+	{
+		bool success = true;
+		for (auto &request : requests)
+		{
+			request.m_IsDone = ReadAt(request.m_Offset, request.m_pBuffer, request.m_Size);
+			success = success && request.m_IsDone;
+		}
+		return success;
+	}
+
+	return m_pReader->VReadBatch(requests);
+}
+
+// --------------------------------------------------------------------------
+// Function:      GetFileDataOffset
+// Purpose:       Find where the file data starts, right after its local header
+// Parameters:    The file index and the resulting archive offset
+// --------------------------------------------------------------------------
+bool ZipFile::GetFileDataOffset(int i, uint64_t &dataOffset) const
+{
+	TZipLocalHeader h;
+
+	memset(&h, 0, sizeof(h));
+	if (!ReadAt(m_Entries[i].hdrOffset, &h, sizeof(h)) || h.sig != TZipLocalHeader::SIGNATURE)
+		return false;
+
+	// Skip extra fields
+	dataOffset = m_Entries[i].hdrOffset + sizeof(h) + h.fnameLen + h.xtraLen;
+	return dataOffset <= m_FileSize && m_Entries[i].cSize <= m_FileSize - dataOffset;
+}
+
+// --------------------------------------------------------------------------
+// Function:      GetFileView
+// Purpose:       Return a read only pointer to a stored file inside the mapping
+// Parameters:    The file index
+// --------------------------------------------------------------------------
+const char *ZipFile::GetFileView(int i) const
+{
+	if (!m_pMappedData || i < 0 || i >= m_nEntries || m_Entries[i].pHeader->compression != Z_NO_COMPRESSION)
+		return NULL;
+
+	uint64_t dataOffset = 0;
+	if (!GetFileDataOffset(i, dataOffset))
+		return NULL;
+
+	return m_pMappedData + dataOffset;
 }
 
 // --------------------------------------------------------------------------
@@ -209,8 +508,9 @@ std::string ZipFile::GetFilename(int i)  const
 	if (i >=0 && i < m_nEntries)
 	{
 	  char pszDest[_MAX_PATH];
-	  memcpy(pszDest, m_papDir[i]->GetName(), m_papDir[i]->fnameLen);
-	  pszDest[m_papDir[i]->fnameLen] = '\0';
+	  const TZipDirFileHeader &fh = *m_Entries[i].pHeader;
+	  memcpy(pszDest, fh.GetName(), fh.fnameLen);
+	  pszDest[fh.fnameLen] = '\0';
 	  fileName = pszDest;
 	}
 	return fileName;
@@ -222,12 +522,12 @@ std::string ZipFile::GetFilename(int i)  const
 // Purpose:       Return the length of a file so a buffer can be allocated
 // Parameters:    The file index.
 // --------------------------------------------------------------------------
-int ZipFile::GetFileLen(int i) const
+int64_t ZipFile::GetFileLen(int i) const
 {
   if (i < 0 || i >= m_nEntries)
 	return -1;
   else
-	return m_papDir[i]->ucSize;
+	return (int64_t)m_Entries[i].ucSize;
 }
 
 // --------------------------------------------------------------------------
@@ -235,162 +535,347 @@ int ZipFile::GetFileLen(int i) const
 // Purpose:       Uncompress a complete file
 // Parameters:    The file index and the pre-allocated buffer
 // --------------------------------------------------------------------------
-bool ZipFile::ReadFile(int i, void *pBuf)
+bool ZipFile::ReadFile(int i, void *pBuf) const
 {
   if (pBuf == NULL || i < 0 || i >= m_nEntries)
 	return false;
 
-  // Quick'n dirty read, the whole file at once.
-  // Ungood if the ZIP has huge files inside
+  // Go to the actual file and skip the local header.
+  const TZipEntry &entry = m_Entries[i];
+  if (entry.pHeader->compression == Z_NO_COMPRESSION)
+  {
+	uint64_t dataOffset = 0;
+	if (!GetFileDataOffset(i, dataOffset) || entry.cSize > SIZE_MAX)
+	  return false;
 
-  // Go to the actual file and read the local header.
-  fseek(m_pFile, m_papDir[i]->hdrOffset, SEEK_SET);
-  TZipLocalHeader h;
+	// Simply read in raw stored data.
+	return ReadAt(dataOffset, pBuf, (size_t)entry.cSize);
+  }
 
-  memset(&h, 0, sizeof(h));
-  fread(&h, sizeof(h), 1, m_pFile);
-  if (h.sig != TZipLocalHeader::SIGNATURE)
+  // zlib counts in 32 bits, let the stream feed entries past 4 GB through in pieces.
+  ZipReadStream stream(*this, i);
+  if (!stream.IsOpen())
 	return false;
 
-  // Skip extra fields
-  fseek(m_pFile, h.fnameLen + h.xtraLen, SEEK_CUR);
-
-  if (h.compression == Z_NO_COMPRESSION)
+  char *pDest = (char *)pBuf;
+  while (!stream.IsFinished() && !stream.HasFailed())
   {
-	// Simply read in raw stored data.
-	fread(pBuf, h.cSize, 1, m_pFile);
-	return true;
+	uint64_t remaining = stream.GetSize() - stream.GetPosition();
+	stream.Read(pDest + stream.GetPosition(), (size_t)std::min<uint64_t>(std::max<uint64_t>(remaining, 1), SIZE_MAX));
   }
-  else if (h.compression != Z_DEFLATED)
+
+  return stream.IsFinished();
+}
+
+
+
+// --------------------------------------------------------------------------
+// Function:      ReadLargeFile
+// Purpose:       Uncompress a complete file with callbacks.
+// Parameters:    The file index, the pre-allocated buffer and the progress callback
+// --------------------------------------------------------------------------
+bool ZipFile::ReadLargeFile(int i, void *pBuf, void (*progressCallback)(int, bool &)) const
+{
+  if (pBuf == NULL)
 	return false;
 
-  // Alloc compressed data buffer and read the whole stream
-  char *pcData = DEBUG_NEW char[h.cSize];
-  if (!pcData)
+  ZipReadStream stream(*this, i);
+  if (!stream.IsOpen())
 	return false;
 
-  memset(pcData, 0, h.cSize);
-  fread(pcData, h.cSize, 1, m_pFile);
+  // Inflate 128k at a time straight into the caller's buffer.
+  char *pDest = (char *)pBuf;
+  bool cancel = false;
+  while (!stream.IsFinished() && !cancel)
+  {
+	size_t bytesRead = stream.Read(pDest + stream.GetPosition(), 128 * 1024);
+	if (stream.HasFailed())
+	{
+	  DEBUG_ASSERT(0 && "Something happened.");
+	  return false;
+	}
+
+	if (bytesRead > 0 && progressCallback)
+	  progressCallback(stream.GetProgress(), cancel);
+  }
 
-  bool ret = true;
+  return stream.IsFinished();
+}
 
-  // Setup the inflate stream.
-  z_stream stream;
-  int err;
-
-  stream.next_in = (Bytef*)pcData;
-  stream.avail_in = (uInt)h.cSize;
-  stream.next_out = (Bytef*)pBuf;
-  stream.avail_out = h.ucSize;
-  stream.zalloc = (alloc_func)0;
-  stream.zfree = (free_func)0;
-
-  // Perform inflation. wbits < 0 indicates no zlib header inside the data.
-  err = inflateInit2(&stream, -MAX_WBITS);
-  if (err == Z_OK)
+// --------------------------------------------------------------------------
+// Function:      ReadFileChunked
+// Purpose:       Uncompress a file piece by piece into a sink
+// Parameters:    The file index, the largest chunk to hand out and the sink
+// --------------------------------------------------------------------------
+bool ZipFile::ReadFileChunked(int i, size_t chunkSize, const ZipChunkSink &sink) const
+{
+  if (chunkSize == 0 || !sink)
+	return false;
+
+  ZipReadStream stream(*this, i);
+  if (!stream.IsOpen())
+	return false;
+
+  std::vector<char> chunk(chunkSize);
+  while (!stream.IsFinished())
   {
-	err = inflate(&stream, Z_FINISH);
-	inflateEnd(&stream);
-	if (err == Z_STREAM_END)
-	  err = Z_OK;
-	inflateEnd(&stream);
+	size_t bytesRead = stream.Read(&chunk[0], chunkSize);
+	if (stream.HasFailed())
+	  return false;
+
+	if (bytesRead > 0 && !sink(&chunk[0], bytesRead))
+	  return false;
   }
-  if (err != Z_OK)
-	ret = false;
 
-  delete[] pcData;
-  return ret;
+  return true;
 }
 
+// --------------------------------------------------------------------------
+// Function:      GetFileExtent
+// Purpose:       Where the entry is stored, local header included
+// Parameters:    The file index, the resulting archive offset and size
+// --------------------------------------------------------------------------
+bool ZipFile::GetFileExtent(int i, uint64_t &offset, uint64_t &size) const
+{
+  if (i < 0 || i >= m_nEntries || m_Entries[i].extentSize == 0)
+	return false;
 
+  offset = m_Entries[i].hdrOffset;
+  size = m_Entries[i].extentSize;
+  return true;
+}
 
 // --------------------------------------------------------------------------
-// Function:      ReadLargeFile
-// Purpose:       Uncompress a complete file with callbacks.
-// Parameters:    The file index and the pre-allocated buffer
+// Function:      DecodeFile
+// Purpose:       Uncompress a complete file from its extent already in memory
+// Parameters:    The file index, the extent read with ReadRaw and the pre-allocated buffer
 // --------------------------------------------------------------------------
-bool ZipFile::ReadLargeFile(int i, void *pBuf, void (*progressCallback)(int, bool &))
+bool ZipFile::DecodeFile(int i, const char *pExtent, uint64_t extentSize, void *pBuf) const
 {
-  if (pBuf == NULL || i < 0 || i >= m_nEntries)
+  if (pBuf == NULL || pExtent == NULL || i < 0 || i >= m_nEntries)
 	return false;
 
-  // Quick'n dirty read, the whole file at once.
-  // Ungood if the ZIP has huge files inside
-
-  // Go to the actual file and read the local header.
-  fseek(m_pFile, m_papDir[i]->hdrOffset, SEEK_SET);
   TZipLocalHeader h;
-
-  memset(&h, 0, sizeof(h));
-  fread(&h, sizeof(h), 1, m_pFile);
-  if (h.sig != TZipLocalHeader::SIGNATURE)
+  if (extentSize < sizeof(h))
 	return false;
 
-  // Skip extra fields
-  fseek(m_pFile, h.fnameLen + h.xtraLen, SEEK_CUR);
+  memcpy(&h, pExtent, sizeof(h));
+  uint64_t dataOffset = sizeof(h) + h.fnameLen + h.xtraLen;
+  const TZipEntry &entry = m_Entries[i];
+  if (h.sig != TZipLocalHeader::SIGNATURE || dataOffset > extentSize || entry.cSize > extentSize - dataOffset)
+	return false;
 
-  if (h.compression == Z_NO_COMPRESSION)
+  const char *pSource = pExtent + dataOffset;
+  uint64_t sourceSize = entry.cSize;
+  if (entry.pHeader->compression == Z_NO_COMPRESSION)
   {
-	// Simply read in raw stored data.
-	fread(pBuf, h.cSize, 1, m_pFile);
+	if (sourceSize != entry.ucSize || sourceSize > SIZE_MAX)
+	  return false;
+
+	memcpy(pBuf, pSource, (size_t)sourceSize);
 	return true;
   }
-  else if (h.compression != Z_DEFLATED)
+
+  if (entry.pHeader->compression != Z_DEFLATED)
 	return false;
 
-  // Alloc compressed data buffer and read the whole stream
-  char *pcData = DEBUG_NEW char[h.cSize];
-  if (!pcData)
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
 	return false;
 
-  memset(pcData, 0, h.cSize);
-  fread(pcData, h.cSize, 1, m_pFile);
+  // zlib counts in 32 bits, feed large entries through in pieces.
+  char *pDest = (char *)pBuf;
+  uint64_t destSize = entry.ucSize;
+  int err = Z_OK;
+  while (err == Z_OK)
+  {
+	if (stream.avail_in == 0 && sourceSize > 0)
+	{
+	  stream.next_in = (Bytef*)pSource;
+	  stream.avail_in = (uInt)std::min<uint64_t>(sourceSize, UINT_MAX);
+	  pSource += stream.avail_in;
+	  sourceSize -= stream.avail_in;
+	}
+	if (stream.avail_out == 0 && destSize > 0)
+	{
+	  stream.next_out = (Bytef*)pDest;
+	  stream.avail_out = (uInt)std::min<uint64_t>(destSize, UINT_MAX);
+	  pDest += stream.avail_out;
+	  destSize -= stream.avail_out;
+	}
+	err = inflate(&stream, Z_NO_FLUSH);
+  }
+  inflateEnd(&stream);
 
-  bool ret = true;
+  return err == Z_STREAM_END && stream.avail_out == 0 && destSize == 0;
+}
 
-  // Setup the inflate stream.
-  z_stream stream;
-  int err;
-
-  stream.next_in = (Bytef*)pcData;
-  stream.avail_in = (uInt)h.cSize;
-  stream.next_out = (Bytef*)pBuf;
-  stream.avail_out = (128 * 1024); //  read 128k at a time h.ucSize;
-  stream.zalloc = (alloc_func)0;
-  stream.zfree = (free_func)0;
-
-  // Perform inflation. wbits < 0 indicates no zlib header inside the data.
-  err = inflateInit2(&stream, -MAX_WBITS);
-  if (err == Z_OK)
+// --------------------------------------------------------------------------
+// Function:      ZipReadStream
+// Purpose:       Prepare to read one entry, stored or deflated
+// Parameters:    The archive and the file index
+// --------------------------------------------------------------------------
+ZipReadStream::ZipReadStream(const ZipFile &zip, int i)
+  : m_Zip(zip),
+  m_IsDeflated(false),
+  m_IsOpen(false),
+  m_IsFinished(false),
+  m_HasFailed(false),
+  m_Size(0),
+  m_Position(0),
+  m_InputOffset(0),
+  m_InputRemaining(0),
+  m_pInputWindow(NULL)
+{
+  memset(&m_Stream, 0, sizeof(m_Stream));
+
+  if (i < 0 || i >= zip.m_nEntries)
+	return;
+
+  const ZipFile::TZipEntry &entry = zip.m_Entries[i];
+  word compression = entry.pHeader->compression;
+  if (compression != Z_NO_COMPRESSION && compression != Z_DEFLATED)
+	return;
+
+  if (!zip.GetFileDataOffset(i, m_InputOffset))
+	return;
+
+  m_Size = entry.ucSize;
+  m_InputRemaining = entry.cSize;
+  m_IsDeflated = (compression == Z_DEFLATED);
+
+  if (m_IsDeflated)
   {
-	  uInt count = 0;
-	  bool cancel = false;
-		while (stream.total_in < (uInt)h.cSize && !cancel)
-		{
-			err = inflate(&stream, Z_SYNC_FLUSH);
-			if (err == Z_STREAM_END)
-			{
-				err = Z_OK;
-				break;
-			}
-			else if (err != Z_OK)
-			{
-				DEBUG_ASSERT(0 && "Something happened.");
-				break;
-			}
+	// wbits < 0 indicates no zlib header inside the data.
+	if (inflateInit2(&m_Stream, -MAX_WBITS) != Z_OK)
+	  return;
 
-			stream.avail_out = (128 * 1024); 
-			stream.next_out += stream.total_out;
+	if (!zip.m_pMappedData)
+	  m_pInputWindow = DEBUG_NEW char[INPUT_WINDOW_SIZE];
+  }
+  else if (m_InputRemaining != m_Size)
+	return;
 
-			progressCallback(count * 100 / h.cSize, cancel);
-		}
-		inflateEnd(&stream);
+  m_IsOpen = true;
+  m_IsFinished = (m_Size == 0 && !m_IsDeflated);
+}
+
+ZipReadStream::~ZipReadStream()
+{
+  if (m_IsDeflated)
+	inflateEnd(&m_Stream);
+  SAFE_DELETE_ARRAY(m_pInputWindow);
+}
+
+// --------------------------------------------------------------------------
+// Function:      Read
+// Purpose:       Hand out the next piece of decompressed data
+// Parameters:    The destination buffer and its size
+// --------------------------------------------------------------------------
+size_t ZipReadStream::Read(void *pBuf, size_t size)
+{
+  if (!m_IsOpen || m_IsFinished || m_HasFailed || pBuf == NULL || size == 0)
+	return 0;
+
+  if (!m_IsDeflated)
+  {
+	// Stored data, just copy the next piece.
+	size_t count = (size_t)std::min<uint64_t>(size, m_InputRemaining);
+	if (!m_Zip.ReadAt(m_InputOffset, pBuf, count))
+	{
+	  Fail();
+	  return 0;
+	}
+	m_InputOffset += count;
+	m_InputRemaining -= count;
+	m_Position += count;
+	m_IsFinished = (m_InputRemaining == 0);
+	return count;
   }
-  if (err != Z_OK)
-	ret = false;
 
-  delete[] pcData;
-  return ret;
+  // Never produce more than the directory promised, a corrupt entry must not overrun pBuf.
+  uInt outSize = (uInt)std::min<uint64_t>(std::min<uint64_t>(size, m_Size - m_Position), UINT_MAX);
+  m_Stream.next_out = (Bytef*)pBuf;
+  m_Stream.avail_out = outSize;
+
+  for (;;)
+  {
+	if (m_Stream.avail_in == 0 && m_InputRemaining > 0 && !RefillInput())
+	  break;
+
+	int err = inflate(&m_Stream, Z_NO_FLUSH);
+	if (err == Z_STREAM_END)
+	{
+	  m_IsFinished = true;
+	  break;
+	}
+	else if (err != Z_OK && err != Z_BUF_ERROR)
+	{
+	  Fail();
+	  break;
+	}
+
+	if (m_Stream.avail_out == 0)
+	{
+	  if (outSize > 0)
+		break;
+
+	  // All promised bytes are out, only the end of the stream may follow.
+	  if (err == Z_BUF_ERROR)
+	  {
+		Fail();
+		break;
+	  }
+	}
+	else if (m_Stream.avail_in == 0 && m_InputRemaining == 0)
+	{
+	  // Out of input before the end of the stream, the entry is truncated.
+	  Fail();
+	  break;
+	}
+  }
+
+  size_t produced = (char *)m_Stream.next_out - (char *)pBuf;
+  m_Position += produced;
+  return produced;
+}
+
+// --------------------------------------------------------------------------
+// Function:      RefillInput
+// Purpose:       Feed the inflater the next window of compressed data
+// Parameters:    
+// --------------------------------------------------------------------------
+bool ZipReadStream::RefillInput()
+{
+  if (m_Zip.m_pMappedData)
+  {
+	// The mapping holds everything, feed as much as zlib can take at once.
+	uInt count = (uInt)std::min<uint64_t>(m_InputRemaining, UINT_MAX);
+	m_Stream.next_in = (Bytef*)(m_Zip.m_pMappedData + m_InputOffset);
+	m_Stream.avail_in = count;
+	m_InputOffset += count;
+	m_InputRemaining -= count;
+	return true;
+  }
+
+  uInt count = (uInt)std::min<uint64_t>(m_InputRemaining, INPUT_WINDOW_SIZE);
+  if (!m_Zip.ReadAt(m_InputOffset, m_pInputWindow, count))
+  {
+	Fail();
+	return false;
+  }
+  m_Stream.next_in = (Bytef*)m_pInputWindow;
+  m_Stream.avail_in = count;
+  m_InputOffset += count;
+  m_InputRemaining -= count;
+  return true;
+}
+
+void ZipReadStream::Fail()
+{
+  m_HasFailed = true;
+  m_IsFinished = false;
 }
 
 
@@ -1,40 +1,132 @@
 #pragma once
 #include "../TinyEngineBase.h"
+#include "ResourceId.h"
+#include "FileReader.h"
+#include <zlib.h>
 
-typedef std::map<std::string, int> ZipContentsMap;		// maps path to a zip content id
+typedef std::unordered_map<uint64_t, int> ZipContentsMap;		// maps ResourceId hash of a path to a zip content id
+
+// Receives decompressed data chunk by chunk, return false to cancel the read
+typedef std::function<bool(const char *pData, size_t size)> ZipChunkSink;
 
 class ZipFile
 {
   public:
-	ZipFile() { m_nEntries=0; m_pFile=NULL; m_pDirData=NULL; }
-	virtual ~ZipFile() { End(); fclose(m_pFile); }
+	ZipFile();
+	virtual ~ZipFile() { End(); }
 
-	bool Init(const std::wstring &resFileName);
+	bool Init(const std::wstring &resFileName, FileReaderType readerType = FileReader_Mapped);
 	void End();
 
 	int GetNumFiles()const { return m_nEntries; }
 	std::string GetFilename(int i) const;	
-	int GetFileLen(int i) const;
-	bool ReadFile(int i, void *pBuf);
+	int64_t GetFileLen(int i) const;
+	// Of the entry's local header, entries are stored in this order
+	uint64_t GetFileOffset(int i) const { return m_Entries[i].hdrOffset; }
+	// Entry reads only use positional reads and per call inflate state, several threads
+	// can read different (or the same) entries at once.
+	bool ReadFile(int i, void *pBuf) const;
+
+	// Stored entries of a memory mapped archive can be used in place without a copy.
+	// Returns NULL for deflated entries or when the archive could not be mapped.
+	const char *GetFileView(int i) const;
+	bool IsMapped() const { return m_pMappedData != NULL; }
+
+	// Decompresses in steps and reports progress, reentrant like ReadFile
+	bool ReadLargeFile(int i, void *pBuf, void (*progressCallback)(int, bool &)) const;
 
-	// Added to show multi-threaded decompression
-	bool ReadLargeFile(int i, void *pBuf, void (*progressCallback)(int, bool &));
+	// Streams a file through the sink in chunks of at most chunkSize bytes, peak memory
+	// stays at one chunk plus the input window no matter how large the entry is.
+	bool ReadFileChunked(int i, size_t chunkSize, const ZipChunkSink &sink) const;
 
+	// Batched reads. The extent of an entry runs from its local header up to whatever is stored
+	// next, extents of neighbouring entries can be read with one ReadRaw and then decoded apart
+	// with DecodeFile, on any thread.
+	bool GetFileExtent(int i, uint64_t &offset, uint64_t &size) const;
+	bool ReadRaw(uint64_t offset, void *pBuf, size_t size) const { return ReadAt(offset, pBuf, size); }
+	bool ReadRawBatch(std::vector<FileReadRequest> &requests) const;
+	bool DecodeFile(int i, const char *pExtent, uint64_t extentSize, void *pBuf) const;
+
+	// Hashes are only the first probe, the entry's name has to match as well
 	int Find(const std::string &path) const;
+	int Find(const ResourceId &id) const;
 
 	ZipContentsMap m_ZipContentsMap;
 
   private:
+	friend class ZipReadStream;
+
 	struct TZipDirHeader;
+	struct TZip64DirLocator;
+	struct TZip64DirHeader;
 	struct TZipDirFileHeader;
 	struct TZipLocalHeader;
 
-	FILE *m_pFile;		// Zip file
+	// Directory entry with its sizes and offset widened to 64 bits (ZIP64)
+	struct TZipEntry
+	{
+		const TZipDirFileHeader *pHeader;
+		uint64_t cSize;
+		uint64_t ucSize;
+		uint64_t hdrOffset;
+		uint64_t extentSize;	// Up to the next entry or the directory
+	};
+
+	bool OpenArchive(const std::wstring &resFileName, FileReaderType readerType);
+	bool FindDirHeader(uint64_t &dhOffset, TZipDirHeader &dh) const;
+	int Find(uint64_t resourceHash, const std::string &normalizedPath) const;
+	bool IsEntryNamed(int i, const std::string &normalizedPath) const;
+	void ReadZip64Extra(const TZipDirFileHeader &fh, TZipEntry &entry) const;
+	bool ReadAt(uint64_t offset, void *pBuf, size_t size) const;
+	bool GetFileDataOffset(int i, uint64_t &dataOffset) const;
+
+	unique_ptr<IFileReader> m_pReader;	// Read with explicit offsets when the archive is not mapped
+	const char *m_pMappedData;	// The whole archive, read only
+	uint64_t m_FileSize;
+
 	char *m_pDirData;	// Raw data buffer.
 	int  m_nEntries;	// Number of entries.
 
-	// Pointers to the dir entries in pDirData.
-	const TZipDirFileHeader **m_papDir;   
+	// The dir entries in pDirData.
+	std::vector<TZipEntry> m_Entries;
 };
 
+// Pulls the decompressed data of one zip entry in caller sized pieces. The stream keeps
+// its own inflate state and input window, so several streams can read one archive at once.
+class ZipReadStream
+{
+  public:
+	ZipReadStream(const ZipFile &zip, int i);
+	~ZipReadStream();
 
+	bool IsOpen() const { return m_IsOpen; }
+	bool IsFinished() const { return m_IsFinished; }
+	bool HasFailed() const { return m_HasFailed; }
+
+	// Returns the number of bytes written to pBuf, 0 once the entry is finished or on failure
+	size_t Read(void *pBuf, size_t size);
+
+	uint64_t GetSize() const { return m_Size; }
+	uint64_t GetPosition() const { return m_Position; }
+	int GetProgress() const { return m_Size ? (int)(m_Position * 100 / m_Size) : 100; }
+
+  private:
+	enum { INPUT_WINDOW_SIZE = 64 * 1024 };
+
+	bool RefillInput();
+	void Fail();
+
+	const ZipFile &m_Zip;
+	z_stream m_Stream;
+	bool m_IsDeflated;
+	bool m_IsOpen;
+	bool m_IsFinished;
+	bool m_HasFailed;
+
+	uint64_t m_Size;			// Uncompressed size
+	uint64_t m_Position;		// Uncompressed bytes handed out so far
+	uint64_t m_InputOffset;		// Next archive offset to feed the inflater from
+	uint64_t m_InputRemaining;	// Compressed bytes not fed yet
+
+	char *m_pInputWindow;		// Only needed when the archive is not mapped
+};
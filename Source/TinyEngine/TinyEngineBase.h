@@ -19,6 +19,7 @@
 #include <stack>
 #include <queue>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
 #include <functional>
 #include <memory>
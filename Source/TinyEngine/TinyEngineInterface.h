@@ -128,7 +128,9 @@ public:
 };
 
 class Resource;
+class ResourceId;
 class ResHandle;
+class ThreadPool;
 
 class IResourceLoader
 {
@@ -139,19 +141,79 @@ public:
 	virtual bool VAddNullZero() { return false; }
 	virtual uint32_t VGetLoadedResourceSize(char *rawBuffer, uint32_t rawSize) = 0;
 	virtual bool VLoadResource(char *rawBuffer, uint32_t rawSize, shared_ptr<ResHandle> handle) = 0;
+	// Return true if VLoadResource may run on a resource worker thread
+	virtual bool VIsThreadSafe() { return false; }
+	// Budget category the loaded handles are charged to, empty for the shared part of the cache
+	virtual std::string VGetCategory() { return ""; }
+	// Names of the other resources the loaded resource refers to, so it is reported as changed
+	// when one of them is. Called on the main thread once the handle is in the cache.
+	virtual void VGetDependencies(shared_ptr<ResHandle> handle, std::vector<std::string>& dependencies) {}
 };
 
+// How an archive reads its file, see ResourceCache/FileReader.h
+enum FileReaderType
+{
+	FileReader_Mapped,			// mapped where possible, positional reads otherwise
+	FileReader_Blocking,		// one positional read at a time
+	FileReader_ThreadPool,		// positional reads spread over I/O threads
+	FileReader_IoUring,			// an io_uring on Linux, the I/O threads elsewhere
+};
+
+// One of several reads kept in flight together
+struct FileReadRequest
+{
+	uint64_t m_Offset;
+	char* m_pBuffer;
+	size_t m_Size;
+	bool m_IsDone;
+};
+
+// Resource files are read from the resource worker threads, implementations must be reentrant.
 class IResourceFile
 {
 public:
 	virtual ~IResourceFile() { }
 	virtual bool VOpen() = 0;
 	virtual void VRemoveRawResource(const Resource &r) = 0;
-	virtual int VGetRawResourceSize(const Resource &r) = 0;
-	virtual int VGetRawResource(const Resource &r, char *buffer) = 0;
+	// Sizes are 64 bit so packaged content can grow past 4 GB, -1 means not found
+	virtual int64_t VGetRawResourceSize(const Resource &r) = 0;
+	virtual int64_t VGetRawResource(const Resource &r, char *buffer) = 0;
+	// Where the resource is stored in the file, so batches can be read front to back. -1 when
+	// the resource is missing or the file has no meaningful order, like loose files.
+	virtual int64_t VGetRawResourceOffset(const Resource &r) { return -1; }
+	// Batched reads. The stored extent is the range of the file a resource is decoded from,
+	// neighbouring extents are read with one VReadStored and decoded apart, on any thread.
+	// Files without extents are read a resource at a time.
+	virtual bool VGetStoredExtent(const Resource &r, uint64_t &offset, uint64_t &size) { return false; }
+	virtual bool VReadStored(uint64_t offset, char *buffer, size_t size) { return false; }
+	// Several VReadStored with as many in flight at once as the file's reader allows
+	virtual bool VReadStoredBatch(std::vector<FileReadRequest> &requests)
+	{
+		bool success = true;
+		for (auto& request : requests)
+		{
+			request.m_IsDone = VReadStored(request.m_Offset, request.m_pBuffer, request.m_Size);
+			success = success && request.m_IsDone;
+		}
+		return success;
+	}
+	// Fills buffer with the raw resource from its stored extent, returns the bytes written
+	virtual int64_t VDecodeStored(const Resource &r, const char *pStored, uint64_t storedSize, char *buffer) { return 0; }
+	// Reads size bytes of the raw resource starting at offset, without the rest of it. Returns the
+	// bytes read, 0 when the file can only read the resource as a whole.
+	virtual int64_t VGetRawResourceRange(const Resource &r, uint64_t offset, uint64_t size, char *buffer) { return 0; }
+	// Workers the file may spread the decoding of a single large resource over, nullptr for none
+	virtual void VSetDecodeThreads(ThreadPool* pThreads) {}
+	// Takes effect the next time the file is opened
+	virtual void VSetFileReader(FileReaderType type) {}
+	// Read only pointer to the raw bytes when the file can hand them out without a copy, otherwise nullptr.
+	// The pointer stays valid for as long as the resource file is open.
+	virtual const char* VGetRawResourceView(const Resource &r) { return nullptr; }
 	virtual int VGetNumResources() const = 0;
 	virtual std::string VGetResourceName(int num) const = 0;
 	virtual bool VIsUsingDevelopmentDirectories(void) const = 0;
+	// Picks up files added or removed since the last look, true if anything changed
+	virtual bool VRefresh() { return false; }
 };
 
 enum RenderPass
@@ -222,6 +284,10 @@ public:
 
 	virtual bool VCompileShaderFromMemory(const void* pBuffer, uint32_t lenght, shared_ptr<IResourceExtraData> pExtraData) = 0;
 	virtual bool VCreateShaderFromMemory(const void* pBuffer, uint32_t lenght, shared_ptr<IResourceExtraData> pExtraData) = 0;
+	// Compiles effect source to what VCreateShaderFromMemory takes, so the result can be kept
+	virtual bool VCompileShaderToByteCode(const void* pBuffer, uint32_t length, std::vector<char>& byteCode) = 0;
+	// Byte code compiled with different options is different, part of the derived data key
+	virtual std::string VGetShaderCompileOptions() = 0;
 	virtual bool VCreateDDSTextureResoure(char *rawBuffer, uint32_t rawSize, shared_ptr<IResourceExtraData> pExtraData) = 0;
 	virtual bool VCreateWICTextureResoure(char *rawBuffer, uint32_t rawSize, shared_ptr<IResourceExtraData> pExtraData) = 0;
 	virtual const std::string& VGetDeviceName() = 0;
@@ -249,6 +315,8 @@ public:
 	virtual bool VAddChild(shared_ptr<ISceneNode> child) = 0;
 	virtual bool VRemoveChild(ActorId actorId) = 0;
 	virtual void VPick(Scene* pScene, int cursorX, int cursorY) = 0;
+	// changed are the files that changed, affected adds everything that depends on them
+	virtual void VOnResourceChanged(Scene* pScene, const std::vector<ResourceId>& changed, const std::vector<ResourceId>& affected) = 0;
 };
 
 class IGamePhysics
@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+#include "boost/thread/condition_variable.hpp"
+#include <atomic>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+	: m_ThreadCount(threadCount)
+{
+	if (m_ThreadCount == 0)
+	{
+		uint32_t hardwareThreads = boost::thread::hardware_concurrency();
+		m_ThreadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i < m_ThreadCount; i++)
+	{
+		m_Threads.create_thread(boost::bind(&ThreadPool::WorkerMain, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	// An empty task tells a worker to quit, queued work in front of it still runs
+	for (uint32_t i = 0; i < m_ThreadCount; i++)
+	{
+		m_Tasks.push(Task());
+	}
+	m_Threads.join_all();
+}
+
+void ThreadPool::Submit(const Task& task)
+{
+	DEBUG_ASSERT(task);
+	m_Tasks.push(task);
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+	struct Shared
+	{
+		Shared() : m_Next(0), m_Finished(0) {}
+
+		std::atomic<uint32_t> m_Next;
+		boost::mutex m_Mutex;
+		boost::condition_variable m_AllFinished;
+		uint32_t m_Finished;
+	};
+	shared_ptr<Shared> shared(DEBUG_NEW Shared());
+
+	// Whoever runs first takes the next index. Helpers that start after everything is taken
+	// return without touching task, which may be gone by then.
+	Task work = [shared, count, task]()
+	{
+		for (uint32_t i = shared->m_Next++; i < count; i = shared->m_Next++)
+		{
+			task(i);
+
+			boost::mutex::scoped_lock lock(shared->m_Mutex);
+			if (++shared->m_Finished == count)
+			{
+				shared->m_AllFinished.notify_all();
+			}
+		}
+	};
+
+	uint32_t helpers = std::min(m_ThreadCount, count) - ((count > 0) ? (1) : (0));
+	for (uint32_t i = 0; i < helpers; i++)
+	{
+		m_Tasks.push(work);
+	}
+	work();
+
+	// Only indices already running on a worker are left to wait for
+	boost::mutex::scoped_lock lock(shared->m_Mutex);
+	while (shared->m_Finished < count)
+	{
+		shared->m_AllFinished.wait(lock);
+	}
+}
+
+void ThreadPool::WorkerMain()
+{
+	while (true)
+	{
+		Task task;
+		m_Tasks.wait_and_pop(task);
+		if (!task)
+			break;
+
+		task();
+	}
+}
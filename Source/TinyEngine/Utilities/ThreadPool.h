@@ -0,0 +1,27 @@
+#pragma once
+#include "../TinyEngineBase.h"
+#include "ConcurrentQueue.h"
+#include "boost/thread/thread.hpp"
+
+class ThreadPool : public boost::noncopyable
+{
+public:
+	typedef std::function<void()> Task;
+
+	// threadCount 0 means one worker per hardware thread, leaving one for the main thread
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	void Submit(const Task& task);
+	// Runs task(0) to task(count - 1) on the workers and the calling thread, returns when all of
+	// them are done. The caller does its share itself, so this is safe from inside a worker.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+	uint32_t GetThreadCount() const { return m_ThreadCount; }
+
+private:
+	void WorkerMain();
+
+	concurrent_queue<Task> m_Tasks;
+	boost::thread_group m_Threads;
+	uint32_t m_ThreadCount;
+};
@@ -87,6 +87,17 @@ test_match:
 	goto test_match;
 }
 
+uint64_t Utility::HashString64(const char *str, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= (uint8_t)str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
 std::wstring Utility::GetExecutableDirectory()
 {
 	WCHAR buffer[MAX_PATH];
@@ -9,6 +9,8 @@ public:
 	static std::string WS2S(const std::wstring& s);
 	static std::wstring S2WS(const std::string &s);
 	static bool WildcardMatch(const char *pat, const char *str);
+	// 64 bit FNV-1a, stable across runs and platforms so it can be stored in asset packs
+	static uint64_t HashString64(const char *str, size_t length);
 
 	static std::wstring GetExecutableDirectory();
 	static std::string GetFileName(const std::string& filePath);